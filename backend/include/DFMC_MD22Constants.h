@@ -24,6 +24,22 @@ namespace mtca4u { namespace dfmc_md22 {
   std::string const CONTROLER_SPI_SYNC_ADDRESS_STRING = "WORD_CTRL_SPI_SYNC";
   std::string const CONTROLER_STATUS_BITS_ADDRESS_STRING = "WORD_CTRL_STATUS_BITS";
 
+  /* Batch transfers on the controler SPI. No released DFMC-MD22 firmware has these
+   * registers, the protocol is specified here and emulated by the DFMC_MD22Dummy.
+   * SPIviaPCIe only uses it if both registers are in the map file.
+   *
+   * 1. The host writes SPI_SYNC_REQUESTED to WORD_CTRL_SPI_SYNC and the commands to
+   *    WORD_CTRL_SPI_BATCH.
+   * 2. Writing the number of commands to WORD_CTRL_SPI_BATCH_SIZE starts the transfer.
+   * 3. The firmware sends the commands back-to-back and decrements
+   *    WORD_CTRL_SPI_BATCH_SIZE after each executed command.
+   * 4. When all commands have been executed, the firmware writes SPI_SYNC_OK. If a
+   *    command fails, it stops and writes SPI_SYNC_ERROR, so WORD_CTRL_SPI_BATCH_SIZE
+   *    still counts the failed command and all commands after it.
+   */
+  std::string const CONTROLER_SPI_BATCH_ADDRESS_STRING = "WORD_CTRL_SPI_BATCH";
+  std::string const CONTROLER_SPI_BATCH_SIZE_ADDRESS_STRING = "WORD_CTRL_SPI_BATCH_SIZE";
+
   int32_t const SPI_SYNC_OK = 0;
   int32_t const SPI_SYNC_REQUESTED = 0xFF;
   int32_t const SPI_SYNC_ERROR = 0xAA;
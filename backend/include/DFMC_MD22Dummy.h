@@ -102,6 +102,17 @@ namespace mtca4u {
      */
     void causeSpiErrors(bool causeErrors);
 
+    /** The next batch transfer on the controller SPI stops after nExecutedCommands
+     * commands. The next command fails with an SPI error, or the handshake is not
+     * completed if causeTimeout is true. Only affects the batch registers.
+     */
+    void interruptNextSpiBatch(unsigned int nExecutedCommands, bool causeTimeout);
+
+    /** Number of synchronisation handshakes on the controller SPI since the
+     * dummy was created. A batch transfer counts as one handshake.
+     */
+    unsigned int getControllerSpiHandshakeCount();
+
     /** Overwrite the firmware version for testing. To restore the dummy default
      * use resetFirmwareVersion().
      */
@@ -120,6 +131,12 @@ namespace mtca4u {
      */
     void setDriverSpiDelay(unsigned int microseconds);
 
+    /** The reference switch inputs are not simulated. This sets the state of the
+     * switches of a motor in the JDX_REFERENCE_SWITCH register of the controler
+     * and updates the reference switch bit in the controler status word.
+     */
+    void setReferenceSwitchesActive(unsigned int motorID, bool positiveSwitchActive, bool negativeSwitchActive);
+
     /*
      * @brief read the configurable TMC429 registers.
      *
@@ -147,6 +164,7 @@ namespace mtca4u {
    private:
     // callback functions
     void handleControlerSpiWrite();
+    void handleControlerSpiBatchWrite();
     void handleDriverSpiWrite(unsigned int ID);
 
     // members
@@ -155,21 +173,49 @@ namespace mtca4u {
     uint64_t _controlerSpiBar;
     uint64_t _controlerSpiReadbackAddress;
     uint64_t _controlerSpiSyncAddress;
+    uint64_t _controlerSpiBatchAddress;
+    uint64_t _controlerSpiBatchSizeAddress;
+    size_t _controlerSpiBatchCapacity; // 0 if the map file has no batch registers
+    unsigned int _controlerSpiHandshakeCount;
     bool _powerIsUp;
 
     // internal and helper functions
+    void performControlerSpiTransfer(int32_t controlerSpiWriteWord);
     void writeContentToControlerSpiRegister(unsigned int content, unsigned int controlerSpiAddress);
     void writeControlerSpiContentToReadbackRegister(unsigned int controlerSpiAddress);
     void triggerActionsOnControlerSpiWrite(TMC429InputWord const& inputWord);
     void performIdxActions(unsigned int idx);
     void performJdxActions(unsigned int jdx);
 
+    /** The TMC429 reports in its status word for each motor if the actual
+     * position equals the target position (xEQt) and the state of the left
+     * (negative) reference switch (RS). The dummy updates the bits when the
+     * registers they depend on are written, so a status word set by a test is
+     * kept until then.
+     */
+    void updateTargetPositionReachedBit(unsigned int motorID);
+    void updateReferenceSwitchBits();
+    void setControlerStatusBit(unsigned int bit, bool value);
+    uint64_t _controlerStatusBar;
+    uint64_t _controlerStatusAddress;
+
     /** In the DFMC_MD22 some registers of the controler SPI address space have a
      * copy in the PCIe address space, which is updated by a loop when the FPGA is
      * idle. The dummy simulates this behaviour.
      */
     void synchroniseFpgaWithControlerSpiRegisters();
-    void writeControlerSpiRegisterToFpga(unsigned int ID, unsigned int IDX, std::string suffix);
+
+    /// A PCIe register which holds a copy of a controler SPI register
+    struct FpgaCopyRegister {
+      unsigned int controlerSpiAddress;
+      uint64_t bar;
+      uint64_t address;
+    };
+    /** The copies are updated after each SPI transfer, so their addresses are only
+     * looked up in the register map on the first update.
+     */
+    std::vector<FpgaCopyRegister> _fpgaCopyRegisters;
+    void addFpgaCopyRegister(unsigned int ID, unsigned int IDX, std::string const& suffix);
 
     void setPCIeRegistersForTesting();
     void setStandardRegisters();
@@ -202,6 +248,8 @@ namespace mtca4u {
     unsigned int _nSpiTimeoutsLeft; // when this counter reaches 0 it sets
                                     // _causeSpiTimeouts back to false
     bool _causeSpiErrors;
+    int _nCommandsBeforeBatchInterrupt; // -1 if the next batch is not interrupted
+    bool _batchInterruptIsTimeout;
 
     unsigned int _microsecondsControllerSpiDelay;
     unsigned int _microsecondsDriverSpiDelay;
@@ -93,6 +93,12 @@ namespace mtca4u {
     virtual void setEndSwitchPowerEnabled(bool enable = true) = 0;
     virtual bool isEndSwitchPowerEnabled() = 0;
 
+    /** Stop the motor as fast as possible: switch off the motor current and the
+     * end switch power and set the target position to the actual position. The
+     * SPI transfer takes precedence over all other waiting transfers of the card.
+     */
+    virtual void emergencyStop() = 0;
+
     virtual MotorReferenceSwitchData getReferenceSwitchData() = 0; ///< Get information about both reference
                                                                    ///< switches of this Motor
 
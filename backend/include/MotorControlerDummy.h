@@ -3,6 +3,10 @@
 
 #include "MotorControler.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
 
 namespace mtca4u {
@@ -106,6 +110,11 @@ namespace mtca4u {
     double getUserSpeedLimit() override;
     double getMaxSpeedCapability() override;
 
+    /** Set the value returned by getMaxSpeedCapability(), in microsteps per second.
+     *  The default is 1e6, higher than the default user speed limit.
+     */
+    void setMaxSpeedCapability(double microStepsPerSecond);
+
     double setUserCurrentLimit(double currentLimit) override;
     double getUserCurrentLimit() override;
     double getMaxCurrentLimit() override;
@@ -116,6 +125,8 @@ namespace mtca4u {
     void setEndSwitchPowerEnabled(bool enable) override;
     bool isEndSwitchPowerEnabled() override;
 
+    void emergencyStop() override;
+
     /**
      * Block the motor and do not move if true. simulateBlockedMotor(true) is an
      * alternative to calling moveTowardsTarget with the blockMotor flag set to
@@ -140,8 +151,41 @@ namespace mtca4u {
     void setNegativeEndSwitch(int endSwitchNeg);
     int getNegativeEndSwitch();
 
+    /** Simulate the bus latency of a real card: getActualPosition(), getTargetPosition(),
+     *  getDecoderPosition() and isMotorMoving() wait for the given time before they read
+     *  the state. The default is 0.
+     */
+    void setSimulatedReadDelay(std::chrono::microseconds delay);
+
+    /** Block the next reads of the state (the getters of setSimulatedReadDelay()) until
+     *  releaseBlockedReads() is called. This holds the reading threads at a defined point.
+     */
+    void blockNextReads(unsigned int nReads);
+    /// Release the reads which are blocked at the moment, see blockNextReads()
+    void releaseBlockedReads();
+    /// Wait until the given number of reads is blocked at the moment, see blockNextReads()
+    void waitForBlockedReads(unsigned int nReads);
+
+    /** Let the reads of the state (the getters of setSimulatedReadDelay()) throw a
+     *  ChimeraTK::runtime_error, like a card which cannot be accessed any more.
+     */
+    void setSimulatedReadErrors(bool enable);
+
    private:
     mutable std::mutex _motorControllerDummyMutex;
+    std::atomic<std::chrono::microseconds::rep> _simulatedReadDelay{0};
+
+    /// Simulates the bus transfer of a read: the blocking of blockNextReads(), the read errors and the read delay.
+    /// Must be called without the mutex, like a real bus transfer.
+    void simulateRead();
+
+    // see blockNextReads()
+    std::mutex _readBlockMutex;
+    std::condition_variable _readBlockCondition;
+    unsigned int _nReadsToBlock{0};
+    unsigned int _nBlockedReads{0};
+    uint64_t _nReleases{0};
+    std::atomic<bool> _simulatedReadErrors{false};
     int _hardwarePosition{0}; ///< Like the real absolute position of a motor, in
                               ///< steps
 
@@ -166,6 +210,7 @@ namespace mtca4u {
     int _negativeEndSwitchPosition{-10000};
 
     double _userSpeedLimit{100000}; // Arbitrary high value
+    double _maxSpeedCapability{1000000}; // See setMaxSpeedCapability()
 
     unsigned int _id;
 
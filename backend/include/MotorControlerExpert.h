@@ -2,8 +2,12 @@
 #define MTCA4U_MOTOR_CONTROLER_EXPERT_H
 
 #include "MotorControler.h"
+#include "MotorStatusSnapshot.h"
+#include "SpiTransactionCounters.h"
 #include "TMC429Words.h"
 
+#include <chrono>
+
 #define MCX_DECLARE_SET_GET_VALUE(NAME, VARIABLE_IN_UNITS)                                                             \
   virtual void set##NAME(unsigned int VARIABLE_IN_UNITS) = 0;                                                          \
   virtual unsigned int get##NAME() = 0
@@ -50,6 +54,39 @@ namespace mtca4u {
     [[nodiscard]] virtual CoolStepControlData const& getCoolStepControlData() const = 0;
     [[nodiscard]] virtual StallGuardControlData const& getStallGuardControlData() const = 0;
     [[nodiscard]] virtual DriverConfigData const& getDriverConfigData() const = 0;
+
+    /**
+     * Read all readback registers of this motor in one go. The registers are
+     * read through a TransferGroup, so adjacent registers are fetched together
+     * in as few transfers as the backend allows.
+     */
+    virtual MotorStatusSnapshot readAllStatus() = 0;
+
+    /**
+     * Start a background thread which reads all readback registers of this motor
+     * in one pass every refresh period and publishes them as MotorStatusSnapshot.
+     * If the refresher is already running only the period is changed.
+     */
+    virtual void startReadbackRefresher(std::chrono::microseconds refreshPeriod) = 0;
+    /// Stop the background refresher. The last published snapshot stays available.
+    virtual void stopReadbackRefresher() = 0;
+    virtual bool isReadbackRefresherRunning() = 0;
+    /**
+     * Get the last snapshot published by the readback refresher. This function
+     * does not block and does not access the hardware, so it can be called at a
+     * high rate from any thread. Check MotorStatusSnapshot::updateCounter and
+     * timestamp to see whether and when the snapshot has been taken.
+     */
+    virtual MotorStatusSnapshot getReadbackSnapshot() = 0;
+
+    /// Get the transaction counters of the SPI to the TMC260 driver chip of this motor
+    virtual SpiTransactionCounters getDriverSpiCounters() const = 0;
+    virtual void resetDriverSpiCounters() = 0;
+    /**
+     * Get the transaction counters of the SPI to the TMC429 controler chip. It is
+     * shared by all motors of the card, see MotorDriverCard::getControlerSpiCounters().
+     */
+    virtual SpiTransactionCounters getControlerSpiCounters() const = 0;
   };
 
 } // namespace mtca4u
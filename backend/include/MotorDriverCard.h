@@ -1,10 +1,13 @@
 #ifndef MTCA4U_MOTOR_DRIVER_CARD_H
 #define MTCA4U_MOTOR_DRIVER_CARD_H
 
+#include "SpiTransactionCounters.h"
 #include "TMC429Words.h"
 
 #include <boost/shared_ptr.hpp>
 
+#include <map>
+
 namespace mtca4u {
   class MotorControler;
   class PowerMonitor;
@@ -24,6 +27,21 @@ namespace mtca4u {
     /// Get a reference to the power monitor.
     virtual PowerMonitor& getPowerMonitor() = 0;
 
+    /** Set the target positions of several motors at once, like
+     *  MotorControler::setTargetPosition(). The key is the motor controler ID.
+     *  The writes are issued back-to-back, so the motors start as simultaneously
+     *  as the hardware allows.
+     *  Throws a logic_error if one of the IDs is invalid, in which case no target is set.
+     */
+    virtual void setTargetPositions(std::map<unsigned int, int> const& targetPositions) = 0;
+
+    /** Get the transaction counters of the SPI to the TMC429 motor controler chip,
+     *  which is shared by all motors of the card. Reading and resetting does not
+     *  block the transfers.
+     */
+    virtual SpiTransactionCounters getControlerSpiCounters() const = 0;
+    virtual void resetControlerSpiCounters() = 0;
+
     virtual ~MotorDriverCard() {}
   };
 
@@ -15,6 +15,13 @@ namespace mtca4u {
     boost::shared_ptr<MotorControler> getMotorControler(unsigned int motorControlerID) override;
 
     PowerMonitor& getPowerMonitor() override;
+
+    /// Sets the targets one after the other
+    void setTargetPositions(std::map<unsigned int, int> const& targetPositions) override;
+
+    /// The dummy has no SPI, all counters stay 0
+    SpiTransactionCounters getControlerSpiCounters() const override;
+    void resetControlerSpiCounters() override;
     ~MotorDriverCardDummy() override = default;
 
    private:
@@ -39,6 +39,10 @@ namespace mtca4u {
     std::map<MotorDriverCardKey, boost::weak_ptr<MotorDriverCard>> _motorDriverCards;
     std::map<MotorDriverCardKey, boost::shared_ptr<MotorDriverCard>> _dummyMotorDriverCards;
     bool _dummyMode{false};
+    bool _differentialInit{false};
+    bool _registerShadow{false};
+    bool _interprocessArbitration{false};
+    bool _spiTransferThread{false};
 
    public:
     MotorDriverCardFactory(MotorDriverCardFactory const&) = delete;
@@ -48,6 +52,40 @@ namespace mtca4u {
     static MotorDriverCardFactory& instance();
     bool getDummyMode();
     void setDummyMode(bool dummyMode = true);
+
+    /** In differential init mode the TMC429 registers of newly created cards are
+     * read back first, and only the registers which differ from the configuration
+     * are written. This speeds up opening cards which are already configured, e.g.
+     * after a restart of the server, and does not touch registers of motors which
+     * are still in use. The TMC260 driver registers cannot be read back and are
+     * always written. Cards which already exist are not affected.
+     */
+    bool getDifferentialInit();
+    void setDifferentialInit(bool differentialInit = true);
+
+    /** Keep the write-only TMC260 driver registers of newly created cards in a
+     * shadow in shared memory, see RegisterShadow. The shadow is shared by all
+     * processes using the same device alias and module, and it survives a restart
+     * of the process. In differential init mode unchanged driver registers are then
+     * not written again.
+     */
+    bool getRegisterShadow();
+    void setRegisterShadow(bool registerShadow = true);
+
+    /** Arbitrate the SPI transfers of newly created cards between processes, see
+     * SpiArbitration. This is needed if several processes (e.g. a server and a
+     * diagnostics tool) use the same card at the same time. All of them have to
+     * switch it on.
+     */
+    bool getInterprocessArbitration();
+    void setInterprocessArbitration(bool interprocessArbitration = true);
+
+    /** Newly created cards execute the TMC429 transfers in a dedicated thread with
+     * priority queues, so e.g. diagnostic reads cannot delay an emergency stop, see
+     * MotorDriverCardImpl::enableControlerSpiTransferThread().
+     */
+    bool getSpiTransferThread();
+    void setSpiTransferThread(bool spiTransferThread = true);
     /** Create a motor driver card from the device alias, the module name in the
      * map file (there might be more than one MD22 on the carrier), and the file
      * name for the motor config.
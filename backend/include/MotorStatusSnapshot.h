@@ -0,0 +1,41 @@
+#ifndef MTCA4U_MOTOR_STATUS_SNAPSHOT_H
+#define MTCA4U_MOTOR_STATUS_SNAPSHOT_H
+
+#include "TMC260Words.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace mtca4u {
+
+  /** A plain copy of the readback registers of one motor, taken in one pass.
+   *
+   *  The values are already converted like the corresponding getters of the
+   *  MotorControler (e.g. the actual position is sign-extended from 24 bits).
+   *  The struct is trivially copyable so it can be published lock-free.
+   */
+  struct MotorStatusSnapshot {
+    int actualPosition{0};                  ///< see MotorControler::getActualPosition()
+    int actualVelocity{0};                  ///< see MotorControler::getActualVelocity()
+    unsigned int actualAcceleration{0};     ///< see MotorControler::getActualAcceleration()
+    unsigned int microStepCount{0};         ///< see MotorControler::getMicroStepCount()
+    unsigned int stallGuardValue{0};        ///< see MotorControlerExpert::getStallGuardValue()
+    unsigned int coolStepValue{0};          ///< see MotorControlerExpert::getCoolStepValue()
+    unsigned int driverStatusWord{0};       ///< raw data word of MotorControler::getStatus()
+    unsigned int decoderReadoutMode{0};     ///< see MotorControler::getDecoderReadoutMode()
+    unsigned int decoderPosition{0};        ///< see MotorControler::getDecoderPosition()
+    unsigned int controlerStatusWord{0};    ///< raw controler status bits (incl. reference switches)
+    bool motorCurrentEnabled{false};        ///< see MotorControler::isMotorCurrentEnabled()
+
+    /// Time when the registers were read. Default constructed if the snapshot has never been taken.
+    std::chrono::steady_clock::time_point timestamp{};
+    /// Counts the snapshots taken by the motor controler so far. 0 means the snapshot has never been taken.
+    uint64_t updateCounter{0};
+
+    /// The driver status as typed word, as returned by MotorControler::getStatus()
+    DriverStatusData getStatus() const { return DriverStatusData(driverStatusWord); }
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_MOTOR_STATUS_SNAPSHOT_H
@@ -0,0 +1,77 @@
+#ifndef MTCA4U_SPI_TRANSACTION_COUNTERS_H
+#define MTCA4U_SPI_TRANSACTION_COUNTERS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace mtca4u {
+
+  /** A copy of the transaction counters of one SPI, see SPIviaPCIe::getTransactionCounters().
+   *
+   *  A transaction is one synchronisation handshake with the firmware, i.e. one
+   *  command written with SPIviaPCIe::write() or read(), or one block of a batch
+   *  transfer. Retries are counted as transactions of their own.
+   */
+  struct SpiTransactionCounters {
+    static size_t const N_LATENCY_BINS = 24;
+
+    uint64_t nTransactions{0};
+    /// Transactions which have been repeated because the firmware has not answered in time
+    uint64_t nRetries{0};
+    /// Transactions without an answer of the firmware, including the ones which have been retried
+    uint64_t nTimeouts{0};
+    /// Transactions for which the firmware has reported an error
+    uint64_t nErrors{0};
+    /// Checks of the synchronisation register after the first one. At most 10 per transaction with the
+    /// SLEEP wait strategy.
+    uint64_t nPollIterations{0};
+
+    /** Number of completed transactions (without timeouts) per latency range. Bin 0 counts
+     *  latencies below 1 us, bin i latencies from 2^(i-1) us to below 2^i us. The last bin also
+     *  counts all longer latencies.
+     */
+    std::array<uint64_t, N_LATENCY_BINS> latencyHistogram{};
+
+    /// The (exclusive) upper limit of a bin of the latency histogram
+    static std::chrono::microseconds getBinUpperLimit(size_t bin) {
+      return std::chrono::microseconds(int64_t(1) << bin);
+    }
+
+    /// The bin of the latency histogram for the given latency
+    static size_t getBin(std::chrono::nanoseconds latency) {
+      auto microSeconds = static_cast<uint64_t>(latency.count() > 0 ? latency.count() / 1000 : 0);
+      size_t bin = 0;
+      while(microSeconds != 0 && bin < N_LATENCY_BINS - 1) {
+        microSeconds >>= 1;
+        ++bin;
+      }
+      return bin;
+    }
+
+    /** The upper limit of the bin which contains the given fraction (between 0 and 1) of the
+     *  completed transactions, e.g. 0.99 for the 99th percentile. 0 if there are none.
+     */
+    std::chrono::microseconds getLatencyPercentile(double fraction) const {
+      uint64_t nCompleted = 0;
+      for(auto n : latencyHistogram) {
+        nCompleted += n;
+      }
+      if(nCompleted == 0) {
+        return std::chrono::microseconds(0);
+      }
+      uint64_t sum = 0;
+      for(size_t bin = 0; bin < N_LATENCY_BINS; ++bin) {
+        sum += latencyHistogram[bin];
+        if(sum > 0 && static_cast<double>(sum) >= fraction * static_cast<double>(nCompleted)) {
+          return getBinUpperLimit(bin);
+        }
+      }
+      return getBinUpperLimit(N_LATENCY_BINS - 1);
+    }
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_SPI_TRANSACTION_COUNTERS_H
@@ -37,6 +37,12 @@ namespace mtca4u { namespace tmc429 {
   uint32_t const IDX_POSITION_LATCHED = 0xE;
   uint32_t const IDX_MICRO_STEP_COUNT = 0xF;
 
+  // values of the RampMode in IDX_REFERENCE_CONFIG_AND_RAMP_MODE
+  uint32_t const RAMP_MODE_RAMP = 0x0;
+  uint32_t const RAMP_MODE_SOFT = 0x1;
+  uint32_t const RAMP_MODE_VELOCITY = 0x2;
+  uint32_t const RAMP_MODE_HOLD = 0x3;
+
   uint32_t const RW_WRITE = 0;
   uint32_t const RW_READ = 1;
 
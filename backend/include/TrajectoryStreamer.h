@@ -0,0 +1,138 @@
+#ifndef MTCA4U_TRAJECTORY_STREAMER_H
+#define MTCA4U_TRAJECTORY_STREAMER_H
+
+#include "MotorControler.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mtca4u {
+
+  class MotorControlerExpert;
+
+  /// One point of a trajectory for the TrajectoryStreamer
+  struct TrajectoryPoint {
+    /// Time since the start of the trajectory
+    std::chrono::microseconds time;
+    /// Position in steps, like MotorControler::setTargetPosition()
+    int position;
+    /// Velocity in the units of MotorControler::setTargetVelocity(). Only used in velocity mode.
+    int velocity;
+  };
+
+  /** Streams a precomputed trajectory to one motor.
+   *
+   *  A feeder thread samples the trajectory at a fixed update period, interpolating
+   *  linearly between the points, and sends the setpoint to the controler:
+   *  <ul>
+   *  <li> Mode::POSITION: The interpolated position is written as target position.
+   *       The ramp generator of the controler follows it within its velocity and
+   *       acceleration limits. Each update costs one SPI transaction while the motor
+   *       is moving. </li>
+   *  <li> Mode::VELOCITY: The controler is switched to velocity mode and the
+   *       interpolated velocity is written as target velocity, corrected by the
+   *       position error times the position gain. Needs a MotorControlerExpert. </li>
+   *  </ul>
+   *  With each update the actual position is read and compared to the interpolated
+   *  position. The tracking error and the timing of the updates are available as
+   *  statistics.
+   *
+   *  When the end of the trajectory is reached, the target position is set to the
+   *  last point. In velocity mode the original ramp mode is restored, so the ramp
+   *  generator moves the motor to exactly this position. If the streaming is
+   *  stopped before, the target position is set to the actual position.
+   *
+   *  The feeder thread is a normal thread. Its timing depends on the load of the
+   *  machine, which is why the lateness of the updates is recorded.
+   */
+  class TrajectoryStreamer {
+   public:
+    enum class Mode { POSITION, VELOCITY };
+
+    struct Statistics {
+      /// Number of setpoints sent, including the final one
+      size_t nUpdates{0};
+      /// Delay of the updates w.r.t. their scheduled time
+      std::chrono::microseconds maximumLateness{0};
+      std::chrono::microseconds averageLateness{0};
+      /// Interpolated position minus actual position, in steps
+      int lastTrackingError{0};
+      int maximumTrackingError{0}; ///< largest absolute value
+      double rmsTrackingError{0};
+    };
+
+    TrajectoryStreamer(boost::shared_ptr<MotorControler> const& motorControler, Mode mode = Mode::POSITION,
+        std::chrono::microseconds updatePeriod = std::chrono::milliseconds(1));
+
+    /// Stops the streaming, see stop()
+    ~TrajectoryStreamer();
+
+    TrajectoryStreamer(TrajectoryStreamer const&) = delete;
+    TrajectoryStreamer& operator=(TrajectoryStreamer const&) = delete;
+
+    /** Start streaming the trajectory. The time of the first point must not be negative,
+     *  and the times must be strictly increasing. The time 0 is now. Throws a logic_error
+     *  if the trajectory is invalid or the streamer is already running.
+     */
+    void start(std::vector<TrajectoryPoint> trajectory);
+
+    /// Stop the streaming before the end of the trajectory. The motor stops at its actual position.
+    void stop();
+
+    bool isRunning();
+
+    /** Wait until the end of the trajectory has been reached or the streaming has been
+     *  stopped. Rethrows the exception if the streaming was aborted because of an
+     *  error, e.g. a ChimeraTK::runtime_error from the device.
+     */
+    void waitUntilFinished();
+
+    /// Statistics of the current or last trajectory
+    Statistics getStatistics();
+
+    /// Velocity correction per step of tracking error in velocity mode. Default is 0, no correction.
+    void setPositionGain(double positionGain);
+
+    Mode getMode() const { return _mode; }
+    std::chrono::microseconds getUpdatePeriod() const { return _updatePeriod; }
+
+   private:
+    boost::shared_ptr<MotorControler> _motorControler;
+    // only set in velocity mode
+    boost::shared_ptr<MotorControlerExpert> _motorControlerExpert;
+    Mode _mode;
+    std::chrono::microseconds _updatePeriod;
+
+    std::vector<TrajectoryPoint> _trajectory;
+    std::thread _feederThread;
+    // serialises start(), stop() and joining the feeder thread
+    std::mutex _controlMutex;
+
+    // protects the variables below, shared with the feeder thread
+    std::mutex _mutex;
+    std::condition_variable _stopCondition;
+    bool _stopRequested;
+    bool _isRunning;
+    double _positionGain;
+    std::exception_ptr _error;
+    Statistics _statistics;
+    std::chrono::microseconds::rep _sumOfLateness;
+    double _sumOfSquaredErrors;
+
+    void feederThreadFunction();
+    TrajectoryPoint interpolate(std::chrono::microseconds time) const;
+    void sendSetpoint(TrajectoryPoint const& setpoint, int actualPosition);
+    void finishMotion(int targetPosition, unsigned int originalRampMode);
+    void recordUpdate(std::chrono::microseconds lateness, int trackingError);
+    static void checkTrajectory(std::vector<TrajectoryPoint> const& trajectory);
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_TRAJECTORY_STREAMER_H
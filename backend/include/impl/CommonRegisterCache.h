@@ -0,0 +1,80 @@
+#ifndef MTCA4U_COMMON_REGISTER_CACHE_H
+#define MTCA4U_COMMON_REGISTER_CACHE_H
+
+#include "TMC429SPI.h"
+#include "TMC429Words.h"
+
+#include <ChimeraTK/Device.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace mtca4u {
+
+  /** A short-lived copy of the TMC429 words which contain the data of all motors
+   * of a card: the controler status word (a PCIe register) and the reference
+   * switch word (JDX_REFERENCE_SWITCH, read via SPI).
+   *
+   * The cache is owned by the MotorDriverCardImpl and shared by its
+   * MotorControlerImpls, so motors which are polled together only read the
+   * common words once per maximum age. A word is read again if it is older than
+   * the maximum age, or if anything has been written to the controler SPI since
+   * it has been read (see TMC429SPI::getWriteCount()). Changes which do not go
+   * through the controler SPI of this process, for instance the end of a move or
+   * writes of other processes, are seen after the maximum age at the latest.
+   *
+   * With a maximum age of 0, which is the default, every request reads the
+   * hardware.
+   *
+   * The cache is thread safe. Concurrent requests for an outdated word wait for
+   * the first one to read it.
+   */
+  class CommonRegisterCache {
+   public:
+    CommonRegisterCache(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
+        boost::shared_ptr<TMC429SPI> const& controlerSPI);
+
+    CommonRegisterCache(CommonRegisterCache const&) = delete;
+    CommonRegisterCache& operator=(CommonRegisterCache const&) = delete;
+
+    /// Changing the maximum age discards the cached words. Throws a logic_error if it is negative.
+    void setMaximumAge(std::chrono::microseconds maximumAge);
+    std::chrono::microseconds getMaximumAge();
+
+    TMC429StatusWord getControlerStatusWord();
+
+    /// The data of the JDX_REFERENCE_SWITCH word, two bits per motor
+    unsigned int getReferenceSwitchWord();
+
+    /// Read all words again on their next request
+    void invalidate();
+
+   private:
+    struct Entry {
+      unsigned int data{0};
+      std::chrono::steady_clock::time_point readTime{};
+      // the write count of the controler SPI before the word was read
+      uint64_t writeCount{0};
+      bool valid{false};
+    };
+
+    boost::shared_ptr<TMC429SPI> _controlerSPI;
+
+    // Protects all members below
+    std::mutex _mutex;
+    ChimeraTK::ScalarRegisterAccessor<int32_t> _controlerStatusRegister;
+    std::chrono::microseconds _maximumAge;
+    Entry _controlerStatus;
+    Entry _referenceSwitch;
+
+    /// True if the entry can be used. The _mutex must be held.
+    bool isUpToDate(Entry const& entry) const;
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_COMMON_REGISTER_CACHE_H
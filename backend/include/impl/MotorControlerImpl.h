@@ -1,17 +1,26 @@
 #ifndef MTCA4U_MOTOR_CONTROLER_IMPL_H
 #define MTCA4U_MOTOR_CONTROLER_IMPL_H
 
+#include "CommonRegisterCache.h"
 #include "MotorControlerConfig.h"
 #include "MotorControlerExpert.h"
+#include "RegisterShadow.h"
+#include "SeqLock.h"
 #include "SignedIntConverter.h"
+#include "SpiArbitration.h"
 #include "SPIviaPCIe.h"
 #include "TMC429SPI.h"
 
 #include <ChimeraTK/Device.h>
+#include <ChimeraTK/TransferGroup.h>
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace mtca4u {
   class MotorDriverCardImpl;
@@ -24,16 +33,46 @@ namespace mtca4u {
      * internally, so the object stays valid even if the original shared pointer
      * goes out of scope. The config is only used in the constuctor, no reference
      * is kept in the class.
+     *
+     * The TMC429 registers are written in a batch transfer. With differentialInit
+     * they are read back first and only the ones which differ from the config are
+     * written. The TMC260 driver registers cannot be read back and are always
+     * written.
+     *
+     * With deferDriverInitialisation the driver registers are not written and the
+     * motor is not enabled in the constructor. This has to be done by calling
+     * initialiseDriver() afterwards, which allows the MotorDriverCardImpl to
+     * initialise the drivers of all motors concurrently.
+     *
+     * If a register shadow is given, the driver registers are stored in it and
+     * the getters return its content, which also reflects writes by other
+     * processes. With differentialInit the driver registers whose shadow matches
+     * the config are not written again, provided that none of the TMC429
+     * registers of the motor had to be written (otherwise the card has probably
+     * been power cycled and the shadow is outdated).
+     *
+     * If an SPI arbitration is given, the driver SPI is arbitrated between
+     * processes, see SPIviaPCIe::setInterprocessArbitration().
+     *
+     * The common register cache is shared by all motors of the card. If none is
+     * given, the motor uses a cache of its own.
      */
     MotorControlerImpl(unsigned int ID, boost::shared_ptr<ChimeraTK::Device> const& device,
         std::string const& moduleName, boost::shared_ptr<TMC429SPI> const& controlerSPI,
-        MotorControlerConfig const& motorControlerConfig);
+        MotorControlerConfig const& motorControlerConfig, bool differentialInit = false,
+        bool deferDriverInitialisation = false,
+        boost::shared_ptr<RegisterShadow> const& registerShadow = boost::shared_ptr<RegisterShadow>(),
+        boost::shared_ptr<SpiArbitration> const& spiArbitration = boost::shared_ptr<SpiArbitration>(),
+        boost::shared_ptr<CommonRegisterCache> const& commonRegisterCache = boost::shared_ptr<CommonRegisterCache>());
 
     /// The class is non-copyable
     MotorControlerImpl(MotorControlerImpl const&) = delete;
     /// The class is non-assignable
     MotorControlerImpl& operator=(MotorControlerImpl const&) = delete;
 
+    /// Stops the readback refresher if it is running.
+    ~MotorControlerImpl() override;
+
     unsigned int getID() override;
     int getActualPosition() override;
     int getActualVelocity() override;
@@ -126,6 +165,8 @@ namespace mtca4u {
     void setEndSwitchPowerEnabled(bool enable = true) override;
     bool isEndSwitchPowerEnabled() override;
 
+    void emergencyStop() override;
+
     /**
      * @brief Returns True if the motor is in motion or False if at
      * standstill. This command is reliable as long as the motor is not stalled.
@@ -140,6 +181,11 @@ namespace mtca4u {
      * chip has stopped with the STEP pulses, the stand still indicator
      * concludes that the movement is complete.
      *
+     * At the target position the answer only needs PCIe reads of the controler
+     * status word and the driver status. Otherwise the interrupt flags, the
+     * position and the reference switches are read via SPI, because the
+     * reference switch bit in the status word only reports one of the switches.
+     *
      * This method has a minimum internal delay of COMMUNICATION_DELAY before
      * returning. This delay compensates for the time it takes for the
      * standstill indicator bit to be updated after the X_TARGET register on the
@@ -157,6 +203,20 @@ namespace mtca4u {
     void setTargetPosition(int steps) override;
     int getTargetPosition() override;
 
+    /** Prepare the SPI words for a new target position like setTargetPosition(), but
+     * do not write them. The caller must write the words in the given order, and
+     * afterwards pass them to confirmTargetPositionWords() with their transfer status.
+     * Used by the MotorDriverCardImpl to start several motors in one batch transfer.
+     */
+    std::vector<TMC429InputWord> createTargetPositionWords(int steps);
+
+    /** Update the local state for the words of createTargetPositionWords() which have
+     * been written. status points to the status of the first word, see
+     * SPIviaPCIe::writeBatch(). Words after a failed one are ignored.
+     */
+    void confirmTargetPositionWords(
+        std::vector<TMC429InputWord> const& inputWords, SPIviaPCIe::TransferStatus const* status);
+
     void setMinimumVelocity(unsigned int stepsPerFIXME) override;
     unsigned int getMinimumVelocity() override;
 
@@ -208,6 +268,17 @@ namespace mtca4u {
 
     unsigned int getReferenceSwitchBit() override;
 
+    MotorStatusSnapshot readAllStatus() override;
+
+    void startReadbackRefresher(std::chrono::microseconds refreshPeriod) override;
+    void stopReadbackRefresher() override;
+    bool isReadbackRefresherRunning() override;
+    MotorStatusSnapshot getReadbackSnapshot() override;
+
+    SpiTransactionCounters getDriverSpiCounters() const override;
+    void resetDriverSpiCounters() override;
+    SpiTransactionCounters getControlerSpiCounters() const override;
+
    private:
     static const unsigned int COMMUNICATION_DELAY = 20000; /// in microseconds
     // Reason for mtable keyword:
@@ -231,13 +302,21 @@ namespace mtca4u {
     constexpr static int iMaxTMC260C_CURRENT_SCALE_VALUES = 32;
     constexpr static unsigned int iMaxTMC260C_MIN_CURRENT_SCALE_VALUE = 0;
 
-    // FIXME: These variables have to be stored uniquely inter process
-    DriverControlData _driverControlData;
-    ChopperControlData _chopperControlData;
-    CoolStepControlData _coolStepControlData;
-    StallGuardControlData _stallGuardControlData;
-    DriverConfigData _driverConfigData;
-
+    // Local copies of the write-only driver registers. If there is a register
+    // shadow they are updated from it in the getters, so they are mutable.
+    mutable DriverControlData _driverControlData;
+    mutable ChopperControlData _chopperControlData;
+    mutable CoolStepControlData _coolStepControlData;
+    mutable StallGuardControlData _stallGuardControlData;
+    mutable DriverConfigData _driverConfigData;
+
+    // optional, shares the driver registers between processes
+    boost::shared_ptr<RegisterShadow> _registerShadow;
+    // true if the driver registers which match the shadow are not written in initialiseDriver()
+    bool _skipUnchangedDriverData;
+
+    // The controler status and reference switch words for the queries. moveHasEnded() always reads _controlerStatus.
+    boost::shared_ptr<CommonRegisterCache> _commonRegisterCache;
     ChimeraTK::ScalarRegisterAccessor<int32_t> _controlerStatus;
     ChimeraTK::ScalarRegisterAccessor<int32_t> _actualPosition;
     ChimeraTK::ScalarRegisterAccessor<int32_t> _actualVelocity;
@@ -260,13 +339,18 @@ namespace mtca4u {
     static const unsigned int MD_22_DEFAULT_CLOCK_FREQ_MHZ = 32;
 
     template<class T>
-    T readTypedRegister();
+    T readTypedRegister(SPIviaPCIe::Priority priority = SPIviaPCIe::Priority::DIAGNOSTICS);
 
-    void writeTypedControlerRegister(TMC429InputWord inputWord);
+    void writeTypedControlerRegister(
+        TMC429InputWord inputWord, SPIviaPCIe::Priority priority = SPIviaPCIe::Priority::CONFIGURATION);
 
     template<class T>
     void setTypedDriverData(T const& driverData, T& localDataInstance);
 
+    // Write the driver data unless it is known from the register shadow to be unchanged
+    template<class T>
+    void initialiseDriverData(T const& driverData, T& localDataInstance);
+
     SignedIntConverter _converter24bits;
     SignedIntConverter _converter12bits;
 
@@ -275,8 +359,20 @@ namespace mtca4u {
     unsigned int _userMicroStepSize;
 
     int _localTargetPosition;
+    // The interrupt masks are enabled and the flags have been cleared since the last (re)configuration
+    bool _interruptsArmed;
     // bool _positiveSwitch, _negativeSwitch;
     int retrieveTargetPositonAndConvert();
+    // Target reached or stopped by a reference switch, from the controler status register
+    bool moveHasEnded();
+    // At most the interrupt word and the target position
+    static constexpr size_t MAX_TARGET_POSITION_WORDS = 2;
+    using TargetPositionWords = std::array<TMC429InputWord, MAX_TARGET_POSITION_WORDS>;
+    // The implementation of createTargetPositionWords(), the caller must hold _mutex. Fills a fixed size array, so
+    // setTargetPosition() does not allocate, and returns the number of words.
+    size_t targetPositionWords(int value, TargetPositionWords& inputWords);
+    // Update _localTargetPosition or _interruptsArmed after the word has been written. The caller must hold _mutex.
+    void commitTargetPositionWord(TMC429InputWord const& inputWord);
     int readPositionRegisterAndConvert();
     MotorReferenceSwitchData retrieveReferenceSwitchStatus();
 
@@ -293,6 +389,55 @@ namespace mtca4u {
     void roundToNextFullStep(int& targetPosition);
 
     inline unsigned int readRegisterAccessor(ChimeraTK::ScalarRegisterAccessor<int32_t>& readValue);
+
+    // Accessors in a TransferGroup cannot be read individually any more, so
+    // the status group has its own set of accessors.
+    struct StatusTransferGroup {
+      ChimeraTK::ScalarRegisterAccessor<int32_t> controlerStatus;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> actualPosition;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> actualVelocity;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> actualAcceleration;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> microStepCount;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> stallGuardValue;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> coolStepValue;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> status;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> motorCurrentEnabled;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> decoderReadoutMode;
+      ChimeraTK::ScalarRegisterAccessor<int32_t> decoderPosition;
+      ChimeraTK::TransferGroup transferGroup;
+    };
+    StatusTransferGroup _statusGroup;
+    void createStatusTransferGroup(std::string const& moduleName);
+
+    // Write the TMC429 registers from the config in a batch transfer and return the number of written
+    // registers, see TMC429SPI::writeConfiguration()
+    size_t writeControlerRegisters(MotorControlerConfig const& motorControlerConfig, bool onlyDifferences);
+
+    /** Write the TMC260 driver registers from the config and enable the motor
+     * according to it. Called by the constructor unless the driver initialisation
+     * is deferred. The driver SPI of each motor is independent, so this can run
+     * concurrently for several motors.
+     */
+    void initialiseDriver();
+    friend class MotorDriverCardImpl;
+
+    // Reads all readback registers via the status group. The caller must hold _mutex.
+    MotorStatusSnapshot readStatusSnapshot();
+    void readbackRefresherThreadFunction();
+
+    // Counts the snapshots taken, protected by _mutex
+    uint64_t _readbackUpdateCounter;
+    // Written only by the refresher thread, read lock-free by getReadbackSnapshot()
+    SeqLock<MotorStatusSnapshot> _readbackSnapshot;
+
+    // Serialises start and stop of the refresher thread
+    std::mutex _refresherControlMutex;
+    // Protects the refresher state below. Never locked while holding _mutex.
+    std::mutex _refresherMutex;
+    std::condition_variable _refresherCondition;
+    std::thread _refresherThread;
+    bool _stopRefresher;
+    std::chrono::microseconds _refreshPeriod;
   };
 
 } // namespace mtca4u
@@ -1,10 +1,13 @@
 #ifndef MTCA4U_MOTOR_DRIVER_CARD_IMPL_H
 #define MTCA4U_MOTOR_DRIVER_CARD_IMPL_H
 
+#include "CommonRegisterCache.h"
 #include "MotorControler.h"
 #include "MotorDriverCardConfig.h"
 #include "MotorDriverCardExpert.h"
 #include "PowerMonitor.h"
+#include "RegisterShadow.h"
+#include "SpiArbitration.h"
 #include "TMC429SPI.h"
 #include "TMC429Words.h"
 
@@ -23,6 +26,12 @@ namespace mtca4u {
     /// Get a reference to the power monitor.
     PowerMonitor& getPowerMonitor();
 
+    /// The words of all motors are written in one batch transfer, see TMC429SPI::write()
+    void setTargetPositions(std::map<unsigned int, int> const& targetPositions);
+
+    SpiTransactionCounters getControlerSpiCounters() const;
+    void resetControlerSpiCounters();
+
     unsigned int getControlerChipVersion();
 
     void setDatagramLowWord(unsigned int datagramLowWord);
@@ -60,6 +69,22 @@ namespace mtca4u {
      * of the TMC429 readback word.*/
     TMC429StatusWord getStatusWord();
 
+    /** Execute the TMC429 transfers of all motors in a dedicated SPI thread, with
+     * priority classes for emergency stops, motion commands, configuration and
+     * diagnostics. See SPIviaPCIe::enableTransferThread(). Must not be called while
+     * the card is in use.
+     */
+    void enableControlerSpiTransferThread(bool enable = true);
+    SPIviaPCIe::PriorityStatistics getControlerSpiPriorityStatistics(SPIviaPCIe::Priority priority) const;
+
+    /** Set the maximum age of the common TMC429 words (controler status and
+     * reference switches) which are shared by the motors, see CommonRegisterCache.
+     * The default 0 reads the hardware on each request. A maximum age of about the
+     * poll period lets motors which are polled together share the reads.
+     */
+    void setCommonRegisterMaximumAge(std::chrono::microseconds maximumAge);
+    std::chrono::microseconds getCommonRegisterMaximumAge();
+
    private:
     // Motor controlers need dynamic allocation, so we cannot store them directly.
     // As we do not want to care about cleaning up we use shared pointers.
@@ -71,7 +96,8 @@ namespace mtca4u {
 
     boost::shared_ptr<TMC429SPI> _controlerSPI;
 
-    ChimeraTK::ScalarRegisterAccessor<int32_t> _controlerStatusRegister;
+    // shared with the motor controlers
+    boost::shared_ptr<CommonRegisterCache> _commonRegisterCache;
 
     std::string _moduleName;
 
@@ -79,11 +105,20 @@ namespace mtca4u {
     /// (too old or too new)
     void checkFirmwareVersion();
 
+    /// Writes the common registers in a batch transfer, see TMC429SPI::writeConfiguration()
+    void writeCommonRegisters(MotorDriverCardConfig const& cardConfiguration, bool onlyDifferences);
+
     /// The constructor requires a working version of MtcaDevice in addition
     /// to the configuration. These are provided by the factory. The constructor
     /// is private, so the class can only be generated by the factory.
+    /// With differentialInit only the TMC429 registers which differ from the
+    /// configuration are written, see MotorDriverCardFactory::setDifferentialInit().
+    /// The optional register shadow is used by the motor controlers, see MotorControlerImpl.
+    /// With the optional SPI arbitration all SPIs of the card are arbitrated between processes.
     MotorDriverCardImpl(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
-        MotorDriverCardConfig const& cardConfiguration);
+        MotorDriverCardConfig const& cardConfiguration, bool differentialInit = false,
+        boost::shared_ptr<RegisterShadow> const& registerShadow = boost::shared_ptr<RegisterShadow>(),
+        boost::shared_ptr<SpiArbitration> const& spiArbitration = boost::shared_ptr<SpiArbitration>());
 
     /// The class is non-copyable
     MotorDriverCardImpl(MotorDriverCardImpl const&) = delete;
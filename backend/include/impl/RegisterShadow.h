@@ -0,0 +1,67 @@
+#ifndef MTCA4U_REGISTER_SHADOW_H
+#define MTCA4U_REGISTER_SHADOW_H
+
+#include "SharedMemoryUtilities.h"
+#include "TMC260Words.h"
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include <string>
+
+namespace mtca4u {
+
+  /** A copy of the write-only TMC260 driver registers of one motor driver card
+   * in shared memory.
+   *
+   * The TMC260 registers cannot be read back, so the last written values are
+   * stored. In shared memory they are seen by all processes using the same card,
+   * and they survive a restart of the process. The shadow is identified by the
+   * device alias and the module name. It is created on first use and not removed
+   * when the object is destroyed, see remove().
+   *
+   * The shadow is protected by a robust interprocess mutex, so a process which
+   * dies while holding it does not block the others. The registers are stored
+   * word by word, so the content stays consistent in this case.
+   *
+   * The shadow only knows what has been written through it. If the card is power
+   * cycled, or other software writes to the drivers, it is outdated.
+   */
+  class RegisterShadow {
+   public:
+    RegisterShadow(std::string const& deviceAlias, std::string const& moduleName);
+
+    RegisterShadow(RegisterShadow const&) = delete;
+    RegisterShadow& operator=(RegisterShadow const&) = delete;
+
+    /// Remember the data word of the driver register. The register is determined
+    /// from the address of the word.
+    void storeDriverWord(unsigned int motorId, TMC260Word const& driverWord);
+
+    /** Set the data word of driverWord to the stored content of the register with
+     * the address of driverWord. Returns false and leaves driverWord unchanged if
+     * the register has not been stored yet.
+     */
+    bool loadDriverWord(unsigned int motorId, TMC260Word& driverWord) const;
+
+    /// Forget the content of all registers, e.g. after the card has been power cycled.
+    void invalidate();
+
+    /// Remove the shared memory of the shadow from the system. Processes which
+    /// have it open keep on using it.
+    static void remove(std::string const& deviceAlias, std::string const& moduleName);
+
+    /// The name of the shared memory object for the given card
+    static std::string sharedMemoryName(std::string const& deviceAlias, std::string const& moduleName);
+
+   private:
+    struct Image;
+
+    boost::interprocess::managed_shared_memory _sharedMemory;
+    Image* _image;
+
+    static void checkMotorId(unsigned int motorId);
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_REGISTER_SHADOW_H
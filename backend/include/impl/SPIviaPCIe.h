@@ -1,10 +1,22 @@
 #ifndef CHIMERATK_SPI_VIA_PCIE_H
 #define CHIMERATK_SPI_VIA_PCIE_H
 
+#include "SpiTransactionCounters.h"
+
 #include <ChimeraTK/Device.h>
 
-#include <boost/thread/recursive_mutex.hpp>
+#include <boost/chrono.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
 namespace mtca4u {
+  class RobustMutex;
+  class SpiArbitration;
 
   /** This class implements synchronous SPI operation over PCIexpress, using an
    * SPI command register and a synchronisation register. Readback is optional.
@@ -14,6 +26,38 @@ namespace mtca4u {
    public:
     static unsigned int const SPI_DEFAULT_WAITING_TIME = 40; ///< microseconds
 
+    /** Result of a single spi command in a batch transfer, see writeBatch().
+     */
+    enum class TransferStatus { OK, ERROR, TIMEOUT, NOT_EXECUTED };
+
+    /** How to wait for the firmware to complete the synchronisation handshake,
+     * see setWaitStrategy().
+     */
+    enum class WaitStrategy {
+      SLEEP,          ///< Sleep between checks of the sync register (default)
+      SPIN,           ///< Check the sync register continuously without giving up the CPU
+      SPIN_THEN_YIELD ///< Spin for the expected latency, then yield the CPU between checks
+    };
+
+    /** Priority classes of the transfers, see enableTransferThread(). The
+     * highest priority comes first.
+     */
+    enum class Priority { EMERGENCY_STOP, MOTION, CONFIGURATION, DIAGNOSTICS };
+    static size_t const N_PRIORITIES = 4;
+
+    /** Latency statistics of the synchronisation handshakes. The latency is the
+     * time from writing the spi command until the firmware has reported success
+     * or an error, divided by the number of commands for batch transfers. Timed
+     * out handshakes are not included.
+     */
+    struct LatencyStatistics {
+      size_t nHandshakes{0};
+      std::chrono::nanoseconds average{0}; ///< exponentially weighted moving average
+      std::chrono::nanoseconds minimum{0};
+      std::chrono::nanoseconds maximum{0};
+      std::chrono::nanoseconds last{0};
+    };
+
     /** Constructor for write-only implementations.
      *  It intentionally is overloaded and not a version with an invalid default
      * value for the readback register because the register accessors have to be
@@ -39,16 +83,57 @@ namespace mtca4u {
         std::string const& writeRegisterName, std::string const& syncRegisterName,
         std::string const& readbackRegisterName, unsigned int spiWaitingTime = SPI_DEFAULT_WAITING_TIME);
 
-    uint32_t read(int32_t spiCommand); ///< Write the command and return the readback value.
+    /** Constructor for write and readback with batch transfers.
+     *  The batch register is an array which takes a sequence of spi commands, writing
+     * the number of commands to the batch size register starts the transfer. The
+     * protocol is described in DFMC_MD22Constants.h. If the registers are not in the
+     * map file the SPIviaPCIe is constructed anyway and writeBatch() falls back to one
+     * handshake per command.
+     */
+    SPIviaPCIe(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
+        std::string const& writeRegisterName, std::string const& syncRegisterName,
+        std::string const& readbackRegisterName, std::string const& batchRegisterName,
+        std::string const& batchSizeRegisterName, unsigned int spiWaitingTime = SPI_DEFAULT_WAITING_TIME);
+
+    ~SPIviaPCIe();
+
+    /// Write the command and return the readback value. For the priority see enableTransferThread().
+    uint32_t read(int32_t spiCommand, Priority priority = Priority::DIAGNOSTICS);
 
     /** Write the spi command. This methods blocks until the firmware has returned
      * either success or an error. In case of an error a MotorDriverException is
      * thrown. After 10 waiting cycles and checks of the synchronisation register
      * the operation is timed out and a MotorDriverException is thrown.
      *
+     *  For the priority see enableTransferThread().
+     *
      *  @throw MotorDriverException
      */
-    void write(int32_t spiCommand);
+    void write(int32_t spiCommand, Priority priority = Priority::CONFIGURATION);
+
+    /** Write a sequence of spi commands. With firmware support the commands are
+     * sent back-to-back with only one synchronisation handshake per batch (or per
+     * batch register size, if there are more commands). Otherwise each command is
+     * written with its own handshake, like in write().
+     *
+     *  The commands are executed in order, and the transfer stops at the first
+     * command which fails. Unlike write(), SPI errors and timeouts are not thrown
+     * but reported in the returned vector, which has one entry per command.
+     * Commands after a failed one are reported as NOT_EXECUTED.
+     *
+     *  Without the transfer thread the batch holds the SPI until all commands
+     * have been transferred. With the transfer thread it is executed one
+     * handshake at a time (one batch register of commands, or one command
+     * without firmware support), and requests of higher priority are executed
+     * in between. See enableTransferThread().
+     */
+    std::vector<TransferStatus> writeBatch(
+        std::vector<int32_t> const& spiCommands, Priority priority = Priority::CONFIGURATION);
+
+    /** Returns true if the firmware has the batch registers, false if writeBatch()
+     * uses the per-command fallback.
+     */
+    bool hasBatchSupport() const;
 
     /** The FPGA needs some time to perform the SPI communication to the connected
      * chip. This is the waiting time between the checks of the synchronisation
@@ -64,13 +149,136 @@ namespace mtca4u {
      */
     unsigned int getSpiWaitingTime() const;
 
+    /** Select how to wait for the synchronisation register. Sleeping can take
+     * much longer than requested on a loaded system. Spinning gives the lowest
+     * latency but occupies a CPU core during the transfer.
+     *
+     * Sleep and spin-then-yield adapt to the expected latency, which is the
+     * average in the latency statistics, or the spi waiting time as long as
+     * there is no measurement. Sleep checks the sync register first after the
+     * expected latency if it is shorter than the spi waiting time, and then
+     * sleeps the spi waiting time between 10 further checks. Spin-then-yield
+     * spins for the expected latency. Spin and spin-then-yield time out after 10
+     * times the spi waiting time.
+     */
+    void setWaitStrategy(WaitStrategy waitStrategy);
+    WaitStrategy getWaitStrategy() const;
+
+    LatencyStatistics getLatencyStatistics() const;
+    void resetLatencyStatistics();
+
+    /** Contention statistics of the interprocess arbitration, see
+     * setInterprocessArbitration().
+     */
+    struct ArbitrationStatistics {
+      size_t nLocks{0};     ///< number of transfers which have locked the interprocess mutex
+      size_t nContended{0}; ///< number of them which had to wait because another process held the mutex
+      std::chrono::nanoseconds waitingTime{0}; ///< total time spent waiting for the mutex
+      std::chrono::nanoseconds maximumWaitingTime{0};
+    };
+
+    /** Lock an interprocess mutex for each transfer, so several processes can use
+     * the same SPI without interleaving their handshakes. The mutex is taken from
+     * the arbitration of the card and identified by the write register name.
+     * Without arbitration (the default) only the threads of this process are
+     * synchronised. An empty pointer switches the arbitration off.
+     */
+    void setInterprocessArbitration(boost::shared_ptr<SpiArbitration> const& arbitration);
+
+    ArbitrationStatistics getArbitrationStatistics() const;
+    void resetArbitrationStatistics();
+
+    /** Execute all read() and write() calls in a dedicated SPI owner thread. The
+     * calling threads put their commands into a lock-free queue and wait until the
+     * owner thread has executed them. Consecutive writes of different callers are
+     * combined into one batch transfer if the firmware supports it, so the
+     * throughput under contention grows with the number of calling threads.
+     * Without the thread (the default) each caller performs its own handshake.
+     *
+     *  There is one queue per priority class. The thread always executes the
+     * requests of the highest priority which are waiting, so e.g. a burst of
+     * diagnostic reads delays an emergency stop by at most one transfer. This
+     * includes the batches of writeBatch(), which are interrupted after each
+     * handshake.
+     *
+     *  Without the thread only EMERGENCY_STOP has an effect: the transfer is
+     * done before those of other threads which are waiting for the SPI, and a
+     * running batch is interrupted after the handshake in progress. The other
+     * priorities are served in the order in which they get the SPI.
+     *
+     *  Must not be called while other threads are using this SPIviaPCIe.
+     */
+    void enableTransferThread(bool enable = true);
+    bool hasTransferThread() const;
+
+    /** Statistics of one priority class of the transfer thread. The latency is the
+     * time from submitting a request until it has been executed, including the
+     * time it has been waiting in the queue.
+     */
+    struct PriorityStatistics {
+      size_t nRequests{0};
+      size_t queueDepth{0}; ///< number of requests waiting at the moment
+      size_t maximumQueueDepth{0};
+      std::chrono::nanoseconds averageLatency{0};
+      std::chrono::nanoseconds maximumLatency{0};
+    };
+
+    /// Empty without the transfer thread
+    PriorityStatistics getPriorityStatistics(Priority priority) const;
+    void resetPriorityStatistics();
+
+    /** Counters of all transactions, see SpiTransactionCounters. They are recorded
+     * with relaxed atomic operations and can be read and reset at any time without
+     * blocking the transfers. Counters of transfers which are in progress while the
+     * counters are read or reset might be incomplete.
+     */
+    SpiTransactionCounters getTransactionCounters() const;
+    void resetTransactionCounters();
+
    private:
     // No need to keep an instance of the  shared pointer. Each accessor has one.
     ChimeraTK::ScalarRegisterAccessor<int32_t> _writeRegister;
     ChimeraTK::ScalarRegisterAccessor<int32_t> _synchronisationRegister;
     ChimeraTK::ScalarRegisterAccessor<int32_t> _readbackRegister;
+    // optional, stay uninitialised if the firmware does not support batch transfers
+    ChimeraTK::OneDRegisterAccessor<int32_t> _batchRegister;
+    ChimeraTK::ScalarRegisterAccessor<int32_t> _batchSizeRegister;
 
     static void sleepMicroSeconds(unsigned int microSeconds);
+
+    /** Perform the handshake for one spi command (including the retries) and
+     * return the content of the synchronisation register afterwards.
+     */
+    int32_t transferWord(int32_t spiCommand);
+
+    /** Perform the handshake for one spi command and throw if it has failed. The
+     * caller must hold the _spiMutex and the arbitration lock.
+     */
+    void transferWordOrThrow(int32_t spiCommand);
+
+    /// Throw if the content of the synchronisation register after the transfer
+    /// of the spi command signals an error or a timeout.
+    void checkSynchronisation(int32_t synchronisation, int32_t spiCommand) const;
+
+    /// Implementation of writeBatch(). The caller must hold the _spiMutex and the arbitration lock.
+    void writeBatchUnlocked(std::vector<int32_t> const& spiCommands, std::vector<TransferStatus>& status);
+
+    /** Transfer the commands of a batch starting at nDone with one handshake (and
+     * its retries), and advance nDone by the number of executed commands. Returns
+     * false if a command has failed, its status is set accordingly. The caller must
+     * hold the _spiMutex and the arbitration lock.
+     */
+    bool transferBatchChunk(
+        std::vector<int32_t> const& spiCommands, size_t& nDone, std::vector<TransferStatus>& status);
+
+    /// Read the readback register after a successful transfer of a read command
+    uint32_t readback();
+
+    /** Poll the synchronisation register until it is no longer SPI_SYNC_REQUESTED
+     * or the transfer of nCommands has timed out, and update the latency
+     * statistics. The start time is the time when the transfer was triggered.
+     */
+    void waitForSynchronisation(size_t nCommands, std::chrono::steady_clock::time_point start);
     /** Time in microseconds to wait for the transaction to be finished on the SPI
      * bus
      */
@@ -82,7 +290,51 @@ namespace mtca4u {
     std::string _writeRegisterName;
     std::string _syncRegisterName;
 
-    mutable boost::recursive_mutex _spiMutex;
+    WaitStrategy _waitStrategy;
+    LatencyStatistics _latencyStatistics;
+
+    // optional, see setInterprocessArbitration()
+    boost::shared_ptr<SpiArbitration> _arbitration;
+    RobustMutex* _arbitrationMutex;
+    ArbitrationStatistics _arbitrationStatistics;
+
+    // Written under the _spiMutex, but read without it
+    struct AtomicTransactionCounters {
+      std::atomic<uint64_t> nTransactions{0};
+      std::atomic<uint64_t> nRetries{0};
+      std::atomic<uint64_t> nTimeouts{0};
+      std::atomic<uint64_t> nErrors{0};
+      std::atomic<uint64_t> nPollIterations{0};
+      std::array<std::atomic<uint64_t>, SpiTransactionCounters::N_LATENCY_BINS> latencyHistogram{};
+    };
+    AtomicTransactionCounters _transactionCounters;
+
+    /// Count a transaction which has ended with the current content of the synchronisation register
+    void countTransaction(std::chrono::nanoseconds latency, uint64_t nPollIterations);
+    /// The average latency, or the spi waiting time as long as no handshake has been measured
+    std::chrono::nanoseconds getExpectedLatency() const;
+    void countRetry();
+
+    /// Locks the interprocess mutex, if there is one, and updates the statistics.
+    /// The _spiMutex must be held.
+    class ArbitrationLock;
+
+    mutable std::mutex _spiMutex;
+
+    /** Lock the _spiMutex. Without the transfer thread an emergency stop takes
+     * precedence: other callers wait until the waiting emergency stops have the
+     * mutex.
+     */
+    std::unique_lock<std::mutex> lockSpi(Priority priority);
+    void waitForEmergencyStops();
+    std::atomic<size_t> _nWaitingEmergencyStops{0};
+    std::mutex _emergencyStopMutex;
+    std::condition_variable _emergencyStopCondition;
+
+    // optional, see enableTransferThread(). Declared last, so the thread is stopped
+    // before the rest is destroyed.
+    class TransferThread;
+    std::unique_ptr<TransferThread> _transferThread;
   };
 
 } // namespace mtca4u
@@ -0,0 +1,75 @@
+#ifndef MTCA4U_SEQ_LOCK_H
+#define MTCA4U_SEQ_LOCK_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mtca4u {
+
+  /**
+   * A sequence lock protecting a trivially copyable value.
+   *
+   * One writer publishes a new value with store(), any number of readers get a
+   * consistent copy with load() without ever blocking the writer or each other.
+   * A reader which overlaps with a store() simply retries. The value is kept in
+   * an array of atomic words, so the concurrent access is well defined.
+   *
+   * @attention store() must not be called concurrently from several threads.
+   */
+  template<class T>
+  class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+   public:
+    explicit SeqLock(T const& initialValue = T()) : _sequence(0) { store(initialValue); }
+
+    SeqLock(SeqLock const&) = delete;
+    SeqLock& operator=(SeqLock const&) = delete;
+
+    /// Publish a new value. Only one thread at a time may call this function.
+    void store(T const& value) {
+      uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+      // an odd sequence number marks a store in progress
+      _sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      std::array<uint32_t, N_WORDS> words{};
+      std::memcpy(words.data(), &value, sizeof(T));
+      for(size_t i = 0; i < N_WORDS; ++i) {
+        _words[i].store(words[i], std::memory_order_relaxed);
+      }
+
+      _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// Get a consistent copy of the last published value. Never blocks.
+    T load() const {
+      std::array<uint32_t, N_WORDS> words;
+      uint32_t sequenceBefore, sequenceAfter;
+      do {
+        sequenceBefore = _sequence.load(std::memory_order_acquire);
+        for(size_t i = 0; i < N_WORDS; ++i) {
+          words[i] = _words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        sequenceAfter = _sequence.load(std::memory_order_relaxed);
+      } while((sequenceBefore & 1) || (sequenceBefore != sequenceAfter));
+
+      T value;
+      std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+      return value;
+    }
+
+   private:
+    static constexpr size_t N_WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> _sequence;
+    std::array<std::atomic<uint32_t>, N_WORDS> _words;
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_SEQ_LOCK_H
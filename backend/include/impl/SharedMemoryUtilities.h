@@ -0,0 +1,50 @@
+#ifndef MTCA4U_SHARED_MEMORY_UTILITIES_H
+#define MTCA4U_SHARED_MEMORY_UTILITIES_H
+
+#include <pthread.h>
+
+#include <string>
+
+namespace mtca4u {
+
+  /** A mutex which can be placed in shared memory and used by several processes.
+   *
+   * It is robust: if a process dies while holding the mutex, the next lock()
+   * succeeds instead of blocking forever. The data protected by the mutex must
+   * stay consistent in this case, e.g. because it is only modified word by word
+   * or because the hardware transfer it protects is simply repeated.
+   *
+   * The mutex satisfies the Lockable requirements, so it can be used with
+   * std::lock_guard and std::unique_lock. It is not recursive.
+   */
+  class RobustMutex {
+   public:
+    RobustMutex();
+    ~RobustMutex();
+
+    RobustMutex(RobustMutex const&) = delete;
+    RobustMutex& operator=(RobustMutex const&) = delete;
+
+    /// @throw ChimeraTK::runtime_error if the mutex cannot be locked
+    void lock();
+    bool try_lock();
+    void unlock();
+
+   private:
+    pthread_mutex_t _mutex;
+
+    // make the mutex usable again if the previous owner has died. Returns false for other errors.
+    bool handleLockResult(int result);
+  };
+
+  /** Create the name of a shared memory object for the card with the given device
+   * alias and module name. The name only contains characters which are valid in a
+   * file name. The prefix should contain a version number which is increased if
+   * the layout of the shared memory changes.
+   */
+  std::string createSharedMemoryName(
+      std::string const& prefix, std::string const& deviceAlias, std::string const& moduleName);
+
+} // namespace mtca4u
+
+#endif // MTCA4U_SHARED_MEMORY_UTILITIES_H
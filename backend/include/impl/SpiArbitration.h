@@ -0,0 +1,49 @@
+#ifndef MTCA4U_SPI_ARBITRATION_H
+#define MTCA4U_SPI_ARBITRATION_H
+
+#include "SharedMemoryUtilities.h"
+
+#include <boost/interprocess/managed_shared_memory.hpp>
+
+#include <string>
+
+namespace mtca4u {
+
+  /** Arbitrates the access to the SPIs of one motor driver card between
+   * processes.
+   *
+   * The MotorDriverCardFactory only guarantees one card instance per process.
+   * If several processes use the same card, their SPI handshakes must not
+   * interleave. The SpiArbitration provides one RobustMutex per SPI in shared
+   * memory, identified by the device alias and the module name. The SPIviaPCIe
+   * locks it for each transfer, see SPIviaPCIe::setInterprocessArbitration().
+   *
+   * The shared memory is created on first use and not removed when the object is
+   * destroyed, see remove().
+   */
+  class SpiArbitration {
+   public:
+    SpiArbitration(std::string const& deviceAlias, std::string const& moduleName);
+
+    SpiArbitration(SpiArbitration const&) = delete;
+    SpiArbitration& operator=(SpiArbitration const&) = delete;
+
+    /** Get the mutex for the SPI with the given name (e.g. the name of its write
+     * register). The reference is valid as long as this object exists.
+     */
+    RobustMutex& getMutex(std::string const& spiName);
+
+    /// Remove the shared memory from the system. Processes which have it open
+    /// keep on using it.
+    static void remove(std::string const& deviceAlias, std::string const& moduleName);
+
+    /// The name of the shared memory object for the given card
+    static std::string sharedMemoryName(std::string const& deviceAlias, std::string const& moduleName);
+
+   private:
+    boost::interprocess::managed_shared_memory _sharedMemory;
+  };
+
+} // namespace mtca4u
+
+#endif // MTCA4U_SPI_ARBITRATION_H
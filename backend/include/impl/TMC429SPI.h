@@ -4,6 +4,9 @@
 #include "SPIviaPCIe.h"
 #include "TMC429Words.h"
 
+#include <atomic>
+#include <cstdint>
+
 namespace mtca4u {
   /** This class implements the special format of the SPI registers in the TPC429
    * chip.
@@ -14,12 +17,61 @@ namespace mtca4u {
         std::string const& writeRegisterName, std::string const& syncRegisterName,
         std::string const& readbackRegisterName, unsigned int spiWaitingTime = SPIviaPCIe::SPI_DEFAULT_WAITING_TIME);
 
-    TMC429OutputWord read(unsigned int smda, unsigned int idx_jdx);
-    void write(unsigned int smda, unsigned int idx_jdx, unsigned int data);
-    void write(TMC429InputWord const& writeWord);
+    /// Constructor with batch transfers, see SPIviaPCIe.
+    TMC429SPI(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
+        std::string const& writeRegisterName, std::string const& syncRegisterName,
+        std::string const& readbackRegisterName, std::string const& batchRegisterName,
+        std::string const& batchSizeRegisterName, unsigned int spiWaitingTime = SPIviaPCIe::SPI_DEFAULT_WAITING_TIME);
+
+    /// For the priorities see SPIviaPCIe::enableTransferThread()
+    TMC429OutputWord read(unsigned int smda, unsigned int idx_jdx,
+        SPIviaPCIe::Priority priority = SPIviaPCIe::Priority::DIAGNOSTICS);
+    void write(unsigned int smda, unsigned int idx_jdx, unsigned int data,
+        SPIviaPCIe::Priority priority = SPIviaPCIe::Priority::CONFIGURATION);
+    void write(TMC429InputWord const& writeWord, SPIviaPCIe::Priority priority = SPIviaPCIe::Priority::CONFIGURATION);
+
+    /** Write several words in one batch transfer. See SPIviaPCIe::writeBatch() for
+     * the meaning of the returned status and the priority.
+     */
+    std::vector<SPIviaPCIe::TransferStatus> write(std::vector<TMC429InputWord> const& writeWords,
+        SPIviaPCIe::Priority priority = SPIviaPCIe::Priority::CONFIGURATION);
+
+    /** Write a set of configuration words in batch transfers. With onlyDifferences
+     * the registers are read back first and only the words whose data differ are
+     * written. The datagram words do not read back what has been written and are
+     * always written. Returns the number of written words.
+     *
+     *  @throw ChimeraTK::runtime_error if one of the writes fails
+     */
+    size_t writeConfiguration(std::vector<TMC429InputWord> const& writeWords, bool onlyDifferences = false);
+
+    /// See SPIviaPCIe::setInterprocessArbitration()
+    void setInterprocessArbitration(boost::shared_ptr<SpiArbitration> const& arbitration);
+    SPIviaPCIe::ArbitrationStatistics getArbitrationStatistics() const;
+
+    /// See SPIviaPCIe::enableTransferThread()
+    void enableTransferThread(bool enable = true);
+    SPIviaPCIe::PriorityStatistics getPriorityStatistics(SPIviaPCIe::Priority priority) const;
+
+    /// See SPIviaPCIe::getTransactionCounters()
+    SpiTransactionCounters getTransactionCounters() const;
+    void resetTransactionCounters();
+
+    /** The number of write requests so far, including failed ones. It is increased
+     * after the words have been written, so a word which has been read before
+     * the count has changed might be outdated. See CommonRegisterCache.
+     */
+    uint64_t getWriteCount() const { return _writeCount.load(std::memory_order_acquire); }
 
    private:
     SPIviaPCIe _spiViaPCIe;
+    std::atomic<uint64_t> _writeCount{0};
+
+    /// Increases the write count when it goes out of scope, also if the write throws
+    class WriteCounter;
+
+    /// Whether reading the register of the word returns the data which has been written to it
+    static bool readsBackWrittenData(TMC429InputWord const& word);
   };
 
 } // namespace mtca4u
@@ -0,0 +1,68 @@
+#include "impl/CommonRegisterCache.h"
+
+#include "DFMC_MD22Constants.h"
+#include "TMC429Constants.h"
+
+#include <ChimeraTK/Exception.h>
+
+namespace mtca4u {
+
+  CommonRegisterCache::CommonRegisterCache(boost::shared_ptr<ChimeraTK::Device> const& device,
+      std::string const& moduleName, boost::shared_ptr<TMC429SPI> const& controlerSPI)
+  : _controlerSPI(controlerSPI),
+    _controlerStatusRegister(device->getScalarRegisterAccessor<int32_t>(
+        moduleName + "/" + dfmc_md22::CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {ChimeraTK::AccessMode::raw})),
+    _maximumAge(0) {}
+
+  void CommonRegisterCache::setMaximumAge(std::chrono::microseconds maximumAge) {
+    if(maximumAge.count() < 0) {
+      throw ChimeraTK::logic_error("CommonRegisterCache: The maximum age must not be negative.");
+    }
+    std::lock_guard<std::mutex> guard(_mutex);
+    _maximumAge = maximumAge;
+    _controlerStatus.valid = false;
+    _referenceSwitch.valid = false;
+  }
+
+  std::chrono::microseconds CommonRegisterCache::getMaximumAge() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _maximumAge;
+  }
+
+  TMC429StatusWord CommonRegisterCache::getControlerStatusWord() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if(!isUpToDate(_controlerStatus)) {
+      _controlerStatus.writeCount = _controlerSPI->getWriteCount();
+      _controlerStatus.valid = false; // stays invalid if the read throws
+      _controlerStatusRegister.read();
+      _controlerStatus.data = static_cast<unsigned int>(static_cast<int32_t>(_controlerStatusRegister));
+      _controlerStatus.readTime = std::chrono::steady_clock::now();
+      _controlerStatus.valid = true;
+    }
+    return TMC429StatusWord(_controlerStatus.data);
+  }
+
+  unsigned int CommonRegisterCache::getReferenceSwitchWord() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    if(!isUpToDate(_referenceSwitch)) {
+      _referenceSwitch.writeCount = _controlerSPI->getWriteCount();
+      _referenceSwitch.valid = false; // stays invalid if the read throws
+      _referenceSwitch.data = _controlerSPI->read(tmc429::SMDA_COMMON, tmc429::JDX_REFERENCE_SWITCH).getDATA();
+      _referenceSwitch.readTime = std::chrono::steady_clock::now();
+      _referenceSwitch.valid = true;
+    }
+    return _referenceSwitch.data;
+  }
+
+  void CommonRegisterCache::invalidate() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _controlerStatus.valid = false;
+    _referenceSwitch.valid = false;
+  }
+
+  bool CommonRegisterCache::isUpToDate(Entry const& entry) const {
+    return entry.valid && _maximumAge.count() > 0 && entry.writeCount == _controlerSPI->getWriteCount() &&
+        std::chrono::steady_clock::now() - entry.readTime <= _maximumAge;
+  }
+
+} // namespace mtca4u
@@ -3,6 +3,8 @@
 #include "DFMC_MD22Constants.h"
 using namespace mtca4u::dfmc_md22;
 
+#include "MotorReferenceSwitchData.h"
+
 #include "TMC260DummyConstants.h"
 #include "TMC260Words.h"
 #include "TMC429DummyConstants.h"
@@ -18,7 +20,10 @@ namespace mtca4u {
   DFMC_MD22Dummy::DFMC_MD22Dummy(std::string const& mapFileName, std::string const& tmc429ControllerModuleName)
   : DummyBackend(mapFileName), _controlerSpiAddressSpace(tmc429::SIZE_OF_SPI_ADDRESS_SPACE, 0),
     _controlerSpiWriteAddress(0), _controlerSpiBar(0), _controlerSpiReadbackAddress(0), _controlerSpiSyncAddress(0),
-    _powerIsUp(true), _driverSPIs(0), _causeSpiTimeouts(false), _nSpiTimeoutsLeft(0), _causeSpiErrors(false),
+    _controlerSpiBatchAddress(0), _controlerSpiBatchSizeAddress(0), _controlerSpiBatchCapacity(0),
+    _controlerSpiHandshakeCount(0), _powerIsUp(true), _controlerStatusBar(0), _controlerStatusAddress(0),
+    _driverSPIs(0), _causeSpiTimeouts(false), _nSpiTimeoutsLeft(0), _causeSpiErrors(false),
+    _nCommandsBeforeBatchInterrupt(-1), _batchInterruptIsTimeout(false),
     _microsecondsControllerSpiDelay(tmc429::DEFAULT_DUMMY_SPI_DELAY),
     _microsecondsDriverSpiDelay(tmc260::DEFAULT_DUMMY_SPI_DELAY), _moduleName(tmc429ControllerModuleName) {}
 
@@ -58,9 +63,32 @@ namespace mtca4u {
     }
     _controlerSpiSyncAddress = registerInformation.address;
 
+    registerInformation = _registerMap.getBackendRegister(_moduleName / CONTROLER_STATUS_BITS_ADDRESS_STRING);
+    _controlerStatusBar = registerInformation.bar;
+    _controlerStatusAddress = registerInformation.address;
+
     setWriteCallbackFunction(
         controlerSpiWriteAddressRange, boost::bind(&DFMC_MD22Dummy::handleControlerSpiWrite, this));
 
+    // The batch registers are optional, they only exist in firmware with batch support.
+    _controlerSpiBatchCapacity = 0;
+    try {
+      registerInformation = _registerMap.getBackendRegister(_moduleName / CONTROLER_SPI_BATCH_ADDRESS_STRING);
+      auto batchSizeRegisterInformation =
+          _registerMap.getBackendRegister(_moduleName / CONTROLER_SPI_BATCH_SIZE_ADDRESS_STRING);
+      if(_controlerSpiBar != registerInformation.bar || _controlerSpiBar != batchSizeRegisterInformation.bar) {
+        throw ChimeraTK::logic_error("SPI write and batch addresses must be in the same bar");
+      }
+      _controlerSpiBatchAddress = registerInformation.address;
+      _controlerSpiBatchSizeAddress = batchSizeRegisterInformation.address;
+      _controlerSpiBatchCapacity = registerInformation.nElements;
+      setWriteCallbackFunction(AddressRange(batchSizeRegisterInformation),
+          boost::bind(&DFMC_MD22Dummy::handleControlerSpiBatchWrite, this));
+    }
+    catch(ChimeraTK::logic_error&) {
+      // no batch support in this map file, nothing to emulate
+    }
+
     _driverSPIs.resize(N_MOTORS_MAX);
     for(unsigned int id = 0; id < N_MOTORS_MAX; ++id) {
       setReadOnly(AddressRange(
@@ -133,6 +161,12 @@ namespace mtca4u {
     setReadOnly(addressRange.bar, addressRange.offset, 1);
   }
 
+  void DFMC_MD22Dummy::setDriverSpiRegistersForTesting() {
+    for(unsigned int id = 0; id < N_MOTORS_MAX; ++id) {
+      setDriverSpiRegistersForTesting(id);
+    }
+  }
+
   void DFMC_MD22Dummy::setDriverSpiRegistersForTesting(unsigned int motorID) {
     for(unsigned int address = 0; address < _driverSPIs[motorID].addressSpace.size(); ++address) {
       _driverSPIs[motorID].addressSpace[address] = tmc260::testWordFromSpiAddress(address, motorID);
@@ -186,6 +220,58 @@ namespace mtca4u {
     int32_t controlerSpiWriteWord;
     read(_controlerSpiBar, _controlerSpiWriteAddress, &controlerSpiWriteWord, 4);
 
+    performControlerSpiTransfer(controlerSpiWriteWord);
+    ++_controlerSpiHandshakeCount;
+
+    value = SPI_SYNC_OK;
+    // SPI action done, write sync ok to finish the handshake
+    write(_controlerSpiBar, _controlerSpiSyncAddress, &value, 4);
+  }
+
+  void DFMC_MD22Dummy::handleControlerSpiBatchWrite() {
+    // debug functionality: cause timeouts by ignoring spi writes
+    if(checkSpiTimeoutsCounter()) {
+      return;
+    }
+    int32_t value = SPI_SYNC_ERROR;
+
+    int32_t nCommands;
+    read(_controlerSpiBar, _controlerSpiBatchSizeAddress, &nCommands, 4);
+
+    int32_t controlerSpiSyncWord;
+    read(_controlerSpiBar, _controlerSpiSyncAddress, &controlerSpiSyncWord, 4);
+
+    // debug functionality: cause errors. The first command in the batch fails.
+    if(_causeSpiErrors || controlerSpiSyncWord != SPI_SYNC_REQUESTED || nCommands < 0 ||
+        static_cast<size_t>(nCommands) > _controlerSpiBatchCapacity) {
+      write(_controlerSpiBar, _controlerSpiSyncAddress, &value, 4);
+      return;
+    }
+
+    std::vector<int32_t> controlerSpiWriteWords(nCommands);
+    read(_controlerSpiBar, _controlerSpiBatchAddress, controlerSpiWriteWords.data(), 4 * nCommands);
+
+    // the words are sent back-to-back, there is only one handshake for the whole batch
+    int32_t nNotExecuted = nCommands;
+    for(auto controlerSpiWriteWord : controlerSpiWriteWords) {
+      // debug functionality: stop in the middle of the batch
+      if(_nCommandsBeforeBatchInterrupt == nCommands - nNotExecuted) {
+        _nCommandsBeforeBatchInterrupt = -1;
+        if(!_batchInterruptIsTimeout) {
+          write(_controlerSpiBar, _controlerSpiSyncAddress, &value, 4);
+        }
+        return;
+      }
+      performControlerSpiTransfer(controlerSpiWriteWord);
+      writeRegisterWithoutCallback(_controlerSpiBar, _controlerSpiBatchSizeAddress, --nNotExecuted);
+    }
+    ++_controlerSpiHandshakeCount;
+
+    value = SPI_SYNC_OK;
+    write(_controlerSpiBar, _controlerSpiSyncAddress, &value, 4);
+  }
+
+  void DFMC_MD22Dummy::performControlerSpiTransfer(int32_t controlerSpiWriteWord) {
     TMC429InputWord inputWord(controlerSpiWriteWord);
     uint32_t controlerSpiAddress = inputWord.getADDRESS();
     if(inputWord.getRW() == RW_READ) {
@@ -202,9 +288,6 @@ namespace mtca4u {
     }
 
     triggerActionsOnControlerSpiWrite(inputWord);
-    value = SPI_SYNC_OK;
-    // SPI action done, write sync ok to finish the handshake
-    write(_controlerSpiBar, _controlerSpiSyncAddress, &value, 4);
   }
 
   void DFMC_MD22Dummy::handleDriverSpiWrite(unsigned int ID) {
@@ -308,9 +391,16 @@ namespace mtca4u {
     switch(inputWord.getSMDA()) {
       case SMDA_COMMON: // common registers are addressed by jdx
         performJdxActions(inputWord.getIDX_JDX());
+        if(inputWord.getRW() == RW_WRITE && inputWord.getIDX_JDX() == JDX_REFERENCE_SWITCH) {
+          updateReferenceSwitchBits();
+        }
         break;
       default: // motor specifix registers are addressed by idx
         performIdxActions(inputWord.getIDX_JDX());
+        if(inputWord.getRW() == RW_WRITE && inputWord.getSMDA() < N_MOTORS_MAX &&
+            (inputWord.getIDX_JDX() == IDX_TARGET_POSITION || inputWord.getIDX_JDX() == IDX_ACTUAL_POSITION)) {
+          updateTargetPositionReachedBit(inputWord.getSMDA());
+        }
     };
 
     synchroniseFpgaWithControlerSpiRegisters();
@@ -330,6 +420,44 @@ namespace mtca4u {
     // no actions defined at the moment
   }
 
+  void DFMC_MD22Dummy::updateTargetPositionReachedBit(unsigned int motorID) {
+    setControlerStatusBit(2 * motorID,
+        _controlerSpiAddressSpace.at(spiAddressFromSmdaIdxJdx(motorID, IDX_ACTUAL_POSITION)) ==
+            _controlerSpiAddressSpace.at(spiAddressFromSmdaIdxJdx(motorID, IDX_TARGET_POSITION)));
+  }
+
+  void DFMC_MD22Dummy::updateReferenceSwitchBits() {
+    unsigned int referenceSwitchWord =
+        _controlerSpiAddressSpace.at(spiAddressFromSmdaIdxJdx(SMDA_COMMON, JDX_REFERENCE_SWITCH));
+    for(unsigned int id = 0; id < N_MOTORS_MAX; ++id) {
+      // only the left (negative) switch is reported in the status word
+      MotorReferenceSwitchData switchData((referenceSwitchWord >> (2 * id)) & 0x3);
+      setControlerStatusBit(2 * id + 1, switchData.getNegativeSwitchActive());
+    }
+  }
+
+  void DFMC_MD22Dummy::setControlerStatusBit(unsigned int bit, bool value) {
+    auto& controlerStatus = _barContents[_controlerStatusBar].at(_controlerStatusAddress / sizeof(int32_t));
+    if(value) {
+      controlerStatus = static_cast<int32_t>(static_cast<uint32_t>(controlerStatus) | (1U << bit));
+    }
+    else {
+      controlerStatus = static_cast<int32_t>(static_cast<uint32_t>(controlerStatus) & ~(1U << bit));
+    }
+  }
+
+  void DFMC_MD22Dummy::setReferenceSwitchesActive(
+      unsigned int motorID, bool positiveSwitchActive, bool negativeSwitchActive) {
+    MotorReferenceSwitchData switchData;
+    switchData.setPositiveSwitchActive(positiveSwitchActive);
+    switchData.setNegativeSwitchActive(negativeSwitchActive);
+    auto& referenceSwitchWord =
+        _controlerSpiAddressSpace.at(spiAddressFromSmdaIdxJdx(SMDA_COMMON, JDX_REFERENCE_SWITCH));
+    referenceSwitchWord =
+        (referenceSwitchWord & ~(0x3U << (2 * motorID))) | (switchData.getSwitchesActiveWord() << (2 * motorID));
+    updateReferenceSwitchBits();
+  }
+
   bool DFMC_MD22Dummy::isPowerUp() {
     return _powerIsUp;
   }
@@ -341,22 +469,25 @@ namespace mtca4u {
   }
 
   void DFMC_MD22Dummy::synchroniseFpgaWithControlerSpiRegisters() {
-    for(unsigned int i = 0; i < N_MOTORS_MAX; ++i) {
-      writeControlerSpiRegisterToFpga(i, IDX_ACTUAL_POSITION, ACTUAL_POSITION_SUFFIX);
-      writeControlerSpiRegisterToFpga(i, IDX_ACTUAL_VELOCITY, ACTUAL_VELOCITY_SUFFIX);
-      writeControlerSpiRegisterToFpga(i, IDX_ACTUAL_ACCELERATION, ACTUAL_ACCELETATION_SUFFIX);
-      // writeAccelerationThresholdToFpgs( i );
-      writeControlerSpiRegisterToFpga(i, IDX_MICRO_STEP_COUNT, MICRO_STEP_COUNT_SUFFIX);
+    if(_fpgaCopyRegisters.empty()) {
+      for(unsigned int i = 0; i < N_MOTORS_MAX; ++i) {
+        addFpgaCopyRegister(i, IDX_ACTUAL_POSITION, ACTUAL_POSITION_SUFFIX);
+        addFpgaCopyRegister(i, IDX_ACTUAL_VELOCITY, ACTUAL_VELOCITY_SUFFIX);
+        addFpgaCopyRegister(i, IDX_ACTUAL_ACCELERATION, ACTUAL_ACCELETATION_SUFFIX);
+        // writeAccelerationThresholdToFpgs( i );
+        addFpgaCopyRegister(i, IDX_MICRO_STEP_COUNT, MICRO_STEP_COUNT_SUFFIX);
+      }
+    }
+    for(auto const& copyRegister : _fpgaCopyRegisters) {
+      writeRegisterWithoutCallback(copyRegister.bar, copyRegister.address,
+          static_cast<int32_t>(_controlerSpiAddressSpace[copyRegister.controlerSpiAddress]));
     }
   }
 
-  void DFMC_MD22Dummy::writeControlerSpiRegisterToFpga(unsigned int ID, unsigned int IDX, std::string suffix) {
-    unsigned int controlerSpiAddress = spiAddressFromSmdaIdxJdx(ID, IDX);
-    std::string registerName = createMotorRegisterName(ID, suffix);
-
-    auto registerInformation = _registerMap.getBackendRegister(_moduleName / registerName);
-    writeRegisterWithoutCallback(
-        registerInformation.bar, registerInformation.address, _controlerSpiAddressSpace[controlerSpiAddress]);
+  void DFMC_MD22Dummy::addFpgaCopyRegister(unsigned int ID, unsigned int IDX, std::string const& suffix) {
+    auto registerInformation = _registerMap.getBackendRegister(_moduleName / createMotorRegisterName(ID, suffix));
+    _fpgaCopyRegisters.push_back({spiAddressFromSmdaIdxJdx(ID, IDX), registerInformation.bar,
+        registerInformation.address});
   }
 
   unsigned int DFMC_MD22Dummy::readDriverSpiRegister(unsigned int motorID, unsigned int driverSpiAddress) {
@@ -384,6 +515,23 @@ namespace mtca4u {
     _causeSpiErrors = causeErrors;
   }
 
+  void DFMC_MD22Dummy::interruptNextSpiBatch(unsigned int nExecutedCommands, bool causeTimeout) {
+    _nCommandsBeforeBatchInterrupt = static_cast<int>(nExecutedCommands);
+    _batchInterruptIsTimeout = causeTimeout;
+  }
+
+  void DFMC_MD22Dummy::setControllerSpiDelay(unsigned int microseconds) {
+    _microsecondsControllerSpiDelay = microseconds;
+  }
+
+  void DFMC_MD22Dummy::setDriverSpiDelay(unsigned int microseconds) {
+    _microsecondsDriverSpiDelay = microseconds;
+  }
+
+  unsigned int DFMC_MD22Dummy::getControllerSpiHandshakeCount() {
+    return _controlerSpiHandshakeCount;
+  }
+
   bool DFMC_MD22Dummy::checkSpiTimeoutsCounter() {
     bool retVal = _causeSpiTimeouts; // the value before a possible reset.
     if(_nSpiTimeoutsLeft > 0) {
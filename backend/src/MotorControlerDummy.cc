@@ -3,6 +3,7 @@
 #include <ChimeraTK/Exception.h>
 
 #include <iostream>
+#include <thread>
 
 using LockGuard = std::lock_guard<std::mutex>;
 using UniqueLog = std::unique_lock<std::mutex>;
@@ -37,6 +38,7 @@ namespace mtca4u {
   }
 
   int MotorControlerDummy::getActualPosition() {
+    simulateRead();
     LockGuard guard(_motorControllerDummyMutex);
     return _currentPosition;
   }
@@ -62,6 +64,7 @@ namespace mtca4u {
   }
 
   bool MotorControlerDummy::isMotorMoving() {
+    simulateRead();
     LockGuard guard(_motorControllerDummyMutex);
     return (_motorCurrentEnabled && isStepping());
   }
@@ -120,6 +123,7 @@ namespace mtca4u {
   }
 
   unsigned int MotorControlerDummy::getDecoderPosition() {
+    simulateRead();
     LockGuard guard(_motorControllerDummyMutex);
     // make the negative end switch "decoder 0"
     return _hardwarePosition - _negativeEndSwitchHardwarePosition;
@@ -232,6 +236,7 @@ namespace mtca4u {
   }
 
   int MotorControlerDummy::getTargetPosition() {
+    simulateRead();
     LockGuard guard(_motorControllerDummyMutex);
     return _targetPosition;
   }
@@ -301,7 +306,13 @@ namespace mtca4u {
   }
 
   double MotorControlerDummy::getMaxSpeedCapability() {
-    throw ChimeraTK::logic_error("MotorControlerDummy::getMaxSpeedCapability() is not implemented yet!");
+    LockGuard guard(_motorControllerDummyMutex);
+    return _maxSpeedCapability;
+  }
+
+  void MotorControlerDummy::setMaxSpeedCapability(double microStepsPerSecond) {
+    LockGuard guard(_motorControllerDummyMutex);
+    _maxSpeedCapability = microStepsPerSecond;
   }
 
   double MotorControlerDummy::setUserSpeedLimit(double microStepsPerSecond) {
@@ -356,6 +367,12 @@ namespace mtca4u {
     return _endSwitchPowerEnabled;
   }
 
+  void MotorControlerDummy::emergencyStop() {
+    setMotorCurrentEnabled(false);
+    setEndSwitchPowerEnabled(false);
+    setTargetPosition(getActualPosition());
+  }
+
   bool MotorControlerDummy::isNegativeEndSwitchActive() {
     if(_bothEndSwitchesAlwaysOn) return true;
 
@@ -431,4 +448,50 @@ namespace mtca4u {
     LockGuard guard(_motorControllerDummyMutex);
     _blockMotor = state;
   }
+
+  void MotorControlerDummy::setSimulatedReadDelay(std::chrono::microseconds delay) {
+    _simulatedReadDelay = delay.count();
+  }
+
+  void MotorControlerDummy::blockNextReads(unsigned int nReads) {
+    LockGuard guard(_readBlockMutex);
+    _nReadsToBlock += nReads;
+  }
+
+  void MotorControlerDummy::releaseBlockedReads() {
+    LockGuard guard(_readBlockMutex);
+    ++_nReleases;
+    _nBlockedReads = 0;
+    _readBlockCondition.notify_all();
+  }
+
+  void MotorControlerDummy::waitForBlockedReads(unsigned int nReads) {
+    std::unique_lock<std::mutex> lock(_readBlockMutex);
+    _readBlockCondition.wait(lock, [&] { return _nBlockedReads >= nReads; });
+  }
+
+  void MotorControlerDummy::setSimulatedReadErrors(bool enable) {
+    _simulatedReadErrors = enable;
+  }
+
+  void MotorControlerDummy::simulateRead() {
+    {
+      std::unique_lock<std::mutex> lock(_readBlockMutex);
+      if(_nReadsToBlock > 0) {
+        --_nReadsToBlock;
+        ++_nBlockedReads;
+        auto nReleases = _nReleases;
+        _readBlockCondition.notify_all();
+        _readBlockCondition.wait(lock, [&] { return _nReleases != nReleases; });
+      }
+    }
+    if(_simulatedReadErrors) {
+      throw ChimeraTK::runtime_error("MotorControlerDummy: Simulated read error");
+    }
+    auto delay = _simulatedReadDelay.load();
+    if(delay > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    }
+  }
+
 } // namespace mtca4u
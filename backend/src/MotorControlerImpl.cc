@@ -9,6 +9,8 @@ using namespace mtca4u::tmc429;
 
 #include <ChimeraTK/Device.h>
 
+#include <boost/make_shared.hpp>
+
 #include <cmath>
 
 // just save some typing...
@@ -57,6 +59,9 @@ using namespace mtca4u::tmc429;
 #define DEFINE_SET_GET_TYPED_DRIVER_DATA(NAME, LOCAL_DATA_INSTANCE)                                                    \
   NAME const& MotorControlerImpl::get##NAME() const {                                                                  \
     lock_guard guard(_mutex);                                                                                          \
+    if(_registerShadow) {                                                                                              \
+      _registerShadow->loadDriverWord(_id, LOCAL_DATA_INSTANCE);                                                       \
+    }                                                                                                                  \
     return LOCAL_DATA_INSTANCE;                                                                                        \
   }                                                                                                                    \
   void MotorControlerImpl::set##NAME(NAME const& driverData) {                                                         \
@@ -70,7 +75,9 @@ typedef std::unique_lock<std::mutex> unique_lock;
 namespace mtca4u {
   MotorControlerImpl::MotorControlerImpl(unsigned int ID, boost::shared_ptr<ChimeraTK::Device> const& device,
       std::string const& moduleName, boost::shared_ptr<TMC429SPI> const& controlerSPI,
-      MotorControlerConfig const& motorControlerConfig)
+      MotorControlerConfig const& motorControlerConfig, bool differentialInit, bool deferDriverInitialisation,
+      boost::shared_ptr<RegisterShadow> const& registerShadow, boost::shared_ptr<SpiArbitration> const& spiArbitration,
+      boost::shared_ptr<CommonRegisterCache> const& commonRegisterCache)
   : _mutex(), _device(device), _id(ID), _controlerConfig(motorControlerConfig),
     _conversionFactor(calculateConversionFactor(motorControlerConfig)),
     _currentVmax(motorControlerConfig.maximumVelocity),
@@ -82,6 +89,10 @@ namespace mtca4u {
     _coolStepControlData(),   // set later in the constructor body
     _stallGuardControlData(), // set later in the constructor body
     _driverConfigData(),      // set later in the constructor body
+    _registerShadow(registerShadow), _skipUnchangedDriverData(false),
+    _commonRegisterCache(commonRegisterCache ?
+            commonRegisterCache :
+            boost::make_shared<CommonRegisterCache>(device, moduleName, controlerSPI)),
     _controlerStatus{device->getScalarRegisterAccessor<int32_t>(
         moduleName + "/" + CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {ChimeraTK::AccessMode::raw})},
     _actualPosition{RAW_ACCESSOR_FROM_SUFFIX(moduleName, ACTUAL_POSITION_SUFFIX)},
@@ -100,31 +111,19 @@ namespace mtca4u {
     _driverSPI(device, moduleName, createMotorRegisterName(ID, SPI_WRITE_SUFFIX),
         createMotorRegisterName(ID, SPI_SYNC_SUFFIX), motorControlerConfig.driverSpiWaitingTime),
     _controlerSPI(controlerSPI), _converter24bits(24), _converter12bits(12), _moveOnlyFullStep(false),
-    _userMicroStepSize(0), _localTargetPosition(0) {
-    setAccelerationThresholdData(motorControlerConfig.accelerationThresholdData);
-    // setActualPosition( motorControlerConfig.actualPosition );
-    setChopperControlData(motorControlerConfig.chopperControlData);
-    setCoolStepControlData(motorControlerConfig.coolStepControlData);
+    _userMicroStepSize(0), _localTargetPosition(0), _interruptsArmed(false), _statusGroup(), _readbackUpdateCounter(0),
+    _readbackSnapshot(), _stopRefresher(false), _refreshPeriod(0) {
+    _driverSPI.setInterprocessArbitration(spiArbitration);
     setDecoderReadoutMode(motorControlerConfig.decoderReadoutMode);
-    setDividersAndMicroStepResolutionData(motorControlerConfig.dividersAndMicroStepResolutionData);
-    setDriverConfigData(motorControlerConfig.driverConfigData);
-    setDriverControlData(motorControlerConfig.driverControlData);
-    setInterruptData(motorControlerConfig.interruptData);
-    setMaximumAcceleration(motorControlerConfig.maximumAcceleration);
-    setMaximumVelocity(motorControlerConfig.maximumVelocity);
-    setMicroStepCount(motorControlerConfig.microStepCount);
-    setMinimumVelocity(motorControlerConfig.minimumVelocity);
-    setPositionTolerance(motorControlerConfig.positionTolerance);
-    setProportionalityFactorData(motorControlerConfig.proportionalityFactorData);
-    setReferenceConfigAndRampModeData(motorControlerConfig.referenceConfigAndRampModeData);
-    setStallGuardControlData(motorControlerConfig.stallGuardControlData);
-    setTargetVelocity(motorControlerConfig.targetVelocity);
+    auto nWrittenControlerRegisters = writeControlerRegisters(motorControlerConfig, differentialInit);
+    _skipUnchangedDriverData = differentialInit && _registerShadow && nWrittenControlerRegisters == 0;
 
     _localTargetPosition = retrieveTargetPositonAndConvert();
     _userMicroStepSize = pow(2, motorControlerConfig.driverControlData.getMicroStepResolution());
 
-    // enabling the motor is the last step after setting all registers
-    setEnabled(motorControlerConfig.enabled);
+    if(!deferDriverInitialisation) {
+      initialiseDriver();
+    }
     try {
       // this must throw on mapfile not having this register
       _endSwitchPowerIndicator.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, ENDSWITCH_ENABLE_SUFFIX));
@@ -136,6 +135,80 @@ namespace mtca4u {
       // WORD_M1_VOLTAGE_EN register in the mapfile. Methods using this accessor
       // have to check its isInitialised() method prior to using it.
     }
+    createStatusTransferGroup(moduleName);
+  }
+
+  size_t MotorControlerImpl::writeControlerRegisters(
+      MotorControlerConfig const& motorControlerConfig, bool onlyDifferences) {
+    auto createWord = [](unsigned int idx, unsigned int data) {
+      TMC429InputWord inputWord;
+      inputWord.setIDX_JDX(idx);
+      inputWord.setRW(RW_WRITE);
+      inputWord.setDATA(data);
+      return inputWord;
+    };
+    std::vector<TMC429InputWord> inputWords{motorControlerConfig.accelerationThresholdData,
+        motorControlerConfig.dividersAndMicroStepResolutionData, motorControlerConfig.interruptData,
+        createWord(IDX_MAXIMUM_ACCELERATION, motorControlerConfig.maximumAcceleration),
+        createWord(IDX_MAXIMUM_VELOCITY, motorControlerConfig.maximumVelocity),
+        createWord(IDX_MICRO_STEP_COUNT, motorControlerConfig.microStepCount),
+        createWord(IDX_MINIMUM_VELOCITY, motorControlerConfig.minimumVelocity),
+        createWord(IDX_DELTA_X_REFERENCE_TOLERANCE, motorControlerConfig.positionTolerance),
+        motorControlerConfig.proportionalityFactorData, motorControlerConfig.referenceConfigAndRampModeData,
+        createWord(IDX_TARGET_VELOCITY,
+            static_cast<unsigned int>(_converter12bits.thirtyTwoToCustom(motorControlerConfig.targetVelocity)))};
+    for(auto& inputWord : inputWords) {
+      // set/overwrite the id with this motors id
+      inputWord.setSMDA(_id);
+    }
+
+    lock_guard guard(_mutex);
+    _currentVmax = motorControlerConfig.maximumVelocity;
+    return _controlerSPI->writeConfiguration(inputWords, onlyDifferences);
+  }
+
+  void MotorControlerImpl::initialiseDriver() {
+    initialiseDriverData(_controlerConfig.chopperControlData, _chopperControlData);
+    initialiseDriverData(_controlerConfig.coolStepControlData, _coolStepControlData);
+    initialiseDriverData(_controlerConfig.driverConfigData, _driverConfigData);
+    initialiseDriverData(_controlerConfig.driverControlData, _driverControlData);
+    initialiseDriverData(_controlerConfig.stallGuardControlData, _stallGuardControlData);
+
+    // enabling the motor is the last step after setting all registers
+    setEnabled(_controlerConfig.enabled);
+  }
+
+  void MotorControlerImpl::createStatusTransferGroup(std::string const& moduleName) {
+    auto& device = _device;
+    _statusGroup.controlerStatus.replace(device->getScalarRegisterAccessor<int32_t>(
+        moduleName + "/" + CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {ChimeraTK::AccessMode::raw}));
+    _statusGroup.actualPosition.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, ACTUAL_POSITION_SUFFIX));
+    _statusGroup.actualVelocity.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, ACTUAL_VELOCITY_SUFFIX));
+    _statusGroup.actualAcceleration.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, ACTUAL_ACCELETATION_SUFFIX));
+    _statusGroup.microStepCount.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, MICRO_STEP_COUNT_SUFFIX));
+    _statusGroup.stallGuardValue.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, STALL_GUARD_VALUE_SUFFIX));
+    _statusGroup.coolStepValue.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, COOL_STEP_VALUE_SUFFIX));
+    _statusGroup.status.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, STATUS_SUFFIX));
+    _statusGroup.motorCurrentEnabled.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, MOTOR_CURRENT_ENABLE_SUFFIX));
+    _statusGroup.decoderReadoutMode.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, DECODER_READOUT_MODE_SUFFIX));
+    _statusGroup.decoderPosition.replace(RAW_ACCESSOR_FROM_SUFFIX(moduleName, DECODER_POSITION_SUFFIX));
+
+    auto& group = _statusGroup.transferGroup;
+    group.addAccessor(_statusGroup.controlerStatus);
+    group.addAccessor(_statusGroup.actualPosition);
+    group.addAccessor(_statusGroup.actualVelocity);
+    group.addAccessor(_statusGroup.actualAcceleration);
+    group.addAccessor(_statusGroup.microStepCount);
+    group.addAccessor(_statusGroup.stallGuardValue);
+    group.addAccessor(_statusGroup.coolStepValue);
+    group.addAccessor(_statusGroup.status);
+    group.addAccessor(_statusGroup.motorCurrentEnabled);
+    group.addAccessor(_statusGroup.decoderReadoutMode);
+    group.addAccessor(_statusGroup.decoderPosition);
+  }
+
+  MotorControlerImpl::~MotorControlerImpl() {
+    stopReadbackRefresher();
   }
 
   unsigned int MotorControlerImpl::getID() {
@@ -259,25 +332,75 @@ namespace mtca4u {
 
   void MotorControlerImpl::setTargetPosition(int value) {
     lock_guard guard(_mutex);
+    TargetPositionWords inputWords;
+    auto nWords = targetPositionWords(value, inputWords);
+    for(size_t i = 0; i < nWords; ++i) {
+      _controlerSPI->write(inputWords[i], SPIviaPCIe::Priority::MOTION);
+      commitTargetPositionWord(inputWords[i]);
+    }
+  }
+
+  std::vector<TMC429InputWord> MotorControlerImpl::createTargetPositionWords(int value) {
+    lock_guard guard(_mutex);
+    TargetPositionWords inputWords;
+    auto nWords = targetPositionWords(value, inputWords);
+    return std::vector<TMC429InputWord>(inputWords.begin(), inputWords.begin() + static_cast<ptrdiff_t>(nWords));
+  }
 
-    InterruptData interupts;
-    interupts = readTypedRegister<InterruptData>();
+  void MotorControlerImpl::confirmTargetPositionWords(
+      std::vector<TMC429InputWord> const& inputWords, SPIviaPCIe::TransferStatus const* status) {
+    lock_guard guard(_mutex);
+    for(size_t i = 0; i < inputWords.size() && status[i] == SPIviaPCIe::TransferStatus::OK; ++i) {
+      commitTargetPositionWord(inputWords[i]);
+    }
+  }
 
-    // Enable all interrupt masks
-    interupts.setMaskFlags(255);
+  void MotorControlerImpl::commitTargetPositionWord(TMC429InputWord const& inputWord) {
+    if(inputWord.getIDX_JDX() == IDX_TARGET_POSITION) {
+      _localTargetPosition = _converter24bits.customToThirtyTwo(static_cast<int>(inputWord.getDATA()));
+    }
+    else {
+      _interruptsArmed = true;
+    }
+  }
 
-    // Enable all interrupts
-    interupts.setInterruptFlags(255);
-    writeTypedControlerRegister(interupts);
+  size_t MotorControlerImpl::targetPositionWords(int value, TargetPositionWords& inputWords) {
+    size_t nWords = 0;
 
     if(_moveOnlyFullStep) {
       roundToNextFullStep(value);
     }
 
-    _localTargetPosition = value;
+    TMC429InputWord targetPositionWord;
+    targetPositionWord.setIDX_JDX(IDX_TARGET_POSITION);
+    targetPositionWord.setDATA(static_cast<unsigned int>(_converter24bits.thirtyTwoToCustom(value)));
+    inputWords[nWords++] = targetPositionWord;
+
+    // Enable all interrupt masks and clear all interrupt flags, so isMotorMoving() does not see the end of the
+    // previous move. This is only needed if the configuration might have changed, or if a move or a reference switch
+    // might have set the flags since the last time. The controler status is a PCIe register, so while the motor is
+    // still moving a new target only costs one SPI transaction.
+    // The flags are cleared after the new target has been written, so also a previous move which ends after the
+    // status has been read here cannot leave a flag behind. Only if xEQt is clear now, the flag of a move which ends
+    // in between stays set, but then isMotorMoving() still checks the standstill of the driver.
+    if(!_interruptsArmed || moveHasEnded()) {
+      InterruptData interupts;
+      interupts.setMaskFlags(255);
+      interupts.setInterruptFlags(255);
+      inputWords[nWords++] = interupts;
+    }
+
+    for(size_t i = 0; i < nWords; ++i) {
+      inputWords[i].setSMDA(_id);
+    }
+    return nWords;
+  }
 
-    auto writeValue = static_cast<unsigned int>(_converter24bits.thirtyTwoToCustom(value));
-    _controlerSPI->write(_id, IDX_TARGET_POSITION, writeValue);
+  bool MotorControlerImpl::moveHasEnded() {
+    // Not from the cache, a move which has just ended must not be missed
+    _controlerStatus.read();
+    TMC429StatusWord controlerStatusWord(_controlerStatus);
+    return controlerStatusWord.getTargetPositionReached(_id) || controlerStatusWord.getReferenceSwitchBit(_id);
   }
 
   void MotorControlerImpl::roundToNextFullStep(int& targetPosition) { // todo implementing
@@ -312,10 +435,10 @@ namespace mtca4u {
   }
 
   template<class T>
-  T MotorControlerImpl::readTypedRegister() {
+  T MotorControlerImpl::readTypedRegister(SPIviaPCIe::Priority priority) {
     T typedWord;
     typedWord.setSMDA(_id);
-    TMC429OutputWord readbackWord = _controlerSPI->read(_id, typedWord.getIDX_JDX());
+    TMC429OutputWord readbackWord = _controlerSPI->read(_id, typedWord.getIDX_JDX(), priority);
     typedWord.setDATA(readbackWord.getDATA());
     return typedWord;
   }
@@ -339,18 +462,29 @@ namespace mtca4u {
     return convertVMaxToUstepsPerSec(_currentVmax);
   }
 
-  void MotorControlerImpl::writeTypedControlerRegister(TMC429InputWord inputWord) {
+  void MotorControlerImpl::writeTypedControlerRegister(TMC429InputWord inputWord, SPIviaPCIe::Priority priority) {
     // set/overwrite the id with this motors id
     inputWord.setSMDA(_id);
-    _controlerSPI->write(inputWord);
+    _controlerSPI->write(inputWord, priority);
   }
 
   DEFINE_SET_GET_TYPED_CONTROLER_REGISTER(AccelerationThresholdData)
   DEFINE_SET_GET_TYPED_CONTROLER_REGISTER(ProportionalityFactorData)
   DEFINE_SET_GET_TYPED_CONTROLER_REGISTER(ReferenceConfigAndRampModeData)
-  DEFINE_SET_GET_TYPED_CONTROLER_REGISTER(InterruptData)
   DEFINE_SET_GET_TYPED_CONTROLER_REGISTER(DividersAndMicroStepResolutionData)
 
+  InterruptData MotorControlerImpl::getInterruptData() {
+    lock_guard guard(_mutex);
+    return readTypedRegister<InterruptData>();
+  }
+
+  void MotorControlerImpl::setInterruptData(InterruptData const& inputWord) {
+    lock_guard guard(_mutex);
+    writeTypedControlerRegister(inputWord);
+    // the masks are overwritten, the next move has to set them again
+    _interruptsArmed = false;
+  }
+
   DEFINE_SET_GET_TYPED_DRIVER_DATA(DriverControlData, _driverControlData)
   DEFINE_SET_GET_TYPED_DRIVER_DATA(ChopperControlData, _chopperControlData)
   DEFINE_SET_GET_TYPED_DRIVER_DATA(CoolStepControlData, _coolStepControlData)
@@ -362,6 +496,21 @@ namespace mtca4u {
     _driverSPI.write(driverData.getDataWord());
     // Remember the written word for readback.
     localDataInstance = driverData;
+    if(_registerShadow) {
+      _registerShadow->storeDriverWord(_id, driverData);
+    }
+  }
+
+  template<class T>
+  void MotorControlerImpl::initialiseDriverData(T const& driverData, T& localDataInstance) {
+    lock_guard guard(_mutex);
+    T shadowData;
+    if(_skipUnchangedDriverData && _registerShadow->loadDriverWord(_id, shadowData) &&
+        shadowData.getDataWord() == driverData.getDataWord()) {
+      localDataInstance = driverData;
+      return;
+    }
+    setTypedDriverData(driverData, localDataInstance);
   }
 
   MotorReferenceSwitchData MotorControlerImpl::getReferenceSwitchData() {
@@ -373,7 +522,7 @@ namespace mtca4u {
     // the bit pattern for the active flags
     unsigned int bitMask = 0x3U << 2 * _id;
 
-    unsigned int commonReferenceSwitchWord = _controlerSPI->read(SMDA_COMMON, JDX_REFERENCE_SWITCH).getDATA();
+    unsigned int commonReferenceSwitchWord = _commonRegisterCache->getReferenceSwitchWord();
     unsigned int dataWord = (commonReferenceSwitchWord & bitMask) >> 2 * _id;
     // note: the following code uses the implicit bool conversion to/from 0/1 to
     // keep the code short.
@@ -439,16 +588,14 @@ namespace mtca4u {
 
   bool MotorControlerImpl::targetPositionReached() {
     lock_guard guard(_mutex);
-    _controlerStatus.read();
-    TMC429StatusWord controlerStatusWord(_controlerStatus);
+    auto controlerStatusWord = _commonRegisterCache->getControlerStatusWord();
 
     return controlerStatusWord.getTargetPositionReached(_id);
   }
 
   unsigned int MotorControlerImpl::getReferenceSwitchBit() {
     lock_guard guard(_mutex);
-    _controlerStatus.read();
-    TMC429StatusWord controlerStatusWord(_controlerStatus);
+    auto controlerStatusWord = _commonRegisterCache->getControlerStatusWord();
 
     return controlerStatusWord.getReferenceSwitchBit(_id);
   }
@@ -532,6 +679,16 @@ namespace mtca4u {
 
   bool MotorControlerImpl::isMotorMoving() {
     lock_guard guard(_mutex);
+
+    // Fast path without SPI transfers: the controler status is a PCIe register. At the target position only the
+    // standstill of the driver is checked. Otherwise the motor might also have been stopped by a reference switch.
+    // There is only one reference switch bit per motor, which does not report the other switch, so in this case the
+    // interrupt flags and the switches are checked.
+    if(_commonRegisterCache->getControlerStatusWord().getTargetPositionReached(_id)) {
+      DriverStatusData status(readRegisterAccessor(_status));
+      return status.getStandstillIndicator() == 0;
+    }
+
     auto interruptData = readTypedRegister<InterruptData>();
 
     // Check if we got any of the interrupts that tells us that the motor has stopped
@@ -584,6 +741,25 @@ namespace mtca4u {
     _endSwitchPowerIndicator.write();
   }
 
+  void MotorControlerImpl::emergencyStop() {
+    lock_guard guard(_mutex);
+    _motorCurrentEnabled = 0;
+    _motorCurrentEnabled.write();
+    if(_endSwitchPowerIndicator.isInitialised()) {
+      _endSwitchPowerIndicator = 0;
+      _endSwitchPowerIndicator.write();
+    }
+
+    int targetPosition = readPositionRegisterAndConvert();
+    if(_moveOnlyFullStep) {
+      roundToNextFullStep(targetPosition);
+    }
+    _localTargetPosition = targetPosition;
+    _controlerSPI->write(_id, IDX_TARGET_POSITION,
+        static_cast<unsigned int>(_converter24bits.thirtyTwoToCustom(targetPosition)),
+        SPIviaPCIe::Priority::EMERGENCY_STOP);
+  }
+
   bool MotorControlerImpl::isEndSwitchPowerEnabled() {
     lock_guard guard(_mutex);
     if(!_endSwitchPowerIndicator.isInitialised()) {
@@ -602,4 +778,103 @@ namespace mtca4u {
     _usrSetCurrentScale = currentScale;
   }
 
+  MotorStatusSnapshot MotorControlerImpl::readAllStatus() {
+    lock_guard guard(_mutex);
+    return readStatusSnapshot();
+  }
+
+  MotorStatusSnapshot MotorControlerImpl::readStatusSnapshot() {
+    _statusGroup.transferGroup.read();
+
+    MotorStatusSnapshot snapshot;
+    snapshot.actualPosition = _converter24bits.customToThirtyTwo(_statusGroup.actualPosition);
+    snapshot.actualVelocity = _converter12bits.customToThirtyTwo(_statusGroup.actualVelocity);
+    snapshot.actualAcceleration = static_cast<unsigned int>(_statusGroup.actualAcceleration);
+    snapshot.microStepCount = static_cast<unsigned int>(_statusGroup.microStepCount);
+    snapshot.stallGuardValue = static_cast<unsigned int>(_statusGroup.stallGuardValue);
+    snapshot.coolStepValue = static_cast<unsigned int>(_statusGroup.coolStepValue);
+    snapshot.driverStatusWord = static_cast<unsigned int>(_statusGroup.status);
+    snapshot.decoderReadoutMode = static_cast<unsigned int>(_statusGroup.decoderReadoutMode);
+    snapshot.decoderPosition = static_cast<unsigned int>(_statusGroup.decoderPosition);
+    snapshot.controlerStatusWord = static_cast<unsigned int>(_statusGroup.controlerStatus);
+    snapshot.motorCurrentEnabled = (_statusGroup.motorCurrentEnabled != 0);
+    snapshot.timestamp = std::chrono::steady_clock::now();
+    snapshot.updateCounter = ++_readbackUpdateCounter;
+    return snapshot;
+  }
+
+  void MotorControlerImpl::startReadbackRefresher(std::chrono::microseconds refreshPeriod) {
+    if(refreshPeriod <= std::chrono::microseconds(0)) {
+      throw ChimeraTK::logic_error(
+          "MotorControlerImpl::startReadbackRefresher(): The refresh period must be positive.");
+    }
+    lock_guard controlGuard(_refresherControlMutex);
+    {
+      lock_guard guard(_refresherMutex);
+      _refreshPeriod = refreshPeriod;
+      _stopRefresher = false;
+    }
+    if(_refresherThread.joinable()) {
+      // wake up the thread so the new period takes effect immediately
+      _refresherCondition.notify_all();
+      return;
+    }
+    _refresherThread = std::thread(&MotorControlerImpl::readbackRefresherThreadFunction, this);
+  }
+
+  void MotorControlerImpl::stopReadbackRefresher() {
+    lock_guard controlGuard(_refresherControlMutex);
+    if(!_refresherThread.joinable()) {
+      return;
+    }
+    {
+      lock_guard guard(_refresherMutex);
+      _stopRefresher = true;
+    }
+    _refresherCondition.notify_all();
+    _refresherThread.join();
+  }
+
+  bool MotorControlerImpl::isReadbackRefresherRunning() {
+    lock_guard controlGuard(_refresherControlMutex);
+    return _refresherThread.joinable();
+  }
+
+  MotorStatusSnapshot MotorControlerImpl::getReadbackSnapshot() {
+    return _readbackSnapshot.load();
+  }
+
+  SpiTransactionCounters MotorControlerImpl::getDriverSpiCounters() const {
+    return _driverSPI.getTransactionCounters();
+  }
+
+  void MotorControlerImpl::resetDriverSpiCounters() {
+    _driverSPI.resetTransactionCounters();
+  }
+
+  SpiTransactionCounters MotorControlerImpl::getControlerSpiCounters() const {
+    return _controlerSPI->getTransactionCounters();
+  }
+
+  void MotorControlerImpl::readbackRefresherThreadFunction() {
+    unique_lock refresherLock(_refresherMutex);
+    while(!_stopRefresher) {
+      refresherLock.unlock();
+      try {
+        MotorStatusSnapshot snapshot;
+        {
+          lock_guard guard(_mutex);
+          snapshot = readStatusSnapshot();
+        }
+        _readbackSnapshot.store(snapshot);
+      }
+      catch(ChimeraTK::runtime_error&) {
+        // The device is not accessible at the moment. Keep the last snapshot
+        // (its timestamp shows its age) and try again in the next period.
+      }
+      refresherLock.lock();
+      _refresherCondition.wait_for(refresherLock, _refreshPeriod);
+    }
+  }
+
 } // namespace mtca4u
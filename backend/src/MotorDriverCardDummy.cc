@@ -31,6 +31,24 @@ namespace mtca4u {
     }
   }
 
+  void MotorDriverCardDummy::setTargetPositions(std::map<unsigned int, int> const& targetPositions) {
+    // check all IDs first, so no target is set if one is invalid
+    std::vector<boost::shared_ptr<MotorControler>> motorControlers;
+    for(auto const& targetPosition : targetPositions) {
+      motorControlers.push_back(getMotorControler(targetPosition.first));
+    }
+    auto motorControler = motorControlers.begin();
+    for(auto const& targetPosition : targetPositions) {
+      (*motorControler++)->setTargetPosition(targetPosition.second);
+    }
+  }
+
+  SpiTransactionCounters MotorDriverCardDummy::getControlerSpiCounters() const {
+    return SpiTransactionCounters();
+  }
+
+  void MotorDriverCardDummy::resetControlerSpiCounters() {}
+
   PowerMonitor& MotorDriverCardDummy::getPowerMonitor() {
     throw ChimeraTK::logic_error("getPowerMonitor() is not implemented inMotorDriverCardDummy");
   }
@@ -6,6 +6,7 @@
 
 #include <ChimeraTK/Device.h>
 
+#include <boost/make_shared.hpp>
 #include <boost/thread/locks.hpp>
 
 namespace mtca4u {
@@ -46,7 +47,20 @@ namespace mtca4u {
       device->open(alias);
       MotorDriverCardConfig cardConfig = MotorDriverCardConfigXML::read(motorConfigFileName);
 
-      motorDriverCard.reset(new MotorDriverCardImpl(device, mapModuleName, cardConfig));
+      boost::shared_ptr<RegisterShadow> registerShadow;
+      if(_registerShadow) {
+        registerShadow = boost::make_shared<RegisterShadow>(alias, mapModuleName);
+      }
+      boost::shared_ptr<SpiArbitration> spiArbitration;
+      if(_interprocessArbitration) {
+        spiArbitration = boost::make_shared<SpiArbitration>(alias, mapModuleName);
+      }
+
+      boost::shared_ptr<MotorDriverCardImpl> motorDriverCardImpl(new MotorDriverCardImpl(
+          device, mapModuleName, cardConfig, _differentialInit, registerShadow, spiArbitration));
+      // only after the initialisation, which does not profit from the priorities
+      motorDriverCardImpl->enableControlerSpiTransferThread(_spiTransferThread);
+      motorDriverCard = motorDriverCardImpl;
     }
     _motorDriverCards[id] = motorDriverCard;
 
@@ -61,6 +75,38 @@ namespace mtca4u {
     _dummyMode = dummyMode;
   }
 
+  bool MotorDriverCardFactory::getDifferentialInit() {
+    return _differentialInit;
+  }
+
+  void MotorDriverCardFactory::setDifferentialInit(bool differentialInit) {
+    _differentialInit = differentialInit;
+  }
+
+  bool MotorDriverCardFactory::getRegisterShadow() {
+    return _registerShadow;
+  }
+
+  void MotorDriverCardFactory::setRegisterShadow(bool registerShadow) {
+    _registerShadow = registerShadow;
+  }
+
+  bool MotorDriverCardFactory::getInterprocessArbitration() {
+    return _interprocessArbitration;
+  }
+
+  void MotorDriverCardFactory::setInterprocessArbitration(bool interprocessArbitration) {
+    _interprocessArbitration = interprocessArbitration;
+  }
+
+  bool MotorDriverCardFactory::getSpiTransferThread() {
+    return _spiTransferThread;
+  }
+
+  void MotorDriverCardFactory::setSpiTransferThread(bool spiTransferThread) {
+    _spiTransferThread = spiTransferThread;
+  }
+
   void MotorDriverCardFactory::setDeviceaccessDMapFilePath(std::string dmapFileName) {
     ChimeraTK::BackendFactory::getInstance().setDMapFilePath(dmapFileName);
   }
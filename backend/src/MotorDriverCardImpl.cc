@@ -4,6 +4,7 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <future>
 #include <sstream>
 #include <stdexcept>
 using namespace mtca4u::tmc429;
@@ -15,13 +16,12 @@ using namespace mtca4u::dfmc_md22;
 
 namespace mtca4u {
   MotorDriverCardImpl::MotorDriverCardImpl(boost::shared_ptr<ChimeraTK::Device> const& device,
-      std::string const& moduleName,
-      MotorDriverCardConfig const& cardConfiguration)
+      std::string const& moduleName, MotorDriverCardConfig const& cardConfiguration, bool differentialInit,
+      boost::shared_ptr<RegisterShadow> const& registerShadow, boost::shared_ptr<SpiArbitration> const& spiArbitration)
   : _motorControlers(),               // done later in the constructor body
     _device(device), _powerMonitor(), // done later in the constructor body
     _controlerSPI(),                  // done later in the constructor body
-    _controlerStatusRegister(device->getScalarRegisterAccessor<int32_t>(
-        moduleName + "/" + CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {ChimeraTK::AccessMode::raw})),
+    _commonRegisterCache(),           // done later in the constructor body
     _moduleName(moduleName) {
     checkFirmwareVersion();
 
@@ -33,24 +33,52 @@ namespace mtca4u {
     _powerMonitor.reset(new PowerMonitor);
     _controlerSPI.reset(
         new TMC429SPI(device, moduleName, CONTROLER_SPI_WRITE_ADDRESS_STRING, CONTROLER_SPI_SYNC_ADDRESS_STRING,
-            CONTROLER_SPI_READBACK_ADDRESS_STRING, cardConfiguration.controlerSpiWaitingTime));
+            CONTROLER_SPI_READBACK_ADDRESS_STRING, CONTROLER_SPI_BATCH_ADDRESS_STRING,
+            CONTROLER_SPI_BATCH_SIZE_ADDRESS_STRING, cardConfiguration.controlerSpiWaitingTime));
+    _controlerSPI->setInterprocessArbitration(spiArbitration);
+    _commonRegisterCache.reset(new CommonRegisterCache(device, moduleName, _controlerSPI));
 
     // initialise common registers
-    setCoverDatagram(cardConfiguration.coverDatagram);
-    setCoverPositionAndLength(cardConfiguration.coverPositionAndLength);
-    setDatagramHighWord(cardConfiguration.datagramHighWord);
-    setDatagramLowWord(cardConfiguration.datagramLowWord);
-    setInterfaceConfiguration(cardConfiguration.interfaceConfiguration);
-    setPositionCompareInterruptData(cardConfiguration.positionCompareInterruptData);
-    setPositionCompareWord(cardConfiguration.positionCompareWord);
-    setStepperMotorGlobalParameters(cardConfiguration.stepperMotorGlobalParameters);
-
-    // initialise motors
-    _motorControlers.resize(N_MOTORS_MAX);
-    for(unsigned int i = 0; i < _motorControlers.size(); ++i) {
-      _motorControlers[i].reset(new MotorControlerImpl(
-          i, device, moduleName, _controlerSPI, cardConfiguration.motorControlerConfigurations[i]));
+    writeCommonRegisters(cardConfiguration, differentialInit);
+
+    // initialise motors. The controler registers share one SPI and are written
+    // sequentially, the drivers have separate SPIs and are initialised concurrently.
+    std::vector<boost::shared_ptr<MotorControlerImpl>> motorControlers(N_MOTORS_MAX);
+    for(unsigned int i = 0; i < motorControlers.size(); ++i) {
+      motorControlers[i].reset(new MotorControlerImpl(i, device, moduleName, _controlerSPI,
+          cardConfiguration.motorControlerConfigurations[i], differentialInit, true, registerShadow, spiArbitration,
+          _commonRegisterCache));
     }
+    // The futures of std::async wait for the task on destruction, so no
+    // initialisation is running any more if one of them throws.
+    std::vector<std::future<void>> driverInitialisations;
+    for(auto& motorControler : motorControlers) {
+      driverInitialisations.push_back(
+          std::async(std::launch::async, [motorControler] { motorControler->initialiseDriver(); }));
+    }
+    for(auto& driverInitialisation : driverInitialisations) {
+      driverInitialisation.get();
+    }
+    _motorControlers.assign(motorControlers.begin(), motorControlers.end());
+  }
+
+  void MotorDriverCardImpl::writeCommonRegisters(MotorDriverCardConfig const& cardConfiguration, bool onlyDifferences) {
+    auto createWord = [](unsigned int jdx, unsigned int data) {
+      TMC429InputWord inputWord;
+      inputWord.setSMDA(SMDA_COMMON);
+      inputWord.setIDX_JDX(jdx);
+      inputWord.setRW(RW_WRITE);
+      inputWord.setDATA(data);
+      return inputWord;
+    };
+    _controlerSPI->writeConfiguration({createWord(JDX_COVER_DATAGRAM, cardConfiguration.coverDatagram),
+        cardConfiguration.coverPositionAndLength,
+        createWord(JDX_DATAGRAM_HIGH_WORD, cardConfiguration.datagramHighWord),
+        createWord(JDX_DATAGRAM_LOW_WORD, cardConfiguration.datagramLowWord), cardConfiguration.interfaceConfiguration,
+        cardConfiguration.positionCompareInterruptData,
+        createWord(JDX_POSITION_COMPARE, cardConfiguration.positionCompareWord),
+        cardConfiguration.stepperMotorGlobalParameters},
+        onlyDifferences);
   }
 
   boost::shared_ptr<MotorControler> MotorDriverCardImpl::getMotorControler(unsigned int motorControlerID) {
@@ -64,6 +92,39 @@ namespace mtca4u {
     }
   }
 
+  void MotorDriverCardImpl::setTargetPositions(std::map<unsigned int, int> const& targetPositions) {
+    // check all IDs first, so no target is set if one is invalid
+    std::vector<boost::shared_ptr<MotorControlerImpl>> motorControlers;
+    for(auto const& targetPosition : targetPositions) {
+      motorControlers.push_back(
+          boost::static_pointer_cast<MotorControlerImpl>(getMotorControler(targetPosition.first)));
+    }
+
+    std::vector<std::vector<TMC429InputWord>> motorInputWords;
+    std::vector<TMC429InputWord> inputWords;
+    auto motorControler = motorControlers.begin();
+    for(auto const& targetPosition : targetPositions) {
+      motorInputWords.push_back((*motorControler++)->createTargetPositionWords(targetPosition.second));
+      inputWords.insert(inputWords.end(), motorInputWords.back().begin(), motorInputWords.back().end());
+    }
+
+    auto transferStatus = _controlerSPI->write(inputWords, SPIviaPCIe::Priority::MOTION);
+    // the local state of the motors is only updated for the words which have been written
+    size_t firstWord = 0;
+    for(size_t i = 0; i < motorControlers.size(); ++i) {
+      motorControlers[i]->confirmTargetPositionWords(motorInputWords[i], transferStatus.data() + firstWord);
+      firstWord += motorInputWords[i].size();
+    }
+    for(size_t i = 0; i < transferStatus.size(); ++i) {
+      if(transferStatus[i] != SPIviaPCIe::TransferStatus::OK) {
+        std::stringstream errorMessage;
+        errorMessage << "Error writing via SPI, target position word 0x" << std::hex << inputWords[i].getDataWord()
+                     << " has not been written.";
+        throw ChimeraTK::runtime_error(errorMessage.str());
+      }
+    }
+  }
+
   PowerMonitor& MotorDriverCardImpl::getPowerMonitor() {
     return *_powerMonitor;
   }
@@ -144,12 +205,11 @@ namespace mtca4u {
   }
 
   ReferenceSwitchData MotorDriverCardImpl::getReferenceSwitchData() {
-    return ReferenceSwitchData(_controlerSPI->read(SMDA_COMMON, JDX_REFERENCE_SWITCH).getDATA());
+    return ReferenceSwitchData(_commonRegisterCache->getReferenceSwitchWord());
   }
 
   TMC429StatusWord MotorDriverCardImpl::getStatusWord() {
-    _controlerStatusRegister.read();
-    return TMC429StatusWord(_controlerStatusRegister);
+    return _commonRegisterCache->getControlerStatusWord();
   }
 
   void MotorDriverCardImpl::checkFirmwareVersion() {
@@ -172,4 +232,29 @@ namespace mtca4u {
     }
   }
 
+  void MotorDriverCardImpl::enableControlerSpiTransferThread(bool enable) {
+    _controlerSPI->enableTransferThread(enable);
+  }
+
+  SPIviaPCIe::PriorityStatistics MotorDriverCardImpl::getControlerSpiPriorityStatistics(
+      SPIviaPCIe::Priority priority) const {
+    return _controlerSPI->getPriorityStatistics(priority);
+  }
+
+  SpiTransactionCounters MotorDriverCardImpl::getControlerSpiCounters() const {
+    return _controlerSPI->getTransactionCounters();
+  }
+
+  void MotorDriverCardImpl::resetControlerSpiCounters() {
+    _controlerSPI->resetTransactionCounters();
+  }
+
+  void MotorDriverCardImpl::setCommonRegisterMaximumAge(std::chrono::microseconds maximumAge) {
+    _commonRegisterCache->setMaximumAge(maximumAge);
+  }
+
+  std::chrono::microseconds MotorDriverCardImpl::getCommonRegisterMaximumAge() {
+    return _commonRegisterCache->getMaximumAge();
+  }
+
 } // namespace mtca4u
@@ -0,0 +1,82 @@
+#include "impl/RegisterShadow.h"
+
+#include "DFMC_MD22Constants.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <cstdint>
+#include <mutex>
+
+namespace mtca4u {
+
+  // Increase if the layout of the image changes, so processes using different
+  // versions of the library do not share the memory.
+  static unsigned int const IMAGE_VERSION = 1;
+  // The image is small, the rest is the management overhead of the segment
+  static size_t const SHARED_MEMORY_SIZE = 4096;
+  // The TMC260 has a 3 bit register address
+  static unsigned int const N_DRIVER_ADDRESSES = 8;
+
+  struct RegisterShadow::Image {
+    RobustMutex mutex;
+    struct Motor {
+      uint32_t driverWords[N_DRIVER_ADDRESSES]{};
+      uint32_t validDriverWords{0}; // one bit per address
+    } motors[dfmc_md22::N_MOTORS_MAX];
+  };
+
+  RegisterShadow::RegisterShadow(std::string const& deviceAlias, std::string const& moduleName)
+  : _sharedMemory(), _image(nullptr) {
+    try {
+      _sharedMemory = boost::interprocess::managed_shared_memory(
+          boost::interprocess::open_or_create, sharedMemoryName(deviceAlias, moduleName).c_str(), SHARED_MEMORY_SIZE);
+      // construction of the image is atomic, only the first process initialises the mutex
+      _image = _sharedMemory.find_or_construct<Image>("image")();
+    }
+    catch(boost::interprocess::interprocess_exception& e) {
+      throw ChimeraTK::runtime_error("RegisterShadow: Cannot open shared memory for " + deviceAlias + "/" +
+          moduleName + ": " + e.what());
+    }
+  }
+
+  void RegisterShadow::storeDriverWord(unsigned int motorId, TMC260Word const& driverWord) {
+    checkMotorId(motorId);
+    std::lock_guard<RobustMutex> lock(_image->mutex);
+    auto& motor = _image->motors[motorId];
+    motor.driverWords[driverWord.getAddress()] = driverWord.getDataWord();
+    motor.validDriverWords |= 1U << driverWord.getAddress();
+  }
+
+  bool RegisterShadow::loadDriverWord(unsigned int motorId, TMC260Word& driverWord) const {
+    checkMotorId(motorId);
+    std::lock_guard<RobustMutex> lock(_image->mutex);
+    auto const& motor = _image->motors[motorId];
+    if(!(motor.validDriverWords & (1U << driverWord.getAddress()))) {
+      return false;
+    }
+    driverWord.setDataWord(motor.driverWords[driverWord.getAddress()]);
+    return true;
+  }
+
+  void RegisterShadow::invalidate() {
+    std::lock_guard<RobustMutex> lock(_image->mutex);
+    for(auto& motor : _image->motors) {
+      motor.validDriverWords = 0;
+    }
+  }
+
+  void RegisterShadow::remove(std::string const& deviceAlias, std::string const& moduleName) {
+    boost::interprocess::shared_memory_object::remove(sharedMemoryName(deviceAlias, moduleName).c_str());
+  }
+
+  std::string RegisterShadow::sharedMemoryName(std::string const& deviceAlias, std::string const& moduleName) {
+    return createSharedMemoryName("MotorDriverCard_v" + std::to_string(IMAGE_VERSION), deviceAlias, moduleName);
+  }
+
+  void RegisterShadow::checkMotorId(unsigned int motorId) {
+    if(motorId >= dfmc_md22::N_MOTORS_MAX) {
+      throw ChimeraTK::logic_error("RegisterShadow: Invalid motor id " + std::to_string(motorId));
+    }
+  }
+
+} // namespace mtca4u
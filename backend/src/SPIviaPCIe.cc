@@ -4,13 +4,21 @@
 #include "impl/SPIviaPCIe.h"
 
 #include "DFMC_MD22Constants.h"
+#include "impl/SpiArbitration.h"
 
 #include <ChimeraTK/Device.h>
 
-#include <boost/thread/locks.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <boost/thread/thread.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cerrno>
+#include <condition_variable>
 #include <ctime>
+#include <optional>
+#include <thread>
 
 using namespace mtca4u::dfmc_md22;
 
@@ -30,74 +38,766 @@ namespace mtca4u {
     _readbackRegister(device->getScalarRegisterAccessor<int32_t>(
         moduleName + "/" + readbackRegisterName, 0, {ChimeraTK::AccessMode::raw})),
     _spiWaitingTime(spiWaitingTime), _moduleName(moduleName), _writeRegisterName(writeRegisterName),
-    _syncRegisterName(syncRegisterName) {}
+    _syncRegisterName(syncRegisterName), _waitStrategy(WaitStrategy::SLEEP), _latencyStatistics(), _arbitration(),
+    _arbitrationMutex(nullptr), _arbitrationStatistics(), _transferThread() {}
 
-  void SPIviaPCIe::write(int32_t spiCommand) {
-    boost::lock_guard<boost::recursive_mutex> guard(_spiMutex);
+  SPIviaPCIe::SPIviaPCIe(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
+      std::string const& writeRegisterName, std::string const& syncRegisterName,
+      std::string const& readbackRegisterName, std::string const& batchRegisterName,
+      std::string const& batchSizeRegisterName, unsigned int spiWaitingTime)
+  : SPIviaPCIe(device, moduleName, writeRegisterName, syncRegisterName, readbackRegisterName, spiWaitingTime) {
+    try {
+      // this must throw on mapfile not having these registers
+      _batchSizeRegister.replace(device->getScalarRegisterAccessor<int32_t>(
+          moduleName + "/" + batchSizeRegisterName, 0, {ChimeraTK::AccessMode::raw}));
+      _batchRegister.replace(device->getOneDRegisterAccessor<int32_t>(
+          moduleName + "/" + batchRegisterName, 0, 0, {ChimeraTK::AccessMode::raw}));
+    }
+    catch(ChimeraTK::logic_error&) {
+      // Older firmware does not have the batch registers. _batchRegister stays
+      // uninitialised and writeBatch() falls back to single word transfers.
+    }
+  }
+
+  int32_t SPIviaPCIe::transferWord(int32_t spiCommand) {
     // try three times to mitigate effects of a firmware bug
     for(int i = 0; i < 3; ++i) {
+      if(i > 0) {
+        countRetry();
+      }
       // Implement the write handshake
       // 1. write 0xff to the synch register
       _synchronisationRegister = SPI_SYNC_REQUESTED;
       _synchronisationRegister.write();
 
       // 2. write the spi command
+      auto start = std::chrono::steady_clock::now();
       _writeRegister = spiCommand;
       _writeRegister.write();
 
       // 3. wait for the handshake
-      _synchronisationRegister.read();
+      waitForSynchronisation(1, start);
+
+      if(_synchronisationRegister != SPI_SYNC_REQUESTED) {
+        // break on either error or ok. If still in SPI_SYNC_REQUESTED repeat (up
+        // to 3 times)
+        break;
+      }
+    }
+    return _synchronisationRegister;
+  }
+
+  void SPIviaPCIe::waitForSynchronisation(size_t nCommands, std::chrono::steady_clock::time_point start) {
+    auto waitingTime = _spiWaitingTime * nCommands;
+    _synchronisationRegister.read();
+    uint64_t nPollIterations = 0;
+
+    if(_waitStrategy == WaitStrategy::SLEEP) {
+      // Once the firmware has been faster than the spi waiting time, the first check is done after the expected
+      // latency. The cycles of the spi waiting time follow as before, so the timeout is not shortened.
+      boost::chrono::nanoseconds expectedLatency(getExpectedLatency().count() * static_cast<int64_t>(nCommands));
+      if(expectedLatency < waitingTime && _synchronisationRegister == SPI_SYNC_REQUESTED) {
+        boost::this_thread::sleep_for(expectedLatency);
 
+        _synchronisationRegister.read();
+        ++nPollIterations;
+      }
       for(size_t syncCounter = 0; (_synchronisationRegister == SPI_SYNC_REQUESTED) && (syncCounter < 10);
           ++syncCounter) {
-        boost::this_thread::sleep_for(_spiWaitingTime);
+        boost::this_thread::sleep_for(waitingTime);
 
         _synchronisationRegister.read();
+        ++nPollIterations;
       }
+    }
+    else {
+      // same timeout as for 10 sleeping cycles
+      auto timeout = start + 10 * std::chrono::microseconds(waitingTime.count());
+      auto endOfSpinning = timeout;
+      if(_waitStrategy == WaitStrategy::SPIN_THEN_YIELD) {
+        endOfSpinning = start + getExpectedLatency() * static_cast<int64_t>(nCommands);
+      }
+      while(_synchronisationRegister == SPI_SYNC_REQUESTED) {
+        auto now = std::chrono::steady_clock::now();
+        if(now > timeout) {
+          break;
+        }
+        if(now > endOfSpinning) {
+          boost::this_thread::yield();
+        }
+        _synchronisationRegister.read();
+        ++nPollIterations;
+      }
+    }
 
-      if(_synchronisationRegister != SPI_SYNC_REQUESTED) {
-        // break on either error or ok. If still in SPI_SYNC_REQUESTED repeat (up
-        // to 3 times)
-        break;
+    std::chrono::nanoseconds transactionLatency = std::chrono::steady_clock::now() - start;
+    countTransaction(transactionLatency, nPollIterations);
+    if(_synchronisationRegister == SPI_SYNC_REQUESTED) {
+      return;
+    }
+    std::chrono::nanoseconds latency = transactionLatency / static_cast<int64_t>(nCommands);
+    if(_latencyStatistics.nHandshakes == 0) {
+      _latencyStatistics.average = latency;
+      _latencyStatistics.minimum = latency;
+      _latencyStatistics.maximum = latency;
+    }
+    else {
+      // moving average with a weight of 1/8 for the new value
+      _latencyStatistics.average += (latency - _latencyStatistics.average) / 8;
+      _latencyStatistics.minimum = std::min<std::chrono::nanoseconds>(_latencyStatistics.minimum, latency);
+      _latencyStatistics.maximum = std::max<std::chrono::nanoseconds>(_latencyStatistics.maximum, latency);
+    }
+    _latencyStatistics.last = latency;
+    ++_latencyStatistics.nHandshakes;
+  }
+
+  std::chrono::nanoseconds SPIviaPCIe::getExpectedLatency() const {
+    // without a measurement the firmware is expected to need the spi waiting time
+    if(_latencyStatistics.nHandshakes == 0) {
+      return std::chrono::microseconds(_spiWaitingTime.count());
+    }
+    return _latencyStatistics.average;
+  }
+
+  void SPIviaPCIe::countTransaction(std::chrono::nanoseconds latency, uint64_t nPollIterations) {
+    // Only the _spiMutex holder writes, so relaxed operations are enough. They are cheap on all platforms.
+    auto& counters = _transactionCounters;
+    counters.nTransactions.fetch_add(1, std::memory_order_relaxed);
+    counters.nPollIterations.fetch_add(nPollIterations, std::memory_order_relaxed);
+    if(_synchronisationRegister == SPI_SYNC_REQUESTED) {
+      counters.nTimeouts.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if(_synchronisationRegister != SPI_SYNC_OK) {
+      counters.nErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+    counters.latencyHistogram[SpiTransactionCounters::getBin(latency)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void SPIviaPCIe::countRetry() {
+    _transactionCounters.nRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  class SPIviaPCIe::ArbitrationLock {
+   public:
+    explicit ArbitrationLock(SPIviaPCIe& spi) : _mutex(spi._arbitrationMutex) {
+      if(!_mutex) {
+        return;
+      }
+      auto& statistics = spi._arbitrationStatistics;
+      ++statistics.nLocks;
+      // the uncontended case costs only the try_lock
+      if(_mutex->try_lock()) {
+        return;
       }
+      auto start = std::chrono::steady_clock::now();
+      _mutex->lock();
+      std::chrono::nanoseconds waitingTime = std::chrono::steady_clock::now() - start;
+      ++statistics.nContended;
+      statistics.waitingTime += waitingTime;
+      statistics.maximumWaitingTime = std::max(statistics.maximumWaitingTime, waitingTime);
     }
+    ~ArbitrationLock() {
+      if(_mutex) {
+        _mutex->unlock();
+      }
+    }
+
+    ArbitrationLock(ArbitrationLock const&) = delete;
+    ArbitrationLock& operator=(ArbitrationLock const&) = delete;
+
+   private:
+    RobustMutex* _mutex;
+  };
+
+  /* The requests of the client threads are passed to the owner thread via
+   * lock-free queues, one per priority. The owner thread takes the requests of
+   * the highest priority which are waiting, executes them under the _spiMutex
+   * and marks them done. The clients only spin for a few checks and then block
+   * on the condition variable of their request, so waiting clients do not
+   * compete with the owner thread for the CPU. Only if the owner thread runs out
+   * of work it sleeps on a condition variable and has to be woken up by the next
+   * client. A client which finds its queue full blocks until the owner thread
+   * has taken requests from the queues.
+   *
+   * A batch of writeBatch() is one request, which is executed one chunk per
+   * handshake. Between the chunks the owner thread takes the requests of higher
+   * priority first.
+   */
+  class SPIviaPCIe::TransferThread {
+   public:
+    struct Request {
+      Request(int32_t command, bool isReadRequest, Priority requestPriority)
+      : spiCommand(command), isRead(isReadRequest), priority(requestPriority) {}
+      Request(std::vector<int32_t> const& commands, std::vector<TransferStatus>& status, Priority requestPriority)
+      : spiCommand(0), isRead(false), priority(requestPriority), batchCommands(&commands), batchStatus(&status) {}
+      int32_t spiCommand;
+      bool isRead;
+      Priority priority;
+      // only for batch requests
+      std::vector<int32_t> const* batchCommands{nullptr};
+      std::vector<TransferStatus>* batchStatus{nullptr};
+      size_t nBatchCommandsDone{0};
+      std::chrono::steady_clock::time_point submitted;
+      int32_t synchronisation{SPI_SYNC_REQUESTED}; ///< content of the sync register after the transfer
+      uint32_t readbackValue{0};
+
+      /// Called by the owner thread. The request must not be touched afterwards, the client might have returned.
+      void markDone() {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        done.store(true, std::memory_order_release);
+        doneCondition.notify_one();
+      }
+
+      void waitUntilDone() {
+        for(size_t i = 0; i < N_SPINS && !done.load(std::memory_order_acquire); ++i) {
+          std::this_thread::yield();
+        }
+        // Also taken if done has been seen while spinning: markDone() might still hold the mutex, which must not be
+        // destroyed with the request before it has been released.
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [this] { return done.load(std::memory_order_relaxed); });
+      }
+
+     private:
+      std::atomic<bool> done{false};
+      std::mutex doneMutex;
+      std::condition_variable doneCondition;
+    };
+
+    explicit TransferThread(SPIviaPCIe& spi)
+    : _spi(spi), _queues(), _nPending(0), _isSleeping(false), _nWaitingForSpace(0), _stop(false),
+      _batchesInProgress(), _thread([this] { run(); }) {}
 
-    // It might be inefficient to always create the error message, even if not
-    // needed, but it minimises code duplication.
+    ~TransferThread() {
+      _stop = true;
+      wakeUp();
+      _thread.join();
+    }
+
+    /// Called by the client threads. Returns when the request has been executed.
+    void execute(Request& request) {
+      auto& queue = _queues[static_cast<size_t>(request.priority)];
+      request.submitted = std::chrono::steady_clock::now();
+      // Counted before the push, otherwise the owner thread might take the request and decrease the depth first.
+      // A client which waits for space in the queue is included.
+      size_t depth = ++queue.depth;
+      size_t maximumDepth = queue.maximumDepth;
+      while(depth > maximumDepth && !queue.maximumDepth.compare_exchange_weak(maximumDepth, depth)) {
+      }
+      for(size_t i = 0; !queue.requests.bounded_push(&request); ++i) {
+        if(i < N_SPINS) {
+          std::this_thread::yield();
+        }
+        else {
+          waitForSpace(queue, request);
+          break;
+        }
+      }
+      ++_nPending;
+      if(_isSleeping) {
+        wakeUp();
+      }
+      request.waitUntilDone();
+    }
+
+    PriorityStatistics getStatistics(Priority priority) const {
+      auto const& queue = _queues[static_cast<size_t>(priority)];
+      std::lock_guard<std::mutex> lock(_statisticsMutex);
+      PriorityStatistics statistics;
+      statistics.nRequests = queue.nRequests;
+      statistics.queueDepth = queue.depth;
+      statistics.maximumQueueDepth = queue.maximumDepth;
+      if(queue.nRequests) {
+        statistics.averageLatency = queue.totalLatency / static_cast<int64_t>(queue.nRequests);
+      }
+      statistics.maximumLatency = queue.maximumLatency;
+      return statistics;
+    }
+
+    void resetStatistics() {
+      std::lock_guard<std::mutex> lock(_statisticsMutex);
+      for(auto& queue : _queues) {
+        queue.maximumDepth = queue.depth.load();
+        queue.nRequests = 0;
+        queue.totalLatency = std::chrono::nanoseconds(0);
+        queue.maximumLatency = std::chrono::nanoseconds(0);
+      }
+    }
+
+   private:
+    static size_t const QUEUE_SIZE = 64;
+    /// Number of checks before a client blocks. Enough for a request which is executed right away.
+    static size_t const N_SPINS = 16;
+
+    struct PriorityQueue {
+      boost::lockfree::queue<Request*, boost::lockfree::capacity<QUEUE_SIZE>> requests;
+      std::atomic<size_t> depth{0};
+      std::atomic<size_t> maximumDepth{0};
+      // written by the owner thread, protected by the _statisticsMutex
+      size_t nRequests{0};
+      std::chrono::nanoseconds totalLatency{0};
+      std::chrono::nanoseconds maximumLatency{0};
+    };
+
+    SPIviaPCIe& _spi;
+    std::array<PriorityQueue, N_PRIORITIES> _queues;
+    std::atomic<size_t> _nPending;
+    std::atomic<bool> _isSleeping;
+    std::atomic<size_t> _nWaitingForSpace;
+    std::atomic<bool> _stop;
+    std::mutex _wakeUpMutex;
+    std::condition_variable _wakeUpCondition;
+    std::mutex _spaceMutex;
+    std::condition_variable _spaceCondition;
+    // only used by the owner thread, at most one batch per priority
+    std::array<Request*, N_PRIORITIES> _batchesInProgress;
+    mutable std::mutex _statisticsMutex;
+    std::thread _thread;
+
+    void wakeUp() {
+      std::lock_guard<std::mutex> lock(_wakeUpMutex);
+      _wakeUpCondition.notify_one();
+    }
+
+    void waitForSpace(PriorityQueue& queue, Request& request) {
+      std::unique_lock<std::mutex> lock(_spaceMutex);
+      // Like for _nPending and _isSleeping: either the owner thread sees the waiting client after it has taken
+      // requests, or the client sees the free space when it tries again.
+      ++_nWaitingForSpace;
+      while(!queue.requests.bounded_push(&request)) {
+        _spaceCondition.wait(lock);
+      }
+      --_nWaitingForSpace;
+    }
+
+    void notifySpace() {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if(_nWaitingForSpace > 0) {
+        std::lock_guard<std::mutex> lock(_spaceMutex);
+        _spaceCondition.notify_all();
+      }
+    }
+
+    void run() {
+      std::vector<Request*> requests;
+      requests.reserve(QUEUE_SIZE);
+      std::vector<int32_t> spiCommands;
+      spiCommands.reserve(QUEUE_SIZE);
+      std::vector<TransferStatus> status;
+      while(true) {
+        if(!takeRequests(requests)) {
+          if(_stop) {
+            return;
+          }
+          waitForRequests();
+          continue;
+        }
+        notifySpace();
+        {
+          std::lock_guard<std::mutex> guard(_spi._spiMutex);
+          ArbitrationLock arbitrationLock(_spi);
+          executeRequests(requests, spiCommands, status);
+        }
+        if(requests.back() == batchInProgress(requests.back()->priority)) {
+          // continued after the requests of higher priority
+          requests.pop_back();
+        }
+        updateStatistics(requests);
+        for(auto r : requests) {
+          r->markDone();
+        }
+        requests.clear();
+      }
+    }
+
+    /* Take the requests which are executed next from the queue with the highest
+     * priority. Consecutive writes are taken together, so they can be combined
+     * into one batch. A read ends the group, so a higher priority only has to wait
+     * for one read handshake. A batch request is taken alone. It is continued
+     * before the queue of its priority, because it has been submitted earlier.
+     * A batch of higher priority interrupts it between two chunks, each
+     * priority has its own batch in progress.
+     * Returns false if all queues are empty and no batch is in progress.
+     */
+    bool takeRequests(std::vector<Request*>& requests) {
+      for(size_t priority = 0; priority < N_PRIORITIES; ++priority) {
+        auto& queue = _queues[priority];
+        auto& batchInProgress = _batchesInProgress[priority];
+        if(batchInProgress) {
+          requests.push_back(batchInProgress);
+          return true;
+        }
+        Request* request;
+        while(requests.size() < QUEUE_SIZE && queue.requests.pop(request)) {
+          --queue.depth;
+          --_nPending;
+          if(request->batchCommands) {
+            // started in the next round if there are requests before it
+            batchInProgress = request;
+            break;
+          }
+          requests.push_back(request);
+          if(request->isRead) {
+            break;
+          }
+        }
+        if(!requests.empty()) {
+          return true;
+        }
+        if(batchInProgress) {
+          requests.push_back(batchInProgress);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    Request*& batchInProgress(Priority priority) { return _batchesInProgress[static_cast<size_t>(priority)]; }
+
+    void waitForRequests() {
+      // The client increments _nPending before checking _isSleeping, so either the
+      // client sees the flag or the predicate sees the pending request.
+      _isSleeping = true;
+      std::unique_lock<std::mutex> lock(_wakeUpMutex);
+      _wakeUpCondition.wait(lock, [this] { return _nPending > 0 || _stop; });
+      _isSleeping = false;
+    }
+
+    void updateStatistics(std::vector<Request*> const& requests) {
+      auto now = std::chrono::steady_clock::now();
+      std::lock_guard<std::mutex> lock(_statisticsMutex);
+      for(auto r : requests) {
+        auto& queue = _queues[static_cast<size_t>(r->priority)];
+        std::chrono::nanoseconds latency = now - r->submitted;
+        ++queue.nRequests;
+        queue.totalLatency += latency;
+        queue.maximumLatency = std::max(queue.maximumLatency, latency);
+      }
+    }
+
+    void executeRequests(
+        std::vector<Request*> const& requests, std::vector<int32_t>& spiCommands, std::vector<TransferStatus>& status) {
+      if(requests.front()->batchCommands) {
+        auto& batch = *requests.front();
+        if(!_spi.transferBatchChunk(*batch.batchCommands, batch.nBatchCommandsDone, *batch.batchStatus) ||
+            batch.nBatchCommandsDone == batch.batchCommands->size()) {
+          batchInProgress(batch.priority) = nullptr;
+        }
+        return;
+      }
+
+      size_t i = 0;
+      while(i < requests.size()) {
+        if(requests[i]->isRead) {
+          auto& readRequest = *requests[i++];
+          readRequest.synchronisation = _spi.transferWord(readRequest.spiCommand);
+          if(readRequest.synchronisation == SPI_SYNC_OK) {
+            readRequest.readbackValue = _spi.readback();
+          }
+          continue;
+        }
+
+        // consecutive writes are combined into one batch
+        size_t end = i;
+        spiCommands.clear();
+        while(end < requests.size() && !requests[end]->isRead) {
+          spiCommands.push_back(requests[end++]->spiCommand);
+        }
+        if(spiCommands.size() == 1 || !_spi.hasBatchSupport()) {
+          for(; i < end; ++i) {
+            requests[i]->synchronisation = _spi.transferWord(requests[i]->spiCommand);
+          }
+          continue;
+        }
+        _spi.writeBatchUnlocked(spiCommands, status);
+        for(size_t j = 0; i < end; ++i, ++j) {
+          switch(status[j]) {
+            case TransferStatus::OK:
+              requests[i]->synchronisation = SPI_SYNC_OK;
+              break;
+            case TransferStatus::TIMEOUT:
+              requests[i]->synchronisation = SPI_SYNC_REQUESTED;
+              break;
+            case TransferStatus::ERROR:
+              requests[i]->synchronisation = SPI_SYNC_ERROR;
+              break;
+            case TransferStatus::NOT_EXECUTED:
+              // another client's command has failed, this one is tried on its own
+              requests[i]->synchronisation = _spi.transferWord(requests[i]->spiCommand);
+              break;
+          }
+        }
+      }
+    }
+  };
+
+  SPIviaPCIe::~SPIviaPCIe() = default;
+
+  void SPIviaPCIe::write(int32_t spiCommand, Priority priority) {
+    if(_transferThread) {
+      TransferThread::Request request(spiCommand, false, priority);
+      _transferThread->execute(request);
+      checkSynchronisation(request.synchronisation, spiCommand);
+      return;
+    }
+    auto guard = lockSpi(priority);
+    ArbitrationLock arbitrationLock(*this);
+    transferWordOrThrow(spiCommand);
+  }
+
+  std::unique_lock<std::mutex> SPIviaPCIe::lockSpi(Priority priority) {
+    if(priority != Priority::EMERGENCY_STOP) {
+      // Let waiting emergency stops go first. This is only a hint, the mutex decides who gets the SPI.
+      if(_nWaitingEmergencyStops > 0) {
+        waitForEmergencyStops();
+      }
+      return std::unique_lock<std::mutex>(_spiMutex);
+    }
+    ++_nWaitingEmergencyStops;
+    std::unique_lock<std::mutex> guard(_spiMutex);
+    if(--_nWaitingEmergencyStops == 0) {
+      std::lock_guard<std::mutex> lock(_emergencyStopMutex);
+      _emergencyStopCondition.notify_all();
+    }
+    return guard;
+  }
+
+  void SPIviaPCIe::waitForEmergencyStops() {
+    std::unique_lock<std::mutex> lock(_emergencyStopMutex);
+    _emergencyStopCondition.wait(lock, [this] { return _nWaitingEmergencyStops == 0; });
+  }
+
+  void SPIviaPCIe::transferWordOrThrow(int32_t spiCommand) {
+    checkSynchronisation(transferWord(spiCommand), spiCommand);
+  }
+
+  void SPIviaPCIe::checkSynchronisation(int32_t synchronisation, int32_t spiCommand) const {
+    if(synchronisation == SPI_SYNC_OK) {
+      return;
+    }
     std::stringstream errorDetails;
     errorDetails << "PCIe register " << _moduleName << "." << _writeRegisterName << ", sync register " << _moduleName
-                 << "." << _syncRegisterName << "= 0x" << std::hex << _synchronisationRegister << ", spi command 0x"
+                 << "." << _syncRegisterName << "= 0x" << std::hex << synchronisation << ", spi command 0x"
                  << std::hex << spiCommand << std::dec;
-    switch(_synchronisationRegister) {
-      case SPI_SYNC_OK:
+    if(synchronisation == SPI_SYNC_REQUESTED) {
+      throw ChimeraTK::runtime_error("Timeout writing via SPI, " + errorDetails.str());
+    }
+    throw ChimeraTK::runtime_error("Error writing via SPI, " + errorDetails.str());
+  }
+
+  std::vector<SPIviaPCIe::TransferStatus> SPIviaPCIe::writeBatch(
+      std::vector<int32_t> const& spiCommands, Priority priority) {
+    std::vector<TransferStatus> status;
+    if(_transferThread && !spiCommands.empty()) {
+      status.assign(spiCommands.size(), TransferStatus::NOT_EXECUTED);
+      TransferThread::Request request(spiCommands, status, priority);
+      _transferThread->execute(request);
+      return status;
+    }
+    auto guard = lockSpi(priority);
+    std::optional<ArbitrationLock> arbitrationLock(std::in_place, *this);
+    status.assign(spiCommands.size(), TransferStatus::NOT_EXECUTED);
+    size_t nDone = 0;
+    while(nDone < spiCommands.size() && transferBatchChunk(spiCommands, nDone, status)) {
+      // An emergency stop only waits for the handshake in progress, not for the whole batch
+      if(_nWaitingEmergencyStops > 0 && nDone < spiCommands.size()) {
+        arbitrationLock.reset();
+        guard.unlock();
+        waitForEmergencyStops();
+        guard = lockSpi(priority);
+        arbitrationLock.emplace(*this);
+      }
+    }
+    return status;
+  }
+
+  void SPIviaPCIe::writeBatchUnlocked(std::vector<int32_t> const& spiCommands, std::vector<TransferStatus>& status) {
+    status.assign(spiCommands.size(), TransferStatus::NOT_EXECUTED);
+    size_t nDone = 0;
+    while(nDone < spiCommands.size() && transferBatchChunk(spiCommands, nDone, status)) {
+    }
+  }
+
+  bool SPIviaPCIe::transferBatchChunk(
+      std::vector<int32_t> const& spiCommands, size_t& nDone, std::vector<TransferStatus>& status) {
+    if(!hasBatchSupport()) {
+      if(transferWord(spiCommands[nDone]) == SPI_SYNC_OK) {
+        status[nDone++] = TransferStatus::OK;
+        return true;
+      }
+      status[nDone] =
+          (_synchronisationRegister == SPI_SYNC_REQUESTED ? TransferStatus::TIMEOUT : TransferStatus::ERROR);
+      return false;
+    }
+
+    size_t chunkEnd = nDone + std::min(spiCommands.size() - nDone, static_cast<size_t>(_batchRegister.getNElements()));
+    // retry timed out batches up to three times, like in write()
+    for(int nAttempts = 0; nAttempts < 3 && nDone < chunkEnd; ++nAttempts) {
+      if(nAttempts > 0) {
+        countRetry();
+      }
+      size_t nCommands = chunkEnd - nDone;
+      _synchronisationRegister = SPI_SYNC_REQUESTED;
+      _synchronisationRegister.write();
+
+      std::copy(spiCommands.begin() + nDone, spiCommands.begin() + chunkEnd, _batchRegister.begin());
+      _batchRegister.write();
+
+      // writing the number of commands starts the transfer
+      auto start = std::chrono::steady_clock::now();
+      _batchSizeRegister = static_cast<int32_t>(nCommands);
+      _batchSizeRegister.write();
+
+      // the transfer takes about one waiting time per command
+      waitForSynchronisation(nCommands, start);
+
+      // The firmware counts the batch size register down with each executed
+      // command, see DFMC_MD22Constants.h. Also after a timeout only the commands
+      // which have not been executed yet are sent again.
+      _batchSizeRegister.read();
+      size_t nNotExecuted = std::min(static_cast<size_t>(std::max(int32_t(_batchSizeRegister), 0)), nCommands);
+      std::fill(status.begin() + static_cast<ptrdiff_t>(nDone),
+          status.begin() + static_cast<ptrdiff_t>(chunkEnd - nNotExecuted), TransferStatus::OK);
+      nDone = chunkEnd - nNotExecuted;
+      if(nDone == chunkEnd && _synchronisationRegister == SPI_SYNC_OK) {
+        return true;
+      }
+      if(_synchronisationRegister != SPI_SYNC_REQUESTED) {
         break;
-      case SPI_SYNC_REQUESTED:
-        throw ChimeraTK::runtime_error("Timeout writing via SPI, " + errorDetails.str());
-      case SPI_SYNC_ERROR:
-      default:
-        throw ChimeraTK::runtime_error("Error writing via SPI, " + errorDetails.str());
+      }
     }
+
+    // The command at nDone has failed. An inconsistent report with all commands
+    // executed but no sync ok is attributed to the last command of this batch.
+    size_t failedCommand = std::min(nDone, chunkEnd - 1);
+    status[failedCommand] =
+        (_synchronisationRegister == SPI_SYNC_REQUESTED ? TransferStatus::TIMEOUT : TransferStatus::ERROR);
+    return false;
   }
 
-  uint32_t SPIviaPCIe::read(int32_t spiCommand) {
-    boost::lock_guard<boost::recursive_mutex> guard(_spiMutex);
+  bool SPIviaPCIe::hasBatchSupport() const {
+    return _batchRegister.isInitialised();
+  }
+
+  uint32_t SPIviaPCIe::read(int32_t spiCommand, Priority priority) {
+    if(_transferThread) {
+      TransferThread::Request request(spiCommand, true, priority);
+      _transferThread->execute(request);
+      checkSynchronisation(request.synchronisation, spiCommand);
+      return request.readbackValue;
+    }
+    auto guard = lockSpi(priority);
+    // the readback register must not be overwritten by another process before it has been read
+    ArbitrationLock arbitrationLock(*this);
 
     // this is easy: the write does all the sync. And after a successful sync we
     // know that the readback word is valid.
-    write(spiCommand);
+    transferWordOrThrow(spiCommand);
+    return readback();
+  }
 
+  uint32_t SPIviaPCIe::readback() {
     _readbackRegister.read();
     return static_cast<uint32_t>(_readbackRegister);
   }
 
   void SPIviaPCIe::setSpiWaitingTime(unsigned int microSeconds) {
-    boost::lock_guard<boost::recursive_mutex> guard(_spiMutex);
+    std::lock_guard<std::mutex> guard(_spiMutex);
     _spiWaitingTime = boost::chrono::microseconds(microSeconds);
   }
 
   unsigned int SPIviaPCIe::getSpiWaitingTime() const {
-    boost::lock_guard<boost::recursive_mutex> guard(_spiMutex);
+    std::lock_guard<std::mutex> guard(_spiMutex);
     return static_cast<unsigned int>(_spiWaitingTime.count());
   }
 
+  void SPIviaPCIe::setWaitStrategy(WaitStrategy waitStrategy) {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    _waitStrategy = waitStrategy;
+  }
+
+  SPIviaPCIe::WaitStrategy SPIviaPCIe::getWaitStrategy() const {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    return _waitStrategy;
+  }
+
+  SPIviaPCIe::LatencyStatistics SPIviaPCIe::getLatencyStatistics() const {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    return _latencyStatistics;
+  }
+
+  void SPIviaPCIe::resetLatencyStatistics() {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    _latencyStatistics = LatencyStatistics();
+  }
+
+  void SPIviaPCIe::setInterprocessArbitration(boost::shared_ptr<SpiArbitration> const& arbitration) {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    _arbitrationMutex = arbitration ? &arbitration->getMutex(_writeRegisterName) : nullptr;
+    _arbitration = arbitration;
+  }
+
+  SPIviaPCIe::ArbitrationStatistics SPIviaPCIe::getArbitrationStatistics() const {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    return _arbitrationStatistics;
+  }
+
+  void SPIviaPCIe::resetArbitrationStatistics() {
+    std::lock_guard<std::mutex> guard(_spiMutex);
+    _arbitrationStatistics = ArbitrationStatistics();
+  }
+
+  void SPIviaPCIe::enableTransferThread(bool enable) {
+    if(enable && !_transferThread) {
+      _transferThread.reset(new TransferThread(*this));
+    }
+    else if(!enable) {
+      _transferThread.reset();
+    }
+  }
+
+  bool SPIviaPCIe::hasTransferThread() const {
+    return _transferThread != nullptr;
+  }
+
+  SPIviaPCIe::PriorityStatistics SPIviaPCIe::getPriorityStatistics(Priority priority) const {
+    if(!_transferThread) {
+      return PriorityStatistics();
+    }
+    return _transferThread->getStatistics(priority);
+  }
+
+  void SPIviaPCIe::resetPriorityStatistics() {
+    if(_transferThread) {
+      _transferThread->resetStatistics();
+    }
+  }
+
+  SpiTransactionCounters SPIviaPCIe::getTransactionCounters() const {
+    auto const& counters = _transactionCounters;
+    SpiTransactionCounters result;
+    result.nTransactions = counters.nTransactions.load(std::memory_order_relaxed);
+    result.nRetries = counters.nRetries.load(std::memory_order_relaxed);
+    result.nTimeouts = counters.nTimeouts.load(std::memory_order_relaxed);
+    result.nErrors = counters.nErrors.load(std::memory_order_relaxed);
+    result.nPollIterations = counters.nPollIterations.load(std::memory_order_relaxed);
+    for(size_t bin = 0; bin < SpiTransactionCounters::N_LATENCY_BINS; ++bin) {
+      result.latencyHistogram[bin] = counters.latencyHistogram[bin].load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  void SPIviaPCIe::resetTransactionCounters() {
+    auto& counters = _transactionCounters;
+    counters.nTransactions.store(0, std::memory_order_relaxed);
+    counters.nRetries.store(0, std::memory_order_relaxed);
+    counters.nTimeouts.store(0, std::memory_order_relaxed);
+    counters.nErrors.store(0, std::memory_order_relaxed);
+    counters.nPollIterations.store(0, std::memory_order_relaxed);
+    for(auto& bin : counters.latencyHistogram) {
+      bin.store(0, std::memory_order_relaxed);
+    }
+  }
+
 } // namespace mtca4u
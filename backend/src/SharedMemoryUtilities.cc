@@ -0,0 +1,59 @@
+#include "impl/SharedMemoryUtilities.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <cctype>
+#include <cerrno>
+
+namespace mtca4u {
+
+  RobustMutex::RobustMutex() {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&_mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+  }
+
+  RobustMutex::~RobustMutex() {
+    pthread_mutex_destroy(&_mutex);
+  }
+
+  void RobustMutex::lock() {
+    int result = pthread_mutex_lock(&_mutex);
+    if(!handleLockResult(result)) {
+      throw ChimeraTK::runtime_error("RobustMutex: Cannot lock the mutex, error code " + std::to_string(result));
+    }
+  }
+
+  bool RobustMutex::try_lock() {
+    return handleLockResult(pthread_mutex_trylock(&_mutex));
+  }
+
+  void RobustMutex::unlock() {
+    pthread_mutex_unlock(&_mutex);
+  }
+
+  bool RobustMutex::handleLockResult(int result) {
+    if(result == EOWNERDEAD) {
+      // The previous owner has died while holding the mutex. We own it now, but
+      // it has to be marked consistent to be usable after the unlock.
+      pthread_mutex_consistent(&_mutex);
+      return true;
+    }
+    return result == 0;
+  }
+
+  std::string createSharedMemoryName(
+      std::string const& prefix, std::string const& deviceAlias, std::string const& moduleName) {
+    std::string name = prefix + "_" + deviceAlias + "_" + moduleName;
+    for(auto& c : name) {
+      if(!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-' && c != '.') {
+        c = '_';
+      }
+    }
+    return name;
+  }
+
+} // namespace mtca4u
@@ -0,0 +1,43 @@
+#include "impl/SpiArbitration.h"
+
+#include <ChimeraTK/Exception.h>
+
+namespace mtca4u {
+
+  // Increase if the layout of the shared memory changes
+  static unsigned int const ARBITRATION_VERSION = 1;
+  // A card has a few SPIs, each needs a mutex and its name
+  static size_t const SHARED_MEMORY_SIZE = 4096;
+
+  SpiArbitration::SpiArbitration(std::string const& deviceAlias, std::string const& moduleName)
+  : _sharedMemory() {
+    try {
+      _sharedMemory = boost::interprocess::managed_shared_memory(
+          boost::interprocess::open_or_create, sharedMemoryName(deviceAlias, moduleName).c_str(), SHARED_MEMORY_SIZE);
+    }
+    catch(boost::interprocess::interprocess_exception& e) {
+      throw ChimeraTK::runtime_error("SpiArbitration: Cannot open shared memory for " + deviceAlias + "/" +
+          moduleName + ": " + e.what());
+    }
+  }
+
+  RobustMutex& SpiArbitration::getMutex(std::string const& spiName) {
+    try {
+      // construction is atomic, only the first process initialises the mutex
+      return *_sharedMemory.find_or_construct<RobustMutex>(spiName.c_str())();
+    }
+    catch(boost::interprocess::interprocess_exception& e) {
+      throw ChimeraTK::runtime_error("SpiArbitration: Cannot create the mutex for " + spiName + ": " + e.what());
+    }
+  }
+
+  void SpiArbitration::remove(std::string const& deviceAlias, std::string const& moduleName) {
+    boost::interprocess::shared_memory_object::remove(sharedMemoryName(deviceAlias, moduleName).c_str());
+  }
+
+  std::string SpiArbitration::sharedMemoryName(std::string const& deviceAlias, std::string const& moduleName) {
+    return createSharedMemoryName(
+        "MotorDriverCardSpi_v" + std::to_string(ARBITRATION_VERSION), deviceAlias, moduleName);
+  }
+
+} // namespace mtca4u
@@ -2,8 +2,19 @@
 
 #include "TMC429Constants.h"
 
+#include <sstream>
+
 namespace mtca4u {
 
+  class TMC429SPI::WriteCounter {
+   public:
+    explicit WriteCounter(std::atomic<uint64_t>& writeCount) : _writeCount(writeCount) {}
+    ~WriteCounter() { _writeCount.fetch_add(1, std::memory_order_release); }
+
+   private:
+    std::atomic<uint64_t>& _writeCount;
+  };
+
   // TMC429SPI::TMC429SPI(  boost::shared_ptr< Device<BaseDevice> > const &
   // device,
   TMC429SPI::TMC429SPI(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
@@ -11,7 +22,14 @@ namespace mtca4u {
       std::string const& readbackRegisterName, unsigned int spiWaitingTime)
   : _spiViaPCIe(device, moduleName, writeRegisterName, syncRegisterName, readbackRegisterName, spiWaitingTime) {}
 
-  TMC429OutputWord TMC429SPI::read(unsigned int smda, unsigned int idx_jdx) {
+  TMC429SPI::TMC429SPI(boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
+      std::string const& writeRegisterName, std::string const& syncRegisterName,
+      std::string const& readbackRegisterName, std::string const& batchRegisterName,
+      std::string const& batchSizeRegisterName, unsigned int spiWaitingTime)
+  : _spiViaPCIe(device, moduleName, writeRegisterName, syncRegisterName, readbackRegisterName, batchRegisterName,
+        batchSizeRegisterName, spiWaitingTime) {}
+
+  TMC429OutputWord TMC429SPI::read(unsigned int smda, unsigned int idx_jdx, SPIviaPCIe::Priority priority) {
     // Although the first half is almost identical to write,
     // the preparation of the TMC429InputWord is different. So we accept a little
     // code duplication here.
@@ -20,20 +38,86 @@ namespace mtca4u {
     readRequest.setIDX_JDX(idx_jdx);
     readRequest.setRW(tmc429::RW_READ);
 
-    return TMC429OutputWord(_spiViaPCIe.read(readRequest.getDataWord()));
+    return TMC429OutputWord(_spiViaPCIe.read(readRequest.getDataWord(), priority));
   }
 
-  void TMC429SPI::write(unsigned int smda, unsigned int idx_jdx, unsigned int data) {
+  void TMC429SPI::write(unsigned int smda, unsigned int idx_jdx, unsigned int data, SPIviaPCIe::Priority priority) {
     TMC429InputWord writeMe;
     writeMe.setSMDA(smda);
     writeMe.setIDX_JDX(idx_jdx);
     writeMe.setRW(tmc429::RW_WRITE);
     writeMe.setDATA(data);
-    write(writeMe);
+    write(writeMe, priority);
+  }
+
+  void TMC429SPI::write(TMC429InputWord const& writeWord, SPIviaPCIe::Priority priority) {
+    WriteCounter writeCounter(_writeCount);
+    _spiViaPCIe.write(writeWord.getDataWord(), priority);
+  }
+
+  std::vector<SPIviaPCIe::TransferStatus> TMC429SPI::write(
+      std::vector<TMC429InputWord> const& writeWords, SPIviaPCIe::Priority priority) {
+    std::vector<int32_t> spiCommands;
+    spiCommands.reserve(writeWords.size());
+    for(auto const& writeWord : writeWords) {
+      spiCommands.push_back(writeWord.getDataWord());
+    }
+    WriteCounter writeCounter(_writeCount);
+    return _spiViaPCIe.writeBatch(spiCommands, priority);
+  }
+
+  size_t TMC429SPI::writeConfiguration(std::vector<TMC429InputWord> const& writeWords, bool onlyDifferences) {
+    std::vector<TMC429InputWord> wordsToWrite;
+    for(auto const& writeWord : writeWords) {
+      if(!onlyDifferences || !readsBackWrittenData(writeWord) ||
+          read(writeWord.getSMDA(), writeWord.getIDX_JDX()).getDATA() != writeWord.getDATA()) {
+        wordsToWrite.push_back(writeWord);
+      }
+    }
+    if(wordsToWrite.empty()) {
+      return 0;
+    }
+
+    auto transferStatus = write(wordsToWrite);
+    for(size_t i = 0; i < transferStatus.size(); ++i) {
+      if(transferStatus[i] != SPIviaPCIe::TransferStatus::OK) {
+        std::stringstream errorMessage;
+        errorMessage << "Error writing via SPI, configuration word 0x" << std::hex << wordsToWrite[i].getDataWord()
+                     << " has not been written.";
+        throw ChimeraTK::runtime_error(errorMessage.str());
+      }
+    }
+    return wordsToWrite.size();
+  }
+
+  bool TMC429SPI::readsBackWrittenData(TMC429InputWord const& word) {
+    // Reading the datagram words returns the datagram received from the drivers
+    return word.getSMDA() != tmc429::SMDA_COMMON ||
+        (word.getIDX_JDX() != tmc429::JDX_DATAGRAM_LOW_WORD && word.getIDX_JDX() != tmc429::JDX_DATAGRAM_HIGH_WORD);
+  }
+
+  void TMC429SPI::setInterprocessArbitration(boost::shared_ptr<SpiArbitration> const& arbitration) {
+    _spiViaPCIe.setInterprocessArbitration(arbitration);
+  }
+
+  SPIviaPCIe::ArbitrationStatistics TMC429SPI::getArbitrationStatistics() const {
+    return _spiViaPCIe.getArbitrationStatistics();
+  }
+
+  void TMC429SPI::enableTransferThread(bool enable) {
+    _spiViaPCIe.enableTransferThread(enable);
+  }
+
+  SPIviaPCIe::PriorityStatistics TMC429SPI::getPriorityStatistics(SPIviaPCIe::Priority priority) const {
+    return _spiViaPCIe.getPriorityStatistics(priority);
+  }
+
+  SpiTransactionCounters TMC429SPI::getTransactionCounters() const {
+    return _spiViaPCIe.getTransactionCounters();
   }
 
-  void TMC429SPI::write(TMC429InputWord const& writeWord) {
-    _spiViaPCIe.write(writeWord.getDataWord());
+  void TMC429SPI::resetTransactionCounters() {
+    _spiViaPCIe.resetTransactionCounters();
   }
 
 } // namespace mtca4u
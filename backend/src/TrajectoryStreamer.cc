@@ -0,0 +1,246 @@
+#include "TrajectoryStreamer.h"
+
+#include "MotorControlerExpert.h"
+#include "TMC429Constants.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace mtca4u {
+
+  // The target velocity is a 12 bit signed value
+  static int const MAX_TARGET_VELOCITY = 2047;
+
+  TrajectoryStreamer::TrajectoryStreamer(
+      boost::shared_ptr<MotorControler> const& motorControler, Mode mode, std::chrono::microseconds updatePeriod)
+  : _motorControler(motorControler), _motorControlerExpert(), _mode(mode), _updatePeriod(updatePeriod),
+    _trajectory(), _feederThread(), _stopRequested(false), _isRunning(false), _positionGain(0), _error(),
+    _statistics(), _sumOfLateness(0), _sumOfSquaredErrors(0) {
+    if(!_motorControler) {
+      throw ChimeraTK::logic_error("TrajectoryStreamer: The motor controler must not be null.");
+    }
+    if(_updatePeriod <= std::chrono::microseconds(0)) {
+      throw ChimeraTK::logic_error("TrajectoryStreamer: The update period must be positive.");
+    }
+    if(_mode == Mode::VELOCITY) {
+      _motorControlerExpert = boost::dynamic_pointer_cast<MotorControlerExpert>(_motorControler);
+      if(!_motorControlerExpert) {
+        throw ChimeraTK::logic_error(
+            "TrajectoryStreamer: Velocity mode needs a MotorControlerExpert to set the ramp mode.");
+      }
+    }
+  }
+
+  TrajectoryStreamer::~TrajectoryStreamer() {
+    try {
+      stop();
+    }
+    catch(...) {
+      // a destructor must not throw. The error has been reported to the feeder thread already.
+    }
+  }
+
+  void TrajectoryStreamer::start(std::vector<TrajectoryPoint> trajectory) {
+    checkTrajectory(trajectory);
+    std::lock_guard<std::mutex> controlGuard(_controlMutex);
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_isRunning) {
+        throw ChimeraTK::logic_error("TrajectoryStreamer::start(): The streamer is already running.");
+      }
+    }
+    if(_feederThread.joinable()) {
+      _feederThread.join();
+    }
+    _trajectory = std::move(trajectory);
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _stopRequested = false;
+      _isRunning = true;
+      _error = nullptr;
+      _statistics = Statistics();
+      _sumOfLateness = 0;
+      _sumOfSquaredErrors = 0;
+    }
+    _feederThread = std::thread(&TrajectoryStreamer::feederThreadFunction, this);
+  }
+
+  void TrajectoryStreamer::stop() {
+    std::lock_guard<std::mutex> controlGuard(_controlMutex);
+    if(!_feederThread.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _stopRequested = true;
+    }
+    _stopCondition.notify_all();
+    _feederThread.join();
+  }
+
+  bool TrajectoryStreamer::isRunning() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _isRunning;
+  }
+
+  void TrajectoryStreamer::waitUntilFinished() {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _stopCondition.wait(lock, [&] { return !_isRunning; });
+    }
+    {
+      std::lock_guard<std::mutex> controlGuard(_controlMutex);
+      if(_feederThread.joinable()) {
+        _feederThread.join();
+      }
+    }
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      std::swap(error, _error);
+    }
+    if(error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  TrajectoryStreamer::Statistics TrajectoryStreamer::getStatistics() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _statistics;
+  }
+
+  void TrajectoryStreamer::setPositionGain(double positionGain) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _positionGain = positionGain;
+  }
+
+  void TrajectoryStreamer::feederThreadFunction() {
+    unsigned int originalRampMode = tmc429::RAMP_MODE_RAMP;
+    try {
+      if(_mode == Mode::VELOCITY) {
+        auto rampModeData = _motorControlerExpert->getReferenceConfigAndRampModeData();
+        originalRampMode = rampModeData.getRampMode();
+        _motorControler->setTargetVelocity(0);
+        rampModeData.setRampMode(tmc429::RAMP_MODE_VELOCITY);
+        _motorControlerExpert->setReferenceConfigAndRampModeData(rampModeData);
+      }
+
+      auto startTime = std::chrono::steady_clock::now();
+      auto scheduledTime = startTime;
+      while(true) {
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          if(_stopCondition.wait_until(lock, scheduledTime, [&] { return _stopRequested; })) {
+            break;
+          }
+        }
+        auto now = std::chrono::steady_clock::now();
+        auto lateness = std::chrono::duration_cast<std::chrono::microseconds>(now - scheduledTime);
+        auto elapsedTime = std::chrono::duration_cast<std::chrono::microseconds>(now - startTime);
+
+        auto setpoint = interpolate(elapsedTime);
+        auto actualPosition = _motorControler->getActualPosition();
+        if(elapsedTime >= _trajectory.back().time) {
+          finishMotion(setpoint.position, originalRampMode);
+          recordUpdate(lateness, setpoint.position - actualPosition);
+          std::lock_guard<std::mutex> guard(_mutex);
+          _isRunning = false;
+          _stopCondition.notify_all();
+          return;
+        }
+        sendSetpoint(setpoint, actualPosition);
+        recordUpdate(lateness, setpoint.position - actualPosition);
+
+        // Schedule the next update on the fixed time grid. Updates which have been
+        // missed because the thread was late are skipped, not sent in a burst.
+        auto nPeriods = (std::chrono::steady_clock::now() - startTime) / _updatePeriod + 1;
+        scheduledTime = startTime + nPeriods * _updatePeriod;
+      }
+
+      // stopped before the end of the trajectory
+      finishMotion(_motorControler->getActualPosition(), originalRampMode);
+    }
+    catch(...) {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> guard(_mutex);
+    _isRunning = false;
+    _stopCondition.notify_all();
+  }
+
+  TrajectoryPoint TrajectoryStreamer::interpolate(std::chrono::microseconds time) const {
+    if(time <= _trajectory.front().time) {
+      return _trajectory.front();
+    }
+    if(time >= _trajectory.back().time) {
+      return _trajectory.back();
+    }
+    // the first point which is later than time, there is one before it
+    auto next = std::upper_bound(_trajectory.begin(), _trajectory.end(), time,
+        [](std::chrono::microseconds t, TrajectoryPoint const& point) { return t < point.time; });
+    auto previous = next - 1;
+    double fraction =
+        static_cast<double>((time - previous->time).count()) / static_cast<double>((next->time - previous->time).count());
+    return TrajectoryPoint{time,
+        previous->position + static_cast<int>(std::lround(fraction * (next->position - previous->position))),
+        previous->velocity + static_cast<int>(std::lround(fraction * (next->velocity - previous->velocity)))};
+  }
+
+  void TrajectoryStreamer::sendSetpoint(TrajectoryPoint const& setpoint, int actualPosition) {
+    if(_mode == Mode::POSITION) {
+      _motorControler->setTargetPosition(setpoint.position);
+      return;
+    }
+    double positionGain;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      positionGain = _positionGain;
+    }
+    auto velocity = setpoint.velocity + std::lround(positionGain * (setpoint.position - actualPosition));
+    velocity = std::max<long>(-MAX_TARGET_VELOCITY, std::min<long>(MAX_TARGET_VELOCITY, velocity));
+    _motorControler->setTargetVelocity(static_cast<int>(velocity));
+  }
+
+  void TrajectoryStreamer::finishMotion(int targetPosition, unsigned int originalRampMode) {
+    _motorControler->setTargetPosition(targetPosition);
+    if(_mode == Mode::VELOCITY) {
+      // the ramp generator takes over from the current velocity and moves to the target position
+      auto rampModeData = _motorControlerExpert->getReferenceConfigAndRampModeData();
+      rampModeData.setRampMode(originalRampMode);
+      _motorControlerExpert->setReferenceConfigAndRampModeData(rampModeData);
+    }
+  }
+
+  void TrajectoryStreamer::recordUpdate(std::chrono::microseconds lateness, int trackingError) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto& statistics = _statistics;
+    ++statistics.nUpdates;
+    statistics.maximumLateness = std::max(statistics.maximumLateness, lateness);
+    _sumOfLateness += lateness.count();
+    statistics.averageLateness =
+        std::chrono::microseconds(_sumOfLateness / static_cast<std::chrono::microseconds::rep>(statistics.nUpdates));
+    statistics.lastTrackingError = trackingError;
+    statistics.maximumTrackingError = std::max(statistics.maximumTrackingError, std::abs(trackingError));
+    _sumOfSquaredErrors += static_cast<double>(trackingError) * trackingError;
+    statistics.rmsTrackingError = std::sqrt(_sumOfSquaredErrors / static_cast<double>(statistics.nUpdates));
+  }
+
+  void TrajectoryStreamer::checkTrajectory(std::vector<TrajectoryPoint> const& trajectory) {
+    if(trajectory.empty()) {
+      throw ChimeraTK::logic_error("TrajectoryStreamer: The trajectory is empty.");
+    }
+    if(trajectory.front().time < std::chrono::microseconds(0)) {
+      throw ChimeraTK::logic_error("TrajectoryStreamer: The trajectory must not start before time 0.");
+    }
+    for(size_t i = 1; i < trajectory.size(); ++i) {
+      if(trajectory[i].time <= trajectory[i - 1].time) {
+        throw ChimeraTK::logic_error("TrajectoryStreamer: The times of the trajectory must be strictly increasing.");
+      }
+    }
+  }
+
+} // namespace mtca4u
@@ -0,0 +1,166 @@
+#ifndef MTCA4U_BENCHMARK_RUNNER_H
+#define MTCA4U_BENCHMARK_RUNNER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mtca4u { namespace benchmark {
+
+  /** Latency statistics of one benchmark. All times are in nanoseconds per call.
+   */
+  struct BenchmarkResult {
+    std::string name;
+    size_t threads{1};
+    size_t iterations{0}; ///< total number of calls, summed over all threads
+    double meanNs{0.};
+    double minNs{0.};
+    double medianNs{0.};
+    double p99Ns{0.};
+    double maxNs{0.};
+    double callsPerSecond{0.}; ///< throughput of all threads together
+  };
+
+  /** Calculates the statistics from the latencies of the individual calls.
+   */
+  inline BenchmarkResult makeResult(std::string name, size_t nThreads, std::vector<int64_t> latenciesNs,
+      std::chrono::steady_clock::duration wallTime) {
+    BenchmarkResult result;
+    result.name = std::move(name);
+    result.threads = nThreads;
+    result.iterations = latenciesNs.size();
+    if(latenciesNs.empty()) {
+      return result;
+    }
+
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    double sum = 0.;
+    for(auto latency : latenciesNs) {
+      sum += static_cast<double>(latency);
+    }
+    result.meanNs = sum / static_cast<double>(latenciesNs.size());
+    result.minNs = static_cast<double>(latenciesNs.front());
+    result.medianNs = static_cast<double>(latenciesNs[latenciesNs.size() / 2]);
+    result.p99Ns = static_cast<double>(latenciesNs[(latenciesNs.size() * 99) / 100]);
+    result.maxNs = static_cast<double>(latenciesNs.back());
+    auto wallTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(wallTime).count();
+    if(wallTimeNs > 0) {
+      result.callsPerSecond = static_cast<double>(latenciesNs.size()) * 1e9 / static_cast<double>(wallTimeNs);
+    }
+    return result;
+  }
+
+  /** Times each of nIterations calls of the function individually.
+   */
+  template<class Function>
+  BenchmarkResult measureLatency(std::string name, size_t nIterations, Function&& function) {
+    std::vector<int64_t> latenciesNs;
+    latenciesNs.reserve(nIterations);
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < nIterations; ++i) {
+      auto callStart = std::chrono::steady_clock::now();
+      function();
+      latenciesNs.push_back(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - callStart).count());
+    }
+    return makeResult(std::move(name), 1, std::move(latenciesNs), std::chrono::steady_clock::now() - start);
+  }
+
+  /** Calls the function nIterations times from each of nThreads threads at the same
+   *  time. The function gets the index of the calling thread.
+   */
+  template<class Function>
+  BenchmarkResult measureContention(std::string name, size_t nThreads, size_t nIterations, Function&& function) {
+    std::vector<std::vector<int64_t>> threadLatenciesNs(nThreads);
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for(size_t t = 0; t < nThreads; ++t) {
+      threads.emplace_back([&, t] {
+        auto& latenciesNs = threadLatenciesNs[t];
+        latenciesNs.reserve(nIterations);
+        for(size_t i = 0; i < nIterations; ++i) {
+          auto callStart = std::chrono::steady_clock::now();
+          function(t);
+          latenciesNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - callStart)
+                                    .count());
+        }
+      });
+    }
+    for(auto& thread : threads) {
+      thread.join();
+    }
+    auto wallTime = std::chrono::steady_clock::now() - start;
+
+    std::vector<int64_t> latenciesNs;
+    for(auto& threadLatencies : threadLatenciesNs) {
+      latenciesNs.insert(latenciesNs.end(), threadLatencies.begin(), threadLatencies.end());
+    }
+    return makeResult(std::move(name), nThreads, std::move(latenciesNs), wallTime);
+  }
+
+  /** Collects the results of a benchmark program and writes them as JSON, so they
+   *  can be compared between versions.
+   *
+   *  The context holds the parameters of the run, e.g. the simulated SPI delays.
+   */
+  class BenchmarkReport {
+   public:
+    void addContext(std::string const& key, std::string const& value) { _context.emplace_back(key, quote(value)); }
+    void addContext(std::string const& key, double value) { _context.emplace_back(key, number(value)); }
+
+    void add(BenchmarkResult result) { _results.push_back(std::move(result)); }
+
+    void writeJson(std::ostream& stream) const {
+      stream << "{\n  \"context\": {";
+      for(size_t i = 0; i < _context.size(); ++i) {
+        stream << (i ? "," : "") << "\n    " << quote(_context[i].first) << ": " << _context[i].second;
+      }
+      stream << "\n  },\n  \"benchmarks\": [";
+      for(size_t i = 0; i < _results.size(); ++i) {
+        auto const& result = _results[i];
+        stream << (i ? "," : "") << "\n    {\"name\": " << quote(result.name) << ", \"threads\": " << result.threads
+               << ", \"iterations\": " << result.iterations << ", \"mean_ns\": " << number(result.meanNs)
+               << ", \"min_ns\": " << number(result.minNs) << ", \"median_ns\": " << number(result.medianNs)
+               << ", \"p99_ns\": " << number(result.p99Ns) << ", \"max_ns\": " << number(result.maxNs)
+               << ", \"calls_per_second\": " << number(result.callsPerSecond) << "}";
+      }
+      stream << "\n  ]\n}\n";
+    }
+
+   private:
+    static std::string quote(std::string const& text) {
+      std::string quoted = "\"";
+      for(char c : text) {
+        if(c == '"' || c == '\\') {
+          quoted += '\\';
+        }
+        quoted += c;
+      }
+      return quoted + "\"";
+    }
+
+    static std::string number(double value) {
+      std::string text = std::to_string(value);
+      // std::to_string always prints 6 decimals, remove the trailing zeros
+      text.erase(text.find_last_not_of('0') + 1);
+      if(text.back() == '.') {
+        text.pop_back();
+      }
+      return text;
+    }
+
+    std::vector<std::pair<std::string, std::string>> _context;
+    std::vector<BenchmarkResult> _results;
+  };
+
+}} // namespace mtca4u::benchmark
+
+#endif // MTCA4U_BENCHMARK_RUNNER_H
@@ -0,0 +1,188 @@
+#include "BasicStepperMotor.h"
+#include "BenchmarkRunner.h"
+#include "DFMC_MD22Constants.h"
+#include "DFMC_MD22Dummy.h"
+#include "impl/TMC429SPI.h"
+#include "MotorControler.h"
+#include "MotorDriverCard.h"
+#include "MotorDriverCardFactory.h"
+#include "TMC260DummyConstants.h"
+#include "TMC429Constants.h"
+#include "TMC429DummyConstants.h"
+
+#include <ChimeraTK/BackendFactory.h>
+#include <ChimeraTK/Device.h>
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace mtca4u;
+using namespace mtca4u::benchmark;
+
+/** Micro-benchmarks of the SPI and register stack against the DFMC_MD22Dummy.
+ *
+ *  Measures the latency of single TMC429SPI transfers, of the MotorControler
+ *  getters, of creating a MotorDriverCard, of BasicStepperMotor::isSystemIdle()
+ *  and of concurrent SPI writes and getter calls from several threads. The results are written
+ *  as JSON, to stdout or to the file given with --output.
+ *
+ *  The simulated SPI delays of the dummy can be set, 0 measures the software
+ *  overhead only. The benchmark has to be started from the build directory,
+ *  where the dmap, map and xml files are located.
+ *
+ *  Usage: benchmarkSpiStack [--iterations N] [--threads N] [--controller-spi-delay us]
+ *                           [--driver-spi-delay us] [--output file.json]
+ */
+
+static const std::string deviceAlias("DFMC_MD22");
+// the same firmware with the registers for batch transfers
+static const std::string batchDeviceAlias("DFMC_MD22_BATCH_SPI");
+static const std::string moduleName("MD22_0");
+static const std::string configFileName("MotorDriverCardConfig_minimal_test.xml");
+
+int main(int argc, char* argv[]) {
+  size_t nIterations = 1000;
+  size_t nThreads = 4;
+  unsigned int controllerSpiDelay = tmc429::DEFAULT_DUMMY_SPI_DELAY;
+  unsigned int driverSpiDelay = tmc260::DEFAULT_DUMMY_SPI_DELAY;
+  std::string outputFileName;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string argument(argv[i]);
+    if(i + 1 >= argc) {
+      std::cerr << "Missing value for argument " << argument << std::endl;
+      return 1;
+    }
+    std::string value(argv[++i]);
+    if(argument == "--iterations") {
+      nIterations = std::stoul(value);
+    }
+    else if(argument == "--threads") {
+      nThreads = std::stoul(value);
+    }
+    else if(argument == "--controller-spi-delay") {
+      controllerSpiDelay = std::stoul(value);
+    }
+    else if(argument == "--driver-spi-delay") {
+      driverSpiDelay = std::stoul(value);
+    }
+    else if(argument == "--output") {
+      outputFileName = value;
+    }
+    else {
+      std::cerr << "Unknown argument " << argument << std::endl;
+      return 1;
+    }
+  }
+  // Creating a card writes the complete configuration, so it is done less often
+  size_t nConstructions = std::max<size_t>(nIterations / 100, 1);
+
+  MotorDriverCardFactory::setDeviceaccessDMapFilePath("./dummies.dmap");
+  for(auto& alias : {deviceAlias, batchDeviceAlias}) {
+    auto dummyBackend =
+        boost::dynamic_pointer_cast<DFMC_MD22Dummy>(ChimeraTK::BackendFactory::getInstance().createBackend(alias));
+    if(!dummyBackend) {
+      std::cerr << alias << " is not a DFMC_MD22Dummy" << std::endl;
+      return 1;
+    }
+    dummyBackend->setControllerSpiDelay(controllerSpiDelay);
+    dummyBackend->setDriverSpiDelay(driverSpiDelay);
+  }
+
+  BenchmarkReport report;
+  report.addContext("device", deviceAlias);
+  report.addContext("controller_spi_delay_us", controllerSpiDelay);
+  report.addContext("driver_spi_delay_us", driverSpiDelay);
+  report.addContext("iterations", nIterations);
+  report.addContext("threads", nThreads);
+
+  // accumulate the results so the calls cannot be optimised away
+  std::atomic<int64_t> checksum{0};
+
+  // TMC429SPI transfers
+  {
+    auto device = boost::make_shared<ChimeraTK::Device>();
+    device->open(deviceAlias);
+    TMC429SPI tmc429Spi(device, moduleName, dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING,
+        dfmc_md22::CONTROLER_SPI_SYNC_ADDRESS_STRING, dfmc_md22::CONTROLER_SPI_READBACK_ADDRESS_STRING);
+
+    report.add(measureLatency("TMC429SPI::read", nIterations,
+        [&] { checksum += tmc429Spi.read(tmc429::SMDA_COMMON, tmc429::JDX_COVER_DATAGRAM).getDATA(); }));
+    report.add(measureLatency(
+        "TMC429SPI::write", nIterations, [&] { tmc429Spi.write(tmc429::SMDA_COMMON, tmc429::JDX_COVER_DATAGRAM, 0); }));
+  }
+
+  // Concurrent writes, each caller doing its own handshake vs. the SPI owner thread combining them into batches
+  {
+    auto device = boost::make_shared<ChimeraTK::Device>();
+    device->open(batchDeviceAlias);
+    TMC429SPI tmc429Spi(device, moduleName, dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING,
+        dfmc_md22::CONTROLER_SPI_SYNC_ADDRESS_STRING, dfmc_md22::CONTROLER_SPI_READBACK_ADDRESS_STRING,
+        dfmc_md22::CONTROLER_SPI_BATCH_ADDRESS_STRING, dfmc_md22::CONTROLER_SPI_BATCH_SIZE_ADDRESS_STRING);
+    auto write = [&](size_t thread) {
+      tmc429Spi.write(static_cast<unsigned int>(thread % 3), tmc429::IDX_TARGET_POSITION, 0);
+    };
+
+    report.add(measureContention("TMC429SPI::write/contended", nThreads, nIterations, write));
+    tmc429Spi.enableTransferThread();
+    report.add(measureContention("TMC429SPI::write/contended/transferThread", nThreads, nIterations, write));
+  }
+
+  // MotorControler getters and contention
+  {
+    auto motorDriverCard = MotorDriverCardFactory::instance().createMotorDriverCard(
+        deviceAlias, moduleName, configFileName);
+    auto motorControler = motorDriverCard->getMotorControler(0);
+
+    report.add(measureLatency("MotorControlerImpl::getActualPosition", nIterations,
+        [&] { checksum += motorControler->getActualPosition(); }));
+    report.add(measureLatency("MotorControlerImpl::getActualVelocity", nIterations,
+        [&] { checksum += motorControler->getActualVelocity(); }));
+    report.add(measureLatency(
+        "MotorControlerImpl::getStatus", nIterations, [&] { checksum += motorControler->getStatus().getDataWord(); }));
+    report.add(measureLatency(
+        "MotorControlerImpl::isMotorMoving", nIterations, [&] { checksum += motorControler->isMotorMoving(); }));
+    report.add(measureLatency("MotorControlerImpl::getReferenceSwitchData", nIterations,
+        [&] { checksum += motorControler->getReferenceSwitchData().getDataWord(); }));
+
+    // All threads use the same motor, resp. the threads are distributed over both motors of the card
+    report.add(measureContention("MotorControlerImpl::getActualPosition/sameMotor", nThreads, nIterations,
+        [&](size_t) { checksum += motorControler->getActualPosition(); }));
+    report.add(measureContention("MotorControlerImpl::getActualPosition/bothMotors", nThreads, nIterations,
+        [&](size_t thread) { checksum += motorDriverCard->getMotorControler(thread % 2)->getActualPosition(); }));
+  }
+
+  // The factory only holds weak references, so a new card is created as long as nobody else holds it
+  report.add(measureLatency("MotorDriverCardImpl construction", nConstructions, [&] {
+    auto motorDriverCard =
+        MotorDriverCardFactory::instance().createMotorDriverCard(deviceAlias, moduleName, configFileName);
+    checksum += motorDriverCard->getMotorControler(0)->getID();
+  }));
+
+  // BasicStepperMotor
+  {
+    ChimeraTK::MotorDriver::StepperMotorParameters parameters;
+    parameters.deviceName = deviceAlias;
+    parameters.moduleName = moduleName;
+    parameters.configFileName = configFileName;
+    ChimeraTK::MotorDriver::BasicStepperMotor stepperMotor(parameters);
+
+    report.add(measureLatency(
+        "BasicStepperMotor::isSystemIdle", nIterations, [&] { checksum += stepperMotor.isSystemIdle(); }));
+    report.add(measureContention("BasicStepperMotor::isSystemIdle/contended", nThreads, nIterations,
+        [&](size_t) { checksum += stepperMotor.isSystemIdle(); }));
+  }
+
+  report.addContext("checksum", static_cast<double>(checksum.load()));
+  if(outputFileName.empty()) {
+    report.writeJson(std::cout);
+  }
+  else {
+    std::ofstream outputFile(outputFileName);
+    report.writeJson(outputFile);
+  }
+
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include "BenchmarkRunner.h"
+#include "StateMachine.h"
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace mtca4u::benchmark;
+using ChimeraTK::MotorDriver::utility::StateMachine;
+
+/** Micro-benchmarks of the utility::StateMachine, which is processed on each poll
+ *  of a stepper motor.
+ *
+ *  The state machine has the states and transitions of a BasicStepperMotor
+ *  between idle and moving, including an internal callback of the moving state.
+ *  Measures getCurrentState(), the state check of the stepper motors with
+ *  getCurrentStateId(), the former check by the name of the state, and
+ *  setAndProcessUserEvent() for a move and a stop, also from several threads.
+ *  The results are written as JSON, to stdout or to the file given with --output.
+ *
+ *  Usage: benchmarkStateMachine [--iterations N] [--threads N] [--output file.json]
+ */
+
+namespace {
+
+  class BenchmarkStateMachine : public StateMachine {
+   public:
+    enum : StateId { IDLE_STATE = StateMachine::N_STATE_IDS, MOVING_STATE };
+
+    static const Event moveEvent;
+    static const Event stopEvent;
+    static const Event unusedEvent;
+
+    BenchmarkStateMachine() {
+      _initState.setTransition(moveEvent, &_idle, [] {});
+      _idle.setTransition(moveEvent, &_moving, [this] { ++nActions; }, [this] { ++nPolls; });
+      _moving.setTransition(stopEvent, &_idle, [this] { ++nActions; });
+      setAndProcessUserEvent(moveEvent);
+    }
+
+    std::atomic<uint64_t> nActions{0};
+    std::atomic<uint64_t> nPolls{0};
+
+   protected:
+    State _idle{"idle", IDLE_STATE};
+    State _moving{"moving", MOVING_STATE};
+  };
+
+  const StateMachine::Event BenchmarkStateMachine::moveEvent("moveEvent");
+  const StateMachine::Event BenchmarkStateMachine::stopEvent("stopEvent");
+  const StateMachine::Event BenchmarkStateMachine::unusedEvent("unusedEvent");
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t nIterations = 100000;
+  size_t nThreads = 4;
+  std::string outputFileName;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string argument(argv[i]);
+    if(i + 1 >= argc) {
+      std::cerr << "Missing value for argument " << argument << std::endl;
+      return 1;
+    }
+    std::string value(argv[++i]);
+    if(argument == "--iterations") {
+      nIterations = std::stoul(value);
+    }
+    else if(argument == "--threads") {
+      nThreads = std::stoul(value);
+    }
+    else if(argument == "--output") {
+      outputFileName = value;
+    }
+    else {
+      std::cerr << "Unknown argument " << argument << std::endl;
+      return 1;
+    }
+  }
+
+  BenchmarkReport report;
+  report.addContext("iterations", static_cast<double>(nIterations));
+  report.addContext("threads", static_cast<double>(nThreads));
+
+  BenchmarkStateMachine stateMachine;
+  // accumulate the results so the calls cannot be optimised away
+  std::atomic<uint64_t> checksum{0};
+
+  report.add(measureLatency("StateMachine::getCurrentState", nIterations,
+      [&] { checksum += reinterpret_cast<uintptr_t>(stateMachine.getCurrentState()); }));
+  report.add(measureLatency("StateMachine::getCurrentStateId", nIterations,
+      [&] { checksum += (stateMachine.getCurrentStateId() == BenchmarkStateMachine::MOVING_STATE); }));
+  // The check by name, as it has been done by the stepper motors before the states had IDs
+  report.add(measureLatency("StateMachine::getCurrentState/compareName", nIterations,
+      [&] { checksum += (stateMachine.getCurrentState()->getName() == "moving"); }));
+
+  // Each iteration is one transition, alternating between idle and moving
+  size_t n = 0;
+  report.add(measureLatency("StateMachine::setAndProcessUserEvent", nIterations, [&] {
+    stateMachine.setAndProcessUserEvent(n++ % 2 ? BenchmarkStateMachine::stopEvent : BenchmarkStateMachine::moveEvent);
+  }));
+  report.add(measureLatency("StateMachine::setAndProcessUserEvent/noTransition", nIterations,
+      [&] { stateMachine.setAndProcessUserEvent(BenchmarkStateMachine::unusedEvent); }));
+
+  report.add(measureContention("StateMachine::getCurrentStateId/contended", nThreads, nIterations,
+      [&](size_t) { checksum += (stateMachine.getCurrentStateId() == BenchmarkStateMachine::MOVING_STATE); }));
+  report.add(measureContention("StateMachine::setAndProcessUserEvent/contended", nThreads, nIterations,
+      [&](size_t thread) {
+        stateMachine.setAndProcessUserEvent(
+            thread % 2 ? BenchmarkStateMachine::stopEvent : BenchmarkStateMachine::moveEvent);
+      }));
+
+  report.addContext("checksum", static_cast<double>(checksum.load() + stateMachine.nActions + stateMachine.nPolls));
+  if(outputFileName.empty()) {
+    report.writeJson(std::cout);
+  }
+  else {
+    std::ofstream outputFile(outputFileName);
+    report.writeJson(outputFile);
+  }
+
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include "MotorControlerExpert.h"
+#include "MotorDriverCard.h"
+#include "MotorDriverCardFactory.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+using namespace mtca4u;
+
+/** Compares reading the complete status of one motor through
+ *  MotorControlerExpert::readAllStatus(), which uses one TransferGroup, with
+ *  reading the same registers through the individual getters.
+ *
+ *  The benchmark runs against the DFMC_MD22Dummy and has to be started from
+ *  the build directory, where the dmap and map files are located.
+ *  Usage: benchmarkStatusRead [nIterations]
+ */
+int main(int argc, char* argv[]) {
+  size_t nIterations = (argc > 1 ? std::stoul(argv[1]) : 10000);
+
+  MotorDriverCardFactory::setDeviceaccessDMapFilePath("./dummies.dmap");
+  auto motorDriverCard = MotorDriverCardFactory::instance().createMotorDriverCard(
+      "DFMC_MD22", "MD22_0", "MotorDriverCardConfig_minimal_test.xml");
+  auto motorControler = boost::dynamic_pointer_cast<MotorControlerExpert>(motorDriverCard->getMotorControler(0));
+
+  // accumulate the results so the reads cannot be optimised away
+  int64_t checksum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < nIterations; ++i) {
+    checksum += motorControler->getActualPosition();
+    checksum += motorControler->getActualVelocity();
+    checksum += motorControler->getActualAcceleration();
+    checksum += motorControler->getMicroStepCount();
+    checksum += motorControler->getStallGuardValue();
+    checksum += motorControler->getCoolStepValue();
+    checksum += motorControler->getStatus().getDataWord();
+    checksum += motorControler->getDecoderReadoutMode();
+    checksum += motorControler->getDecoderPosition();
+    checksum += motorControler->isMotorCurrentEnabled();
+  }
+  auto getterDuration = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < nIterations; ++i) {
+    auto snapshot = motorControler->readAllStatus();
+    checksum += snapshot.actualPosition + snapshot.actualVelocity + snapshot.actualAcceleration +
+        snapshot.microStepCount + snapshot.stallGuardValue + snapshot.coolStepValue + snapshot.driverStatusWord +
+        snapshot.decoderReadoutMode + snapshot.decoderPosition + snapshot.controlerStatusWord +
+        snapshot.motorCurrentEnabled;
+  }
+  auto groupDuration = std::chrono::steady_clock::now() - start;
+
+  auto nanosecondsPerRead = [&](std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / static_cast<int64_t>(nIterations);
+  };
+
+  std::cout << "Reading the motor status " << nIterations << " times (checksum " << checksum << ")" << std::endl;
+  std::cout << "  individual getters : " << nanosecondsPerRead(getterDuration) << " ns per status" << std::endl;
+  std::cout << "  readAllStatus()    : " << nanosecondsPerRead(groupDuration) << " ns per status" << std::endl;
+
+  return 0;
+}
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 #pragma once
 
+#include "MotionPoller.h"
 #include "StateMachine.h"
 #include "StepperMotor.h"
 
@@ -9,8 +10,10 @@
 #include <boost/thread.hpp>
 
 #include <atomic>
+#include <exception>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace mtca4u {
   class MotorDriverCard;
@@ -52,6 +55,27 @@ namespace ChimeraTK::MotorDriver {
      */
     ExitStatus moveRelativeInSteps(int delta) override;
 
+    /**
+     * @brief Start a move to a position in units and return a future for its result.
+     * @see StepperMotor::moveToAsync()
+     */
+    std::future<MoveResult> moveToAsync(float newPosition, MoveCallback callback = {}) override;
+
+    /**
+     * @brief Start a move to a position in steps and return a future for its result.
+     */
+    std::future<MoveResult> moveToAsyncInSteps(int newPositionInSteps, MoveCallback callback = {}) override;
+
+    /**
+     * @brief Start a move by a delta in units and return a future for its result.
+     */
+    std::future<MoveResult> moveRelativeAsync(float delta, MoveCallback callback = {}) override;
+
+    /**
+     * @brief Start a move by a delta in steps and return a future for its result.
+     */
+    std::future<MoveResult> moveRelativeAsyncInSteps(int delta, MoveCallback callback = {}) override;
+
     /**
      * @brief Sets the target position in arbitrary units (according to the
      * scaling).
@@ -274,6 +298,12 @@ namespace ChimeraTK::MotorDriver {
      * @brief actions are executed asynchronous, so using this function one can
      * block the program in case an action is being executed and waiting until
      * this will be terminated and the system is back to idle.
+     *
+     * The calling thread sleeps until the MotionPoller of the card, which
+     * observes all waiting motors of the card in one pass, finds the motor
+     * idle. The latency is bounded by the poll period of the MotionPoller.
+     * An error of the card while the motor is checked, e.g. a
+     * ChimeraTK::runtime_error, is thrown to the calling thread.
      */
     void waitForIdle() override;
 
@@ -397,6 +427,10 @@ namespace ChimeraTK::MotorDriver {
 
     float getToleranceNegativeEndSwitch() override;
 
+    std::vector<int> getPositiveEndSwitchSamplesInSteps() override;
+
+    std::vector<int> getNegativeEndSwitchSamplesInSteps() override;
+
     bool isPositiveReferenceActive() override;
 
     bool isNegativeReferenceActive() override;
@@ -413,6 +447,8 @@ namespace ChimeraTK::MotorDriver {
     friend class ReferenceStateMachine;
     friend class RotaryStepperMotorStateMachine;
     friend class LinearStepperMotorStateMachine;
+    friend class MotorGroup;
+    friend class MotionGroup;
 
    protected:
     /**
@@ -441,6 +477,9 @@ namespace ChimeraTK::MotorDriver {
       explicit StateMachine(BasicStepperMotor& stepperMotor);
       ~StateMachine() override;
 
+      enum : StateId { MOVING_STATE = utility::StateMachine::N_STATE_IDS, IDLE_STATE, DISABLED_STATE, ERROR_STATE,
+        N_STATE_IDS };
+
       static const Event initialEvent;
       static const Event moveEvent;
       static const Event stopEvent;
@@ -453,10 +492,10 @@ namespace ChimeraTK::MotorDriver {
       static const Event resetToDisableEvent;
 
      protected:
-      State _moving{"moving"};
-      State _idle{"idle"};
-      State _disabled{"disabled"};
-      State _error{"error"};
+      State _moving{"moving", MOVING_STATE};
+      State _idle{"idle", IDLE_STATE};
+      State _disabled{"disabled", DISABLED_STATE};
+      State _error{"error", ERROR_STATE};
       BasicStepperMotor& _stepperMotor;
       boost::shared_ptr<mtca4u::MotorControler>& _motorControler;
       void getActionCompleteEvent();
@@ -497,23 +536,78 @@ namespace ChimeraTK::MotorDriver {
     /// Common actions for translateAxis for this and derived classes
     void translateAxisActions(int translationInSteps);
 
+    /// Processes the state machine and checks for idle or disabled state. The caller must hold _mutex.
+    bool idleStateReached();
+
+    /// Poll function for the MotionPoller, wakes up waitForIdle() once the motor is idle or the check has failed
+    bool pollIdleState();
+
+    /// Checks the new position and triggers the move. The caller must hold _mutex.
+    ExitStatus startMoveInSteps(int newPositionInSteps);
+
+    /// An asynchronous move which has been started and is waiting for its end
+    struct AsyncMove {
+      std::promise<MoveResult> promise;
+      MoveCallback callback;
+      std::chrono::steady_clock::time_point startTime;
+      uint64_t moveNumber{0};
+      // set if the end of the move could not be detected, the callback is not called then
+      std::exception_ptr error;
+    };
+
+    /// Common implementation of the async move functions, the target is calculated from the actual position
+    std::future<MoveResult> startAsyncMove(std::function<int(int)> calculateTargetInSteps, MoveCallback callback);
+
+    /// Creates the result for an async move. The caller must hold _mutex.
+    MoveResult createMoveResult(ExitStatus status, std::chrono::steady_clock::time_point startTime);
+
+    /// Poll function for the MotionPoller, completes all async moves which have ended
+    bool pollAsyncMoves();
+
+    /// Calls the callback and fulfils the promise, or hands the error of the move to the promise
+    static void completeAsyncMove(AsyncMove& asyncMove, const MoveResult& result);
+
     boost::shared_ptr<mtca4u::MotorDriverCard> _motorDriverCard;
     boost::shared_ptr<mtca4u::MotorControler> _motorController;
 
+    /// The units converter, which can be replaced while the getters use it
+    std::shared_ptr<utility::MotorStepsConverter> unitsConverter() const {
+      return std::atomic_load(&_stepperMotorUnitsConverter);
+    }
+
+    // Only accessed with std::atomic_load() and std::atomic_store(), see unitsConverter()
     std::shared_ptr<utility::MotorStepsConverter> _stepperMotorUnitsConverter;
     std::shared_ptr<utility::EncoderStepsConverter> _encoderUnitsConverter;
 
-    int _encoderPositionOffset{0};
+    // The settings below are written with _mutex held. They are atomic, so the getters do not need the _mutex and are
+    // not blocked by commands which wait for the hardware.
+    std::atomic<int> _encoderPositionOffset{0};
     std::atomic<int> _targetPositionInSteps{0};
-    int _maxPositionLimitInSteps{std::numeric_limits<int>::max()};
-    int _minPositionLimitInSteps{std::numeric_limits<int>::min()};
-    bool _autostart{false};
-    bool _softwareLimitsEnabled{false};
+    std::atomic<int> _maxPositionLimitInSteps{std::numeric_limits<int>::max()};
+    std::atomic<int> _minPositionLimitInSteps{std::numeric_limits<int>::min()};
+    std::atomic<bool> _autostart{false};
+    std::atomic<bool> _softwareLimitsEnabled{false};
 
-    // Mutex protecting the state machine access
+    // Mutex protecting the state machine access and serialising the commands. The getters which only read the hardware
+    // or the atomic settings do not take it, so a slow read does not delay stop() or emergencyStop().
     mutable boost::mutex _mutex;
     std::shared_ptr<utility::StateMachine> _stateMachine;
 
+    // Shared with all motors on the same card, used by waitForIdle() and the async moves
+    std::shared_ptr<MotionPoller> _motionPoller;
+    boost::condition_variable _idleCondition;
+    // The last error of pollIdleState(), which is thrown to the threads in waitForIdle(). Protected by _mutex.
+    std::exception_ptr _idlePollError;
+    uint64_t _nIdlePollErrors{0};
+
+    // Counts the transitions from idle to moving, protected by _mutex
+    uint64_t _moveCounter{0};
+    // Set if the target position has already been written to the controller before the moveEvent, e.g. by a
+    // MotorGroup. Protected by _mutex.
+    bool _targetPositionWritten{false};
+    // Async moves waiting for their end, protected by _mutex
+    std::vector<std::shared_ptr<AsyncMove>> _asyncMoves;
+
     std::atomic<Error> _errorMode{Error::NO_ERROR};
     std::atomic<CalibrationMode> _calibrationMode{CalibrationMode::NONE};
 
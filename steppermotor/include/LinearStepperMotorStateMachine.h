@@ -17,6 +17,8 @@ namespace ChimeraTK::MotorDriver {
     void calculateToleranceValues() override;
     int getPositionEndSwitch(Sign) override;
     void findEndSwitch(Sign sign) override;
+    /// True if the motor is closer to the negative than to the positive end switch
+    bool isNegativeEndSwitchNearer();
     /// Offset in steps used when searching for the end switch from the current position.
     static constexpr int END_SWITCH_SEARCH_OFFSET = 50000;
     int getOffset() const override { return END_SWITCH_SEARCH_OFFSET; }
@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "MotorGroup.h"
+#include "StepperMotor.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ChimeraTK::MotorDriver {
+
+  /**
+   * @brief Result of a move of a MotionGroup
+   */
+  struct MotionGroupResult {
+    /// One result per motor, in the order of the motors of the group
+    std::vector<MoveResult> moveResults;
+    /// Time between the first and the last card starting its motors
+    std::chrono::steady_clock::duration startSkew{};
+    /// Time between the first and the last motor stopping, with the resolution of the poll period
+    std::chrono::steady_clock::duration finishSkew{};
+  };
+
+  /// Callback which is called with the result once a move of a MotionGroup has ended
+  using MotionGroupCallback = std::function<void(const MotionGroupResult&)>;
+
+  /**
+   * @class MotionGroup
+   * @brief Moves motors on several MotorDriverCards together.
+   *
+   * The motors of each card form a MotorGroup, so they are started with one SPI batch
+   * transfer. The targets of all motors are checked before any card is started. The
+   * cards are then started in parallel, the first one by the calling thread and the
+   * others from a thread of their own, so the SPI transfers of the cards overlap
+   * instead of adding up. The worker threads of the MotionPoller are not used, so a
+   * move is also started while they are busy, e.g. with a calibration. The speed
+   * limits are scaled across all cards, so all motors arrive together.
+   *
+   * The end of the move is reported once, after the last motor of all cards has
+   * stopped, together with the start and finish skew across the motors.
+   *
+   * If a card rejects the move although the check has passed (because one of its
+   * motors has been changed in between), the other cards are stopped.
+   */
+  class MotionGroup {
+   public:
+    /**
+     * @brief Create a group of motors. Throws a ChimeraTK::logic_error if the motors
+     *        cannot be moved together, see MotorGroup.
+     */
+    explicit MotionGroup(const std::vector<std::shared_ptr<StepperMotor>>& motors);
+    ~MotionGroup();
+
+    MotionGroup(MotionGroup const&) = delete;
+    MotionGroup& operator=(MotionGroup const&) = delete;
+
+    /**
+     * @brief Move all motors to their target positions, in the order of the motors of the group.
+     *
+     * Returns when all cards have started their motors. If the move cannot be started, the status
+     * of the first motor which cannot be moved is returned, see MotorGroup::moveTo().
+     */
+    ExitStatus moveTo(const std::vector<float>& newPositions);
+
+    /// @brief Like moveTo(), but the positions are given in steps
+    ExitStatus moveToInSteps(const std::vector<int>& newPositionsInSteps);
+
+    /**
+     * @brief Like moveTo(), but returns a future which is ready once all motors have stopped.
+     *
+     * The optional callback is called with the result from the MotionPoller thread of the card
+     * which has stopped last, before the future becomes ready.
+     */
+    std::future<MotionGroupResult> moveToAsync(
+        const std::vector<float>& newPositions, MotionGroupCallback callback = {});
+
+    /// @brief Like moveToAsync(), but the positions are given in steps
+    std::future<MotionGroupResult> moveToAsyncInSteps(
+        const std::vector<int>& newPositionsInSteps, MotionGroupCallback callback = {});
+
+    /// @brief Stop all motors of the group
+    void stop();
+
+    /// @brief True if no move of the group is in progress
+    bool isSystemIdle();
+
+    /// @brief Block until the move of the group has ended
+    void waitForIdle();
+
+    /// @brief Number of motors in the group
+    size_t size() const { return _motors.size(); }
+
+    /// @brief Number of cards the motors of the group are on
+    size_t getNumberOfCards() const { return _cardGroups.size(); }
+
+   private:
+    /// The motors of one card
+    struct CardGroup {
+      std::unique_ptr<MotorGroup> motorGroup;
+      // The indices of the motors in the MotionGroup
+      std::vector<size_t> motorIndices;
+    };
+
+    /// A move of the group which has been started and is waiting for its end
+    struct Motion {
+      std::promise<MotionGroupResult> promise;
+      MotionGroupCallback callback;
+
+      // Protects the members below, which are shared with the dispatch and poll threads of the cards
+      std::mutex mutex;
+      bool dispatched{false};
+      size_t nPendingCards{0};
+      ExitStatus startStatus{ExitStatus::SUCCESS};
+      std::exception_ptr error;
+      std::vector<std::chrono::steady_clock::time_point> startTimes;
+      MotionGroupResult result;
+    };
+
+    std::vector<std::shared_ptr<StepperMotor>> _motors;
+
+    // Protects the member below
+    std::mutex _mutex;
+    std::condition_variable _idleCondition;
+    std::shared_ptr<Motion> _activeMotion;
+
+    // Declared last, so the card groups, which call back into this object, are destroyed first
+    std::vector<CardGroup> _cardGroups;
+
+    /**
+     * Checks the targets and starts all cards. Returns when all cards have been started. If the move is rejected
+     * before any card has been started, the motion is not completed and dispatched stays false.
+     */
+    ExitStatus startMotion(const std::vector<int>& newPositionsInSteps, const std::shared_ptr<Motion>& motion);
+
+    /// Starts the motors of one card, executed in parallel for all cards
+    void dispatch(const std::shared_ptr<Motion>& motion, size_t card, const std::vector<int>& newPositionsInSteps,
+        double duration);
+
+    /// Called when all motors of a card have stopped, completes the motion after the last card
+    void cardFinished(const std::shared_ptr<Motion>& motion, size_t card, const std::vector<MoveResult>& results);
+
+    /// Called if a card cannot be started or observed, the motion ends with the first error of all cards
+    void cardFailed(const std::shared_ptr<Motion>& motion, size_t card, std::exception_ptr error);
+
+    /// The result if the move has not been started
+    MotionGroupResult createRejectedResult(ExitStatus status);
+
+    static void completeMotion(Motion& motion);
+  };
+
+} // namespace ChimeraTK::MotorDriver
@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace mtca4u {
+  class MotorDriverCard;
+} // namespace mtca4u
+
+namespace ChimeraTK::MotorDriver {
+
+  /**
+   * @brief Polls the motion state of all motors of one MotorDriverCard from a single thread.
+   *
+   * Motors which have to be observed (e.g. because a thread waits for them to
+   * become idle) register a poll function. All poll functions of a card are
+   * called in one pass every poll period, so the bus load does not grow with the
+   * number of waiting threads, and a completed motion is detected within one
+   * poll period. The thread sleeps while no poll function is registered.
+   *
+   * Long-running motor actions like calibration are executed on a small pool of
+   * worker threads per card (see post()). While they wait for a motion to end
+   * they sleep in waitUntil(), so the motion state is also only polled by the
+   * poll thread.
+   */
+  class MotionPoller {
+   public:
+    /// A poll function returns true if it does not have to be called again.
+    using PollFunction = std::function<bool()>;
+
+    static constexpr std::chrono::microseconds DEFAULT_POLL_PERIOD{1000};
+    /// One worker per motor on a DFMC-MD22
+    static constexpr size_t DEFAULT_MAX_WORKER_THREADS{2};
+
+    /**
+     * @brief Get the poller shared by all motors of the given card.
+     *
+     * The poller is created on first request and lives as long as somebody holds
+     * the returned pointer.
+     */
+    static std::shared_ptr<MotionPoller> getInstance(mtca4u::MotorDriverCard const* motorDriverCard);
+
+    MotionPoller(MotionPoller const&) = delete;
+    MotionPoller& operator=(MotionPoller const&) = delete;
+    ~MotionPoller();
+
+    /**
+     * @brief Register a poll function for the given owner.
+     *
+     * Each owner has at most one poll function. If the owner already has one,
+     * the call has no effect.
+     */
+    void add(void const* owner, PollFunction pollFunction);
+
+    /**
+     * @brief Remove the poll function of the given owner.
+     *
+     * Blocks until a poll pass in progress has finished, so the owner can safely
+     * be destroyed afterwards. Must not be called from within a poll function.
+     */
+    void remove(void const* owner);
+
+    /**
+     * @brief Block the calling thread until the condition is true.
+     *
+     * The condition is evaluated by the poll thread in each poll pass. Must not be
+     * called from within a poll function.
+     *
+     * Throws ChimeraTK::runtime_error if the poller is destroyed before the condition is true.
+     */
+    void waitUntil(std::function<bool()> condition);
+
+    /**
+     * @brief Execute a long-running action on one of the worker threads of the card.
+     *
+     * Worker threads are started on demand up to the maximum number of workers.
+     * If all of them are busy the action is queued. Exceptions thrown by the action are
+     * discarded, so the action has to report errors itself.
+     */
+    void post(std::function<void()> action);
+
+    void setMaxWorkerThreads(size_t maxWorkerThreads);
+    size_t getMaxWorkerThreads();
+
+    /// Set the period between two poll passes. This bounds the latency until a poll function sees a change.
+    void setPollPeriod(std::chrono::microseconds pollPeriod);
+    std::chrono::microseconds getPollPeriod();
+
+   private:
+    MotionPoller();
+    void pollThreadFunction();
+    void workerThreadFunction();
+
+    // Held during a complete poll pass, locked before _mutex
+    std::mutex _passMutex;
+    // Protects the members below
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    struct Registration {
+      PollFunction pollFunction;
+      // set if add() is called for an owner which is already registered
+      bool renewed{false};
+    };
+    std::map<void const*, Registration> _registrations;
+    struct Waiter {
+      std::mutex mutex;
+      std::condition_variable condition;
+      bool done{false};
+      bool shutdown{false};
+    };
+    // threads blocked in waitUntil(), woken up on shutdown
+    std::set<std::shared_ptr<Waiter>> _waiters;
+    std::chrono::microseconds _pollPeriod{DEFAULT_POLL_PERIOD};
+    bool _shutdown{false};
+
+    std::condition_variable _actionCondition;
+    std::deque<std::function<void()>> _actions;
+    size_t _maxWorkerThreads{DEFAULT_MAX_WORKER_THREADS};
+    size_t _nIdleWorkers{0};
+    std::vector<std::thread> _workerThreads;
+
+    std::thread _pollThread;
+  };
+
+} // namespace ChimeraTK::MotorDriver
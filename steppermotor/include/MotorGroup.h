@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+#pragma once
+
+#include "StepperMotor.h"
+
+#include <boost/thread.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ChimeraTK::MotorDriver {
+
+  class BasicStepperMotor;
+  class MotionPoller;
+
+  /// Callback which is called with the results of all motors once a move of a MotorGroup has ended
+  using GroupMoveCallback = std::function<void(const std::vector<MoveResult>&)>;
+
+  /**
+   * @class MotorGroup
+   * @brief Moves several motors of the same MotorDriverCard together.
+   *
+   * The targets of all motors are checked before anything is written. The speed
+   * limit of each motor is scaled with its distance, so all motors arrive at their
+   * targets at the same time (as far as the acceleration allows, which is not
+   * scaled). The target positions of all motors are then written in one SPI batch
+   * transfer, so the motors start within a few microseconds.
+   *
+   * The end of the move is reported once for the whole group, after the last motor
+   * has stopped. Then the original speed limits are restored. Until then, the group
+   * cannot start another move.
+   *
+   * The motors must be BasicStepperMotors (or derived from it) on the same card, each
+   * motor at most once. They should not be moved individually while the group moves.
+   */
+  class MotorGroup {
+   public:
+    /**
+     * @brief Create a group of motors. Throws a ChimeraTK::logic_error if the motors
+     *        cannot be moved together.
+     */
+    explicit MotorGroup(const std::vector<std::shared_ptr<StepperMotor>>& motors);
+    ~MotorGroup();
+
+    MotorGroup(MotorGroup const&) = delete;
+    MotorGroup& operator=(MotorGroup const&) = delete;
+
+    /**
+     * @brief Move all motors to their target positions, in the order of the motors of the group.
+     *
+     * All motors must be enabled and idle, and all targets must be valid. Otherwise nothing is
+     * moved and the status of the first motor which cannot be moved is returned.
+     * ERR_INVALID_PARAMETER is also returned if the number of targets does not match.
+     */
+    ExitStatus moveTo(const std::vector<float>& newPositions);
+
+    /// @brief Like moveTo(), but the positions are given in steps
+    ExitStatus moveToInSteps(const std::vector<int>& newPositionsInSteps);
+
+    /**
+     * @brief Like moveTo(), but returns a future which is ready once all motors have stopped.
+     *
+     * The result contains one MoveResult per motor. The optional callback is called with the
+     * results from the MotionPoller thread of the card before the future becomes ready. If the
+     * move cannot be started, the status of all results is the status moveTo() would return.
+     * If the group is destroyed before the motors have stopped, the status of all results is
+     * ERR_SYSTEM_IN_ACTION and the callback is not called. If the motors cannot be read while
+     * the move is observed, the speed limits are restored and the future throws the error,
+     * also without calling the callback.
+     */
+    std::future<std::vector<MoveResult>> moveToAsync(
+        const std::vector<float>& newPositions, GroupMoveCallback callback = {});
+
+    /// @brief Like moveToAsync(), but the positions are given in steps
+    std::future<std::vector<MoveResult>> moveToAsyncInSteps(
+        const std::vector<int>& newPositionsInSteps, GroupMoveCallback callback = {});
+
+    /**
+     * @brief Check if moveToInSteps() would start the move, without moving anything.
+     *
+     * The motors might be changed by another thread before the move is started, so the
+     * move can still be rejected.
+     */
+    ExitStatus checkMoveInSteps(const std::vector<int>& newPositionsInSteps);
+
+    /// @brief Stop all motors of the group
+    void stop();
+
+    /// @brief True if no move of the group is in progress
+    bool isSystemIdle();
+
+    /// @brief Block until the move of the group has ended and the speed limits have been restored
+    void waitForIdle();
+
+    /// @brief Number of motors in the group
+    size_t size() const { return _motors.size(); }
+
+    /**
+     * @brief Time when the target positions of the last move have been written, i.e. when the motors started.
+     *
+     * The elapsedTime of the MoveResults is measured from this time until the end of each motor has been
+     * detected, so the latter has the resolution of the poll period of the MotionPoller.
+     */
+    std::chrono::steady_clock::time_point getStartTime();
+
+    friend class MotionGroup;
+
+   private:
+    /// A move of the group which has been started and is waiting for its end
+    struct GroupMove {
+      std::promise<std::vector<MoveResult>> promise;
+      GroupMoveCallback callback;
+      std::chrono::steady_clock::time_point startTime;
+      // The move takes at least this time in seconds, e.g. to arrive together with the motors of other cards
+      double minimumDuration{0};
+      // The move numbers of the motors, to detect the end even if a new move has been started meanwhile
+      std::vector<uint64_t> moveNumbers;
+      // The speed limits before the move, restored after the move
+      std::vector<double> originalSpeedLimits;
+      // The times when the end of the move of each motor has been detected
+      std::vector<std::chrono::steady_clock::time_point> endTimes;
+      // Set if the move could not be observed until its end, reported instead of the results
+      std::exception_ptr error;
+      // Called instead of the callback if the move ends with an error
+      std::function<void(std::exception_ptr)> errorCallback;
+    };
+
+    std::vector<std::shared_ptr<BasicStepperMotor>> _motors;
+    std::shared_ptr<MotionPoller> _motionPoller;
+
+    // Protects the members below. Locked before the mutexes of the motors.
+    std::mutex _mutex;
+    std::condition_variable _idleCondition;
+    std::shared_ptr<GroupMove> _activeMove;
+    std::chrono::steady_clock::time_point _startTime;
+
+    std::vector<int> toSteps(const std::vector<float>& positions);
+
+    /// Locks the mutexes of all motors without risking a deadlock
+    std::vector<boost::unique_lock<boost::mutex>> lockMotors();
+
+    /// Checks if the move can be started. The caller must hold _mutex and the mutexes of all motors.
+    ExitStatus checkMove(const std::vector<int>& newPositionsInSteps);
+
+    /**
+     * Time in seconds the slowest motor needs at its speed limit. Also returns the distances and speed limits
+     * of all motors. The caller must hold the mutexes of all motors.
+     */
+    double moveDuration(
+        const std::vector<int>& newPositionsInSteps, std::vector<int>& distances, std::vector<double>& speedLimits);
+
+    /// Like checkMoveInSteps(), also returns the duration of the move, see moveDuration()
+    ExitStatus checkMoveInSteps(const std::vector<int>& newPositionsInSteps, double& duration);
+
+    /**
+     * Like moveToAsyncInSteps(), but the move takes at least the given duration in seconds. The error callback
+     * is called if the move ends with an error.
+     */
+    std::future<std::vector<MoveResult>> moveToAsyncInSteps(const std::vector<int>& newPositionsInSteps,
+        GroupMoveCallback callback, double minimumDuration, std::function<void(std::exception_ptr)> errorCallback);
+
+    /// Checks the targets, scales the speed limits and starts all motors. The caller must hold _mutex.
+    ExitStatus startMove(const std::vector<int>& newPositionsInSteps, GroupMove& groupMove);
+
+    /// Poll function for the MotionPoller, completes the active move once all motors have stopped
+    bool pollGroupMove();
+
+    /// Restores the speed limits from before the move. Errors are ignored, so all motors are tried.
+    void restoreSpeedLimits(const GroupMove& groupMove);
+
+    static void completeGroupMove(GroupMove& groupMove, const std::vector<MoveResult>& results);
+  };
+
+} // namespace ChimeraTK::MotorDriver
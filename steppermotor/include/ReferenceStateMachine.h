@@ -19,6 +19,9 @@ namespace ChimeraTK::MotorDriver {
     explicit ReferenceStateMachine(ReferenceStepperMotor& stepperMotorWithReference);
     ~ReferenceStateMachine() override = default;
 
+    enum : StateId { CALIBRATING_STATE = BasicStepperMotor::StateMachine::N_STATE_IDS, CALCULATING_TOLERANCE_STATE,
+      N_STATE_IDS };
+
     static const Event calibEvent;
     static const Event calcToleranceEvent;
 
@@ -39,14 +42,43 @@ namespace ChimeraTK::MotorDriver {
     void calibrationThreadFunction();
     void toleranceCalcThreadFunction();
     void moveToEndSwitch(Sign sign);
+    /// Move relative to the actual position and block until the motor has stopped
+    void moveRelativeAndWait(int deltaInSteps);
+    /**
+     * @brief Search the end switch as configured in the CalibrationParameters of the motor.
+     *
+     * Reports CalibrationPhase::FOUND through the progress callback once the end switch is active.
+     * Sets _moveInterrupted if the end switch cannot be found.
+     */
+    void searchEndSwitch(Sign sign);
+    /// Fast approach, back-off and fine approach, see CalibrationParameters::twoPhaseSearch
+    void searchEndSwitchTwoPhase(Sign sign);
+    /// Set the speed limit of the motor controler for the next moves of the search
+    void setSearchSpeed(double speedInUstepsPerSec);
+    void reportCalibrationProgress(CalibrationPhase phase, Sign sign);
+    /// Block until the motor has stopped. The motion state is polled by the MotionPoller of the card.
+    void waitForMotorStandstill();
+    /**
+     * @brief Standard deviation of the end switch position, measured until the statistics are sufficient.
+     *
+     * Throws ChimeraTK::runtime_error if the measurement ended before ToleranceParameters::minSamples.
+     */
     double getToleranceEndSwitch(Sign sign);
+    /**
+     * @brief Take one sample of the end switch position.
+     *
+     * The motor first moves in front of the end switch and then tries to move beyond it.
+     * Returns false (and sets _moveInterrupted on an error) if no sample could be taken.
+     */
+    bool measureEndSwitchPosition(Sign sign, int& positionInSteps);
+    bool isToleranceMeasurementComplete(const utility::RunningStatistics& statistics) const;
+    void clearToleranceSamples(Sign sign);
+    void addToleranceSample(Sign sign, int positionInSteps, utility::RunningStatistics& statistics);
 
     virtual void performCalibration() = 0;
     virtual void calculateToleranceValues() = 0;
     virtual int getPositionEndSwitch(Sign) = 0;
     virtual int getOffset() const = 0;
     virtual void findEndSwitch(Sign sign) = 0;
-    // private:
-    // std::jthread _worker;
   };
 } // namespace ChimeraTK::MotorDriver
@@ -95,6 +95,10 @@ namespace ChimeraTK::MotorDriver {
 
     float getToleranceNegativeEndSwitch() override;
 
+    std::vector<int> getPositiveEndSwitchSamplesInSteps() override;
+
+    std::vector<int> getNegativeEndSwitchSamplesInSteps() override;
+
     /**
      *  Determines if the end switch has been hit.
      */
@@ -141,6 +145,14 @@ namespace ChimeraTK::MotorDriver {
     std::atomic<int> _calibPositiveEndSwitchInSteps{std::numeric_limits<int>::max()};
     std::atomic<float> _tolerancePositiveEndSwitch{0};
     std::atomic<float> _toleranceNegativeEndSwitch{0};
+    /// Parameters of the end switch search, taken from the StepperMotorParameters
+    const CalibrationParameters _calibrationParameters;
+    /// Parameters of the tolerance measurement, taken from the StepperMotorParameters
+    const ToleranceParameters _toleranceParameters;
+    /// Samples of the last tolerance measurement, protected by _mutex
+    std::vector<int> _positiveEndSwitchSamples;
+    std::vector<int> _negativeEndSwitchSamples;
+
    protected:
     virtual bool positiveSwitchActive() const;
     virtual bool negativeSwitchActive() const;
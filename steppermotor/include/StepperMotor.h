@@ -4,16 +4,90 @@
 
 #include "StepperMotorUtil.h"
 
+#include <chrono>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 // Forward-declare fixture used in the test
 class StepperMotorChimeraTKFixture;
 
 namespace ChimeraTK::MotorDriver {
 
+  /**
+   * @brief Phases of the end switch search during a calibration, see CalibrationParameters
+   *
+   * FAST_APPROACH: Moving towards the end switch at the maximum speed of the hardware.\n
+   * BACK_OFF:      Moving away from the end switch until it is released again.\n
+   * FINE_APPROACH: Moving towards the end switch again at the reduced speed.\n
+   * FOUND:         The end switch has been found, the position is the end switch position.\n
+   */
+  enum class CalibrationPhase { FAST_APPROACH, BACK_OFF, FINE_APPROACH, FOUND };
+
+  /**
+   * @brief Progress report of a calibration
+   */
+  struct CalibrationProgress {
+    CalibrationPhase phase{CalibrationPhase::FAST_APPROACH};
+    /// Direction of the searched end switch, +1 for the positive and -1 for the negative end switch
+    int direction{1};
+    /// Position in steps when the phase has started (resp. the end switch position for FOUND)
+    int positionInSteps{0};
+  };
+
+  /// Callback which is called from the calibration thread whenever a phase of the end switch search starts
+  using CalibrationProgressCallback = std::function<void(const CalibrationProgress&)>;
+
+  /**
+   * @brief Parameters of the end switch search in ReferenceStepperMotor::calibrate()
+   *
+   * By default the end switches are searched at the user speed limit. With the two-phase
+   * search, the motor approaches the end switch at the maximum speed capability, backs off
+   * and approaches it again at a fraction of the user speed limit. This trades a short
+   * extra move for a much faster calibration of long axes, while the end switch position
+   * is still taken at low speed.
+   */
+  struct CalibrationParameters {
+    /// Enables the two-phase end switch search
+    bool twoPhaseSearch{false};
+    /// Speed of the back-off and fine approach as fraction of the user speed limit, must be in (0, 1]
+    double fineSpeedFraction{0.1};
+    /// Distance in steps to move away from the end switch before the fine approach, must be positive
+    int backOffInSteps{1000};
+    /// Optional callback reporting the progress of the end switch search
+    CalibrationProgressCallback progressCallback;
+  };
+
+  /**
+   * @brief Parameters of the end switch tolerance measurement in ReferenceStepperMotor::determineTolerance()
+   *
+   * Each sample approaches the end switch and takes the position where the motor is stopped by
+   * the switch. The measurement ends when the confidence interval of the standard deviation is
+   * narrower than confidenceWidthInSteps (after at least minSamples) or after maxSamples. If fewer
+   * than minSamples samples could be taken, the measurement fails and no tolerance is reported.
+   */
+  struct ToleranceParameters {
+    /// Minimum number of samples per end switch, at least 2
+    unsigned int minSamples{3};
+    /// Maximum number of samples per end switch, at least minSamples
+    unsigned int maxSamples{10};
+    /// Width in steps of the confidence interval which ends the measurement early. 0 disables the early end.
+    double confidenceWidthInSteps{0.};
+    /// Quantile of the normal distribution for the confidence interval, 1.96 corresponds to 95%
+    double confidenceFactor{1.96};
+    /// Distance in steps in front of and beyond the end switch used for the approach, must be positive
+    int approachDistanceInSteps{1000};
+    /**
+     * Linear motors only: measure the end switch the motor is closer to first. The samples of each
+     * end switch are taken close to it, so the axis is traversed only once instead of twice.
+     */
+    bool nearestEndSwitchFirst{false};
+  };
+
   /**
    * @brief Contains parameters for initialization of a StepperMotor object
    */
@@ -40,8 +114,31 @@ namespace ChimeraTK::MotorDriver {
     /// steps.
     std::shared_ptr<utility::EncoderStepsConverter> encoderUnitsConverter{
         std::make_shared<utility::EncoderStepsConverterTrivia>()};
+    /// Parameters of the end switch search during calibration. Only used by motors with reference switches.
+    CalibrationParameters calibration;
+    /// Parameters of the end switch tolerance measurement. Only used by motors with reference switches.
+    ToleranceParameters tolerance;
   };
 
+  /**
+   * @brief Result of an asynchronous move, see StepperMotor::moveToAsync()
+   */
+  struct MoveResult {
+    /// Result of starting the move. If it is not SUCCESS, the motor has not been moved.
+    ExitStatus status{ExitStatus::SUCCESS};
+    /// Error state of the motor when the move had ended, see StepperMotor::getError()
+    Error error{Error::NO_ERROR};
+    /// Position when the move had ended in units
+    float finalPosition{0.F};
+    /// Position when the move had ended in steps
+    int finalPositionInSteps{0};
+    /// Time from starting the move until its end has been detected
+    std::chrono::steady_clock::duration elapsedTime{};
+  };
+
+  /// Callback which is called with the result once an asynchronous move has ended
+  using MoveCallback = std::function<void(const MoveResult&)>;
+
   /**
    *  @class StepperMotor
    *  @brief This class provides the user interface for a basic stepper motor.
@@ -424,6 +521,40 @@ namespace ChimeraTK::MotorDriver {
 
     [[nodiscard]] virtual CalibrationMode getCalibrationMode() = 0;
 
+    // The following functions have been added later. They are declared last and are not pure
+    // virtual, so existing implementations of the interface remain valid.
+
+    /**
+     * @brief Start a move to a position in units and return without waiting.
+     *
+     * The returned future becomes ready when the motor has left the moving state
+     * (idle after reaching the target or being stopped, error, disabled). If a
+     * callback is given, it is called with the same result right before. The
+     * callback is executed in the thread observing all motors of the card, so
+     * it must return quickly and must not wait for a motor. If the end of the
+     * move cannot be detected because of an error of the card, the future
+     * throws the error and the callback is not called.
+     * In contrast to setTargetPosition() the move is always started, independent
+     * of the autostart flag.
+     *
+     * The default implementation throws a ChimeraTK::logic_error.
+     */
+    virtual std::future<MoveResult> moveToAsync(float newPosition, MoveCallback callback = {});
+
+    /// @brief Like moveToAsync(), but the position is given in steps
+    virtual std::future<MoveResult> moveToAsyncInSteps(int newPositionInSteps, MoveCallback callback = {});
+
+    /// @brief Like moveToAsync(), but move a delta in units from the current position
+    virtual std::future<MoveResult> moveRelativeAsync(float delta, MoveCallback callback = {});
+
+    /// @brief Like moveToAsync(), but move a delta in steps from the current position
+    virtual std::future<MoveResult> moveRelativeAsyncInSteps(int delta, MoveCallback callback = {});
+
+    /// Positions in steps of the positive end switch taken by the last tolerance measurement, empty by default
+    [[nodiscard]] virtual std::vector<int> getPositiveEndSwitchSamplesInSteps();
+
+    /// Positions in steps of the negative end switch taken by the last tolerance measurement, empty by default
+    [[nodiscard]] virtual std::vector<int> getNegativeEndSwitchSamplesInSteps();
   }; // class StepperMotor
 
   /**
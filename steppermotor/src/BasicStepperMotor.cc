@@ -38,7 +38,8 @@ namespace ChimeraTK::MotorDriver {
     _motorController(_motorDriverCard->getMotorControler(parameters.driverId)),
     _stepperMotorUnitsConverter(parameters.motorUnitsConverter),
     _encoderUnitsConverter(parameters.encoderUnitsConverter),
-    _targetPositionInSteps(_motorController->getTargetPosition()) {
+    _targetPositionInSteps(_motorController->getTargetPosition()),
+    _motionPoller(MotionPoller::getInstance(_motorDriverCard.get())) {
     _stateMachine = std::make_shared<StateMachine>(*this);
     initStateMachine();
   }
@@ -51,7 +52,12 @@ namespace ChimeraTK::MotorDriver {
 
   /********************************************************************************************************************/
 
-  BasicStepperMotor::~BasicStepperMotor() = default;
+  BasicStepperMotor::~BasicStepperMotor() {
+    if(_motionPoller) {
+      _motionPoller->remove(this);
+      _motionPoller->remove(&_asyncMoves);
+    }
+  }
 
   /********************************************************************************************************************/
 
@@ -81,7 +87,7 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   ExitStatus BasicStepperMotor::moveRelative(float delta) {
-    return moveRelativeInSteps(_stepperMotorUnitsConverter->unitsToSteps(delta));
+    return moveRelativeInSteps(unitsConverter()->unitsToSteps(delta));
   }
 
   /********************************************************************************************************************/
@@ -93,13 +99,18 @@ namespace ChimeraTK::MotorDriver {
       return ExitStatus::ERR_SYSTEM_IN_ACTION;
     }
 
-    int newPosition = _motorController->getActualPosition() + delta;
-    auto checkResult = checkNewPosition(newPosition);
+    return startMoveInSteps(_motorController->getActualPosition() + delta);
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus BasicStepperMotor::startMoveInSteps(int newPositionInSteps) {
+    auto checkResult = checkNewPosition(newPositionInSteps);
     if(checkResult != ExitStatus::SUCCESS) {
       return checkResult;
     }
 
-    _targetPositionInSteps = newPosition;
+    _targetPositionInSteps = newPositionInSteps;
 
     _stateMachine->setAndProcessUserEvent(StateMachine::moveEvent);
     return ExitStatus::SUCCESS;
@@ -107,8 +118,137 @@ namespace ChimeraTK::MotorDriver {
 
   /********************************************************************************************************************/
 
+  std::future<MoveResult> BasicStepperMotor::moveToAsync(float newPosition, MoveCallback callback) {
+    return moveToAsyncInSteps(unitsConverter()->unitsToSteps(newPosition), std::move(callback));
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> BasicStepperMotor::moveToAsyncInSteps(int newPositionInSteps, MoveCallback callback) {
+    return startAsyncMove([newPositionInSteps](int) { return newPositionInSteps; }, std::move(callback));
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> BasicStepperMotor::moveRelativeAsync(float delta, MoveCallback callback) {
+    return moveRelativeAsyncInSteps(unitsConverter()->unitsToSteps(delta), std::move(callback));
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> BasicStepperMotor::moveRelativeAsyncInSteps(int delta, MoveCallback callback) {
+    return startAsyncMove([delta](int actualPosition) { return actualPosition + delta; }, std::move(callback));
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> BasicStepperMotor::startAsyncMove(
+      std::function<int(int)> calculateTargetInSteps, MoveCallback callback) {
+    if(!_motionPoller) {
+      throw ChimeraTK::logic_error("BasicStepperMotor: Asynchronous moves need a MotorDriverCard.");
+    }
+
+    auto asyncMove = std::make_shared<AsyncMove>();
+    asyncMove->callback = std::move(callback);
+    asyncMove->startTime = std::chrono::steady_clock::now();
+    auto future = asyncMove->promise.get_future();
+
+    MoveResult result;
+    {
+      LockGuard guard(_mutex);
+      result.status = ExitStatus::ERR_SYSTEM_IN_ACTION;
+      if(!motorActive()) {
+        result.status = startMoveInSteps(calculateTargetInSteps(_motorController->getActualPosition()));
+      }
+
+      if(result.status == ExitStatus::SUCCESS) {
+        asyncMove->moveNumber = _moveCounter;
+        _asyncMoves.push_back(asyncMove);
+        _motionPoller->add(&_asyncMoves, [this] { return pollAsyncMoves(); });
+        return future;
+      }
+      result = createMoveResult(result.status, asyncMove->startTime);
+    }
+
+    // The move has not been started, report this right away
+    completeAsyncMove(*asyncMove, result);
+    return future;
+  }
+
+  /********************************************************************************************************************/
+
+  MoveResult BasicStepperMotor::createMoveResult(ExitStatus status, std::chrono::steady_clock::time_point startTime) {
+    MoveResult result;
+    result.status = status;
+    result.error = _errorMode.load();
+    result.finalPositionInSteps = _motorController->getActualPosition();
+    result.finalPosition = unitsConverter()->stepsToUnits(result.finalPositionInSteps);
+    result.elapsedTime = std::chrono::steady_clock::now() - startTime;
+    return result;
+  }
+
+  /********************************************************************************************************************/
+
+  bool BasicStepperMotor::pollAsyncMoves() {
+    std::vector<std::pair<std::shared_ptr<AsyncMove>, MoveResult>> endedMoves;
+    bool allMovesEnded;
+    {
+      LockGuard guard(_mutex);
+      try {
+        // Processing the state machine detects the end of the move
+        bool moving = (_stateMachine->getCurrentStateId() == StateMachine::MOVING_STATE);
+        for(auto it = _asyncMoves.begin(); it != _asyncMoves.end();) {
+          // A different move number means our move has ended and a new one has been started before we could see it
+          if(!moving || (*it)->moveNumber != _moveCounter) {
+            endedMoves.emplace_back(*it, createMoveResult(ExitStatus::SUCCESS, (*it)->startTime));
+            it = _asyncMoves.erase(it);
+          }
+          else {
+            ++it;
+          }
+        }
+      }
+      catch(...) {
+        // The end of the remaining moves cannot be detected. The error is handed to their futures, it must not end
+        // the poll thread.
+        for(auto& asyncMove : _asyncMoves) {
+          asyncMove->error = std::current_exception();
+          endedMoves.emplace_back(asyncMove, MoveResult());
+        }
+        _asyncMoves.clear();
+      }
+      allMovesEnded = _asyncMoves.empty();
+    }
+
+    // Complete outside of the lock so the callbacks can use the motor
+    for(auto& [asyncMove, result] : endedMoves) {
+      completeAsyncMove(*asyncMove, result);
+    }
+    return allMovesEnded;
+  }
+
+  /********************************************************************************************************************/
+
+  void BasicStepperMotor::completeAsyncMove(AsyncMove& asyncMove, const MoveResult& result) {
+    try {
+      if(asyncMove.error) {
+        std::rethrow_exception(asyncMove.error);
+      }
+      if(asyncMove.callback) {
+        asyncMove.callback(result);
+      }
+      asyncMove.promise.set_value(result);
+    }
+    catch(...) {
+      // Hand an exception from the device or the callback to the owner of the future
+      asyncMove.promise.set_exception(std::current_exception());
+    }
+  }
+
+  /********************************************************************************************************************/
+
   ExitStatus BasicStepperMotor::setTargetPosition(float newPosition) {
-    return setTargetPositionInSteps(_stepperMotorUnitsConverter->unitsToSteps(newPosition));
+    return setTargetPositionInSteps(unitsConverter()->unitsToSteps(newPosition));
   }
 
   /********************************************************************************************************************/
@@ -121,7 +261,7 @@ namespace ChimeraTK::MotorDriver {
     }
     _targetPositionInSteps = newPositionInSteps;
 
-    if(_stateMachine->getCurrentState()->getName() == "moving") {
+    if(_stateMachine->getCurrentStateId() == StateMachine::MOVING_STATE) {
       _motorController->setTargetPosition(_targetPositionInSteps);
     }
     else if(_autostart) {
@@ -169,15 +309,13 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   int BasicStepperMotor::recalculateUnitsInSteps(float units) {
-    LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->unitsToSteps(units);
+    return unitsConverter()->unitsToSteps(units);
   }
 
   /********************************************************************************************************************/
 
   float BasicStepperMotor::recalculateStepsInUnits(int steps) {
-    LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(steps);
+    return unitsConverter()->stepsToUnits(steps);
   }
 
   /********************************************************************************************************************/
@@ -194,7 +332,6 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   bool BasicStepperMotor::getSoftwareLimitsEnabled() {
-    LockGuard guard(_mutex);
     return _softwareLimitsEnabled;
   }
 
@@ -216,7 +353,7 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   ExitStatus BasicStepperMotor::setMaxPositionLimit(float maxPosInUnits) {
-    return setMaxPositionLimitInSteps(_stepperMotorUnitsConverter->unitsToSteps(maxPosInUnits));
+    return setMaxPositionLimitInSteps(unitsConverter()->unitsToSteps(maxPosInUnits));
   }
 
   /********************************************************************************************************************/
@@ -238,35 +375,31 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   ExitStatus BasicStepperMotor::setMinPositionLimit(float minPosInUnits) {
-    return setMinPositionLimitInSteps(_stepperMotorUnitsConverter->unitsToSteps(minPosInUnits));
+    return setMinPositionLimitInSteps(unitsConverter()->unitsToSteps(minPosInUnits));
   }
 
   /********************************************************************************************************************/
 
   int BasicStepperMotor::getMaxPositionLimitInSteps() {
-    LockGuard guard(_mutex);
     return _maxPositionLimitInSteps;
   }
 
   /********************************************************************************************************************/
 
   float BasicStepperMotor::getMaxPositionLimit() {
-    LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(_maxPositionLimitInSteps);
+    return unitsConverter()->stepsToUnits(_maxPositionLimitInSteps);
   }
 
   /********************************************************************************************************************/
 
   int BasicStepperMotor::getMinPositionLimitInSteps() {
-    LockGuard guard(_mutex);
     return _minPositionLimitInSteps;
   }
 
   /********************************************************************************************************************/
 
   float BasicStepperMotor::getMinPositionLimit() {
-    LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(_minPositionLimitInSteps);
+    return unitsConverter()->stepsToUnits(_minPositionLimitInSteps);
   }
 
   /********************************************************************************************************************/
@@ -304,7 +437,7 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   ExitStatus BasicStepperMotor::setActualPosition(float actualPosition) {
-    return setActualPositionInSteps(_stepperMotorUnitsConverter->unitsToSteps(actualPosition));
+    return setActualPositionInSteps(unitsConverter()->unitsToSteps(actualPosition));
   }
 
   /********************************************************************************************************************/
@@ -347,27 +480,24 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   ExitStatus BasicStepperMotor::translateAxis(float translationInUnits) {
-    return translateAxisInSteps(_stepperMotorUnitsConverter->unitsToSteps(translationInUnits));
+    return translateAxisInSteps(unitsConverter()->unitsToSteps(translationInUnits));
   }
 
   /********************************************************************************************************************/
 
   int BasicStepperMotor::getCurrentPositionInSteps() {
-    LockGuard guard(_mutex);
     return (_motorController->getActualPosition());
   }
 
   /********************************************************************************************************************/
 
   float BasicStepperMotor::getCurrentPosition() {
-    LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(_motorController->getActualPosition());
+    return unitsConverter()->stepsToUnits(_motorController->getActualPosition());
   }
 
   /********************************************************************************************************************/
 
   double BasicStepperMotor::getEncoderPosition() {
-    LockGuard guard(_mutex);
     return _encoderUnitsConverter->stepsToUnits(
         static_cast<int>(_motorController->getDecoderPosition()) + _encoderPositionOffset);
   }
@@ -388,15 +518,13 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   int BasicStepperMotor::getTargetPositionInSteps() {
-    LockGuard guard(_mutex);
     return _motorController->getTargetPosition();
   }
 
   /********************************************************************************************************************/
 
   float BasicStepperMotor::getTargetPosition() {
-    LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(_motorController->getTargetPosition());
+    return unitsConverter()->stepsToUnits(_motorController->getTargetPosition());
   }
 
   /********************************************************************************************************************/
@@ -411,7 +539,7 @@ namespace ChimeraTK::MotorDriver {
     if(stepperMotorUnitsConverter == nullptr) {
       return ExitStatus::ERR_INVALID_PARAMETER;
     }
-    _stepperMotorUnitsConverter = stepperMotorUnitsConverter;
+    std::atomic_store(&_stepperMotorUnitsConverter, stepperMotorUnitsConverter);
     return ExitStatus::SUCCESS;
   }
 
@@ -422,7 +550,8 @@ namespace ChimeraTK::MotorDriver {
     if(motorActive()) {
       return ExitStatus::ERR_SYSTEM_IN_ACTION;
     }
-    _stepperMotorUnitsConverter = std::make_unique<utility::MotorStepsConverterTrivia>();
+    std::atomic_store(&_stepperMotorUnitsConverter,
+        std::shared_ptr<utility::MotorStepsConverter>(std::make_shared<utility::MotorStepsConverterTrivia>()));
     return ExitStatus::SUCCESS;
   }
 
@@ -437,27 +566,61 @@ namespace ChimeraTK::MotorDriver {
 
   bool BasicStepperMotor::isSystemIdle() {
     LockGuard guard(_mutex);
+    return idleStateReached();
+  }
+
+  /********************************************************************************************************************/
+
+  bool BasicStepperMotor::idleStateReached() {
     // return !motorActive();
     // FIXME Return to this
-    std::string state = _stateMachine->getCurrentState()->getName();
-    return state == "idle" || state == "disabled";
+    auto state = _stateMachine->getCurrentStateId();
+    return state == StateMachine::IDLE_STATE || state == StateMachine::DISABLED_STATE;
   }
 
   /********************************************************************************************************************/
 
   void BasicStepperMotor::waitForIdle() {
-    while(true) {
-      usleep(100);
-      if(isSystemIdle()) {
-        break;
+    if(!_motionPoller) {
+      while(!isSystemIdle()) {
+        usleep(100);
+      }
+      return;
+    }
+
+    boost::unique_lock<boost::mutex> lock(_mutex);
+    while(!idleStateReached()) {
+      // Registering again is harmless if we are still registered (e.g. after a spurious wakeup)
+      _motionPoller->add(this, [this] { return pollIdleState(); });
+      auto nPollErrors = _nIdlePollErrors;
+      _idleCondition.wait(lock);
+      if(_nIdlePollErrors != nPollErrors) {
+        std::rethrow_exception(_idlePollError);
       }
     }
   }
 
   /********************************************************************************************************************/
 
-  Error BasicStepperMotor::getError() {
+  bool BasicStepperMotor::pollIdleState() {
     LockGuard guard(_mutex);
+    try {
+      if(!idleStateReached()) {
+        return false;
+      }
+    }
+    catch(...) {
+      // Hand the error to the threads in waitForIdle(), it must not end the poll thread
+      _idlePollError = std::current_exception();
+      ++_nIdlePollErrors;
+    }
+    _idleCondition.notify_all();
+    return true;
+  }
+
+  /********************************************************************************************************************/
+
+  Error BasicStepperMotor::getError() {
     return _errorMode.load();
   }
 
@@ -470,7 +633,6 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   uint32_t BasicStepperMotor::getCalibrationTime() {
-    LockGuard guard(_mutex);
     return _motorController->getCalibrationTime();
   }
 
@@ -489,7 +651,6 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   bool BasicStepperMotor::getEnabled() {
-    LockGuard guard(_mutex);
     // Note:  For the old firmware version isEndSwitchPowerEnabled always returns
     //       false (End switch power is not applicable in this scenario).
     return (_motorController->isEndSwitchPowerEnabled() || _motorController->isMotorCurrentEnabled());
@@ -505,22 +666,18 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   bool BasicStepperMotor::getAutostart() {
-    LockGuard guard(_mutex);
     return _autostart;
   }
 
   /********************************************************************************************************************/
 
   double BasicStepperMotor::getMaxSpeedCapability() {
-    LockGuard guard(_mutex);
     return _motorController->getMaxSpeedCapability();
   }
 
   /********************************************************************************************************************/
 
   double BasicStepperMotor::getSafeCurrentLimit() {
-    LockGuard guard(_mutex);
-
     return _motorController->getMaxCurrentLimit();
   }
 
@@ -538,7 +695,6 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   double BasicStepperMotor::getUserCurrentLimit() {
-    LockGuard guard(_mutex);
     return _motorController->getUserCurrentLimit();
   }
 
@@ -556,14 +712,12 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   double BasicStepperMotor::getUserSpeedLimit() {
-    LockGuard guard(_mutex);
     return _motorController->getUserSpeedLimit();
   }
 
   /********************************************************************************************************************/
 
   bool BasicStepperMotor::isMoving() {
-    LockGuard guard(_mutex);
     return _motorController->isMotorMoving();
   }
 
@@ -584,7 +738,7 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   bool BasicStepperMotor::motorActive() {
-    return _stateMachine->getCurrentState()->getName() == "moving";
+    return _stateMachine->getCurrentStateId() == StateMachine::MOVING_STATE;
   }
 
   /********************************************************************************************************************/
@@ -597,7 +751,7 @@ namespace ChimeraTK::MotorDriver {
 
   void BasicStepperMotor::initStateMachine() {
     LockGuard guard(_mutex);
-    if(_stateMachine->getCurrentState()->getName() == "initState") {
+    if(_stateMachine->getCurrentStateId() == StateMachine::INIT_STATE) {
       _stateMachine->setAndProcessUserEvent(StateMachine::initialEvent);
     }
   }
@@ -658,6 +812,18 @@ namespace ChimeraTK::MotorDriver {
 
   /********************************************************************************************************************/
 
+  std::vector<int> BasicStepperMotor::getPositiveEndSwitchSamplesInSteps() {
+    throw ChimeraTK::logic_error("This routine is not available for the BasicStepperMotor");
+  }
+
+  /********************************************************************************************************************/
+
+  std::vector<int> BasicStepperMotor::getNegativeEndSwitchSamplesInSteps() {
+    throw ChimeraTK::logic_error("This routine is not available for the BasicStepperMotor");
+  }
+
+  /********************************************************************************************************************/
+
   bool BasicStepperMotor::isPositiveReferenceActive() {
     throw ChimeraTK::logic_error("This routine is not available for the BasicStepperMotor");
   }
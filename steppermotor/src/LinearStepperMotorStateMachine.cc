@@ -6,6 +6,8 @@
 #include "LinearStepperMotor.h"
 #include "MotorControler.h"
 
+#include <cstdlib>
+
 namespace ChimeraTK::MotorDriver {
   LinearStepperMotorStateMachine::LinearStepperMotorStateMachine(LinearStepperMotor& motor)
   : ReferenceStateMachine(motor) {}
@@ -27,9 +29,9 @@ namespace ChimeraTK::MotorDriver {
         _motor._calibrationMode.exchange(CalibrationMode::NONE);
       }
       else {
-        findEndSwitch(Sign::POSITIVE);
+        searchEndSwitch(Sign::POSITIVE);
         calibPositiveEndSwitchInSteps = _motor.getCurrentPositionInSteps();
-        findEndSwitch(Sign::NEGATIVE);
+        searchEndSwitch(Sign::NEGATIVE);
         calibNegativeEndSwitchInSteps = _motor.getCurrentPositionInSteps();
 
         if(_moveInterrupted.load() || _stopAction.load()) {
@@ -67,8 +69,22 @@ namespace ChimeraTK::MotorDriver {
   }
   void LinearStepperMotorStateMachine::calculateToleranceValues() {
     // Linear
-    _motor._tolerancePositiveEndSwitch.exchange(getToleranceEndSwitch(Sign::POSITIVE));
-    _motor._toleranceNegativeEndSwitch.exchange(getToleranceEndSwitch(Sign::NEGATIVE));
+    // Each end switch is sampled close to it, so only the move between them crosses the axis
+    bool negativeFirst = _motor._toleranceParameters.nearestEndSwitchFirst && isNegativeEndSwitchNearer();
+    Sign first = negativeFirst ? Sign::NEGATIVE : Sign::POSITIVE;
+    Sign second = negativeFirst ? Sign::POSITIVE : Sign::NEGATIVE;
+    double toleranceFirst = getToleranceEndSwitch(first);
+    double toleranceSecond = getToleranceEndSwitch(second);
+
+    // Only published once both end switches have been measured completely
+    _motor._tolerancePositiveEndSwitch.exchange(negativeFirst ? toleranceSecond : toleranceFirst);
+    _motor._toleranceNegativeEndSwitch.exchange(negativeFirst ? toleranceFirst : toleranceSecond);
+  }
+
+  bool LinearStepperMotorStateMachine::isNegativeEndSwitchNearer() {
+    int position = _motor.getCurrentPositionInSteps();
+    return std::abs(position - getPositionEndSwitch(Sign::NEGATIVE)) <
+        std::abs(getPositionEndSwitch(Sign::POSITIVE) - position);
   }
 
   void LinearStepperMotorStateMachine::findEndSwitch(Sign sign) {
@@ -0,0 +1,331 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "MotionGroup.h"
+
+#include "BasicStepperMotor.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <algorithm>
+#include <system_error>
+#include <thread>
+
+namespace ChimeraTK::MotorDriver {
+
+  MotionGroup::MotionGroup(const std::vector<std::shared_ptr<StepperMotor>>& motors) : _motors(motors) {
+    if(motors.empty()) {
+      throw ChimeraTK::logic_error("MotionGroup: The group must contain at least one motor.");
+    }
+
+    // Sort the motors by card, in the order of their first appearance
+    std::vector<mtca4u::MotorDriverCard const*> cards;
+    std::vector<std::vector<std::shared_ptr<StepperMotor>>> cardMotors;
+    for(size_t i = 0; i < motors.size(); ++i) {
+      auto basicStepperMotor = std::dynamic_pointer_cast<BasicStepperMotor>(motors[i]);
+      if(!basicStepperMotor || !basicStepperMotor->_motorDriverCard) {
+        throw ChimeraTK::logic_error("MotionGroup: All motors must be BasicStepperMotors with a MotorDriverCard.");
+      }
+      auto card = std::find(cards.begin(), cards.end(), basicStepperMotor->_motorDriverCard.get());
+      if(card == cards.end()) {
+        cards.push_back(basicStepperMotor->_motorDriverCard.get());
+        cardMotors.emplace_back();
+        _cardGroups.emplace_back();
+        card = cards.end() - 1;
+      }
+      auto cardIndex = static_cast<size_t>(card - cards.begin());
+      cardMotors[cardIndex].push_back(motors[i]);
+      _cardGroups[cardIndex].motorIndices.push_back(i);
+    }
+
+    // Checks the motors of each card
+    for(size_t i = 0; i < _cardGroups.size(); ++i) {
+      _cardGroups[i].motorGroup = std::make_unique<MotorGroup>(cardMotors[i]);
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  MotionGroup::~MotionGroup() {
+    // A card which is still moving might call back until its MotorGroup has been destroyed
+    for(auto& cardGroup : _cardGroups) {
+      cardGroup.motorGroup.reset();
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotionGroup::moveTo(const std::vector<float>& newPositions) {
+    std::vector<int> newPositionsInSteps;
+    for(size_t i = 0; i < newPositions.size() && i < _motors.size(); ++i) {
+      newPositionsInSteps.push_back(_motors[i]->recalculateUnitsInSteps(newPositions[i]));
+    }
+    // A size mismatch is reported when the move is started
+    newPositionsInSteps.resize(newPositions.size());
+    return moveToInSteps(newPositionsInSteps);
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotionGroup::moveToInSteps(const std::vector<int>& newPositionsInSteps) {
+    auto motion = std::make_shared<Motion>();
+    return startMotion(newPositionsInSteps, motion);
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MotionGroupResult> MotionGroup::moveToAsync(
+      const std::vector<float>& newPositions, MotionGroupCallback callback) {
+    std::vector<int> newPositionsInSteps;
+    for(size_t i = 0; i < newPositions.size() && i < _motors.size(); ++i) {
+      newPositionsInSteps.push_back(_motors[i]->recalculateUnitsInSteps(newPositions[i]));
+    }
+    newPositionsInSteps.resize(newPositions.size());
+    return moveToAsyncInSteps(newPositionsInSteps, std::move(callback));
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MotionGroupResult> MotionGroup::moveToAsyncInSteps(
+      const std::vector<int>& newPositionsInSteps, MotionGroupCallback callback) {
+    auto motion = std::make_shared<Motion>();
+    motion->callback = std::move(callback);
+    auto future = motion->promise.get_future();
+
+    ExitStatus status;
+    try {
+      status = startMotion(newPositionsInSteps, motion);
+    }
+    catch(...) {
+      // Once the cards have been started, an error is handed to the owner of the future
+      if(!motion->dispatched) {
+        throw;
+      }
+      return future;
+    }
+    if(!motion->dispatched) {
+      // The move has not been started, report this right away
+      motion->result = createRejectedResult(status);
+      completeMotion(*motion);
+    }
+    return future;
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotionGroup::startMotion(
+      const std::vector<int>& newPositionsInSteps, const std::shared_ptr<Motion>& motion) {
+    if(newPositionsInSteps.size() != _motors.size()) {
+      return ExitStatus::ERR_INVALID_PARAMETER;
+    }
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_activeMotion) {
+        return ExitStatus::ERR_SYSTEM_IN_ACTION;
+      }
+      // Reserve the group. It is not locked while the cards are started, because they call back into it.
+      _activeMotion = motion;
+    }
+
+    // Check all cards before any card is started. The longest move determines the duration for all cards.
+    std::vector<std::vector<int>> cardPositionsInSteps(_cardGroups.size());
+    double duration = 0;
+    for(size_t card = 0; card < _cardGroups.size(); ++card) {
+      for(auto index : _cardGroups[card].motorIndices) {
+        cardPositionsInSteps[card].push_back(newPositionsInSteps[index]);
+      }
+      double cardDuration = 0;
+      auto checkResult = _cardGroups[card].motorGroup->checkMoveInSteps(cardPositionsInSteps[card], cardDuration);
+      if(checkResult != ExitStatus::SUCCESS) {
+        {
+          std::lock_guard<std::mutex> guard(_mutex);
+          _activeMotion.reset();
+        }
+        _idleCondition.notify_all();
+        return checkResult;
+      }
+      duration = std::max(duration, cardDuration);
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(motion->mutex);
+      motion->dispatched = true;
+      motion->nPendingCards = _cardGroups.size();
+      motion->startTimes.resize(_cardGroups.size());
+      motion->result.moveResults.resize(_motors.size());
+    }
+    // Start all cards in parallel. The first card is started by the calling thread, the others from short-lived
+    // threads of their own. Not from the worker threads of the MotionPoller, which might all be busy with a
+    // calibration.
+    std::vector<std::thread> dispatchThreads;
+    for(size_t card = 1; card < _cardGroups.size(); ++card) {
+      try {
+        dispatchThreads.emplace_back([this, &motion, card, &cardPositionsInSteps, duration] {
+          dispatch(motion, card, cardPositionsInSteps[card], duration);
+        });
+      }
+      catch(std::system_error&) {
+        // no thread available, start the card right away
+        dispatch(motion, card, cardPositionsInSteps[card], duration);
+      }
+    }
+    dispatch(motion, 0, cardPositionsInSteps[0], duration);
+    for(auto& dispatchThread : dispatchThreads) {
+      dispatchThread.join();
+    }
+
+    ExitStatus startStatus;
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> guard(motion->mutex);
+      startStatus = motion->startStatus;
+      error = motion->error;
+    }
+
+    if(startStatus != ExitStatus::SUCCESS || error) {
+      stop();
+    }
+    if(error) {
+      std::rethrow_exception(error);
+    }
+    return startStatus;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionGroup::dispatch(const std::shared_ptr<Motion>& motion, size_t card,
+      const std::vector<int>& newPositionsInSteps, double duration) {
+    try {
+      // A rejected move is reported to the callback right away
+      _cardGroups[card].motorGroup->moveToAsyncInSteps(
+          newPositionsInSteps,
+          [this, motion, card](const std::vector<MoveResult>& results) { cardFinished(motion, card, results); },
+          duration, [this, motion, card](std::exception_ptr error) { cardFailed(motion, card, error); });
+    }
+    catch(...) {
+      cardFailed(motion, card, std::current_exception());
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionGroup::cardFailed(const std::shared_ptr<Motion>& motion, size_t card, std::exception_ptr error) {
+    {
+      std::lock_guard<std::mutex> guard(motion->mutex);
+      if(!motion->error) {
+        motion->error = error;
+      }
+    }
+    cardFinished(motion, card, {});
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionGroup::cardFinished(
+      const std::shared_ptr<Motion>& motion, size_t card, const std::vector<MoveResult>& results) {
+    auto startTime = _cardGroups[card].motorGroup->getStartTime();
+    {
+      std::lock_guard<std::mutex> guard(motion->mutex);
+      auto const& motorIndices = _cardGroups[card].motorIndices;
+      for(size_t i = 0; i < results.size(); ++i) {
+        motion->result.moveResults[motorIndices[i]] = results[i];
+      }
+      if(!results.empty() && results.front().status != ExitStatus::SUCCESS) {
+        if(motion->startStatus == ExitStatus::SUCCESS) {
+          motion->startStatus = results.front().status;
+        }
+      }
+      else if(!results.empty()) {
+        motion->startTimes[card] = startTime;
+      }
+      if(--motion->nPendingCards > 0) {
+        return;
+      }
+
+      // All cards have finished. Only the cards which have been started are considered for the skews.
+      std::vector<std::chrono::steady_clock::time_point> startTimes, endTimes;
+      for(size_t c = 0; c < _cardGroups.size(); ++c) {
+        if(motion->startTimes[c] == std::chrono::steady_clock::time_point()) {
+          continue;
+        }
+        startTimes.push_back(motion->startTimes[c]);
+        for(auto index : _cardGroups[c].motorIndices) {
+          endTimes.push_back(motion->startTimes[c] + motion->result.moveResults[index].elapsedTime);
+        }
+      }
+      if(!startTimes.empty()) {
+        auto [firstStart, lastStart] = std::minmax_element(startTimes.begin(), startTimes.end());
+        motion->result.startSkew = *lastStart - *firstStart;
+        auto [firstEnd, lastEnd] = std::minmax_element(endTimes.begin(), endTimes.end());
+        motion->result.finishSkew = *lastEnd - *firstEnd;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_activeMotion == motion) {
+        _activeMotion.reset();
+      }
+    }
+    _idleCondition.notify_all();
+
+    // Complete outside of the lock so the callback can use the group
+    completeMotion(*motion);
+  }
+
+  /********************************************************************************************************************/
+
+  MotionGroupResult MotionGroup::createRejectedResult(ExitStatus status) {
+    MotionGroupResult result;
+    for(auto const& motor : _motors) {
+      MoveResult moveResult;
+      moveResult.status = status;
+      moveResult.error = motor->getError();
+      moveResult.finalPositionInSteps = motor->getCurrentPositionInSteps();
+      moveResult.finalPosition = motor->getCurrentPosition();
+      result.moveResults.push_back(moveResult);
+    }
+    return result;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionGroup::completeMotion(Motion& motion) {
+    try {
+      if(motion.error) {
+        std::rethrow_exception(motion.error);
+      }
+      if(motion.callback) {
+        motion.callback(motion.result);
+      }
+      motion.promise.set_value(motion.result);
+    }
+    catch(...) {
+      // Hand an exception from the device or the callback to the owner of the future
+      motion.promise.set_exception(std::current_exception());
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionGroup::stop() {
+    for(auto const& cardGroup : _cardGroups) {
+      cardGroup.motorGroup->stop();
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  bool MotionGroup::isSystemIdle() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return !_activeMotion;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionGroup::waitForIdle() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idleCondition.wait(lock, [this] { return !_activeMotion; });
+  }
+
+} // namespace ChimeraTK::MotorDriver
@@ -0,0 +1,244 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "MotionPoller.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <vector>
+
+namespace ChimeraTK::MotorDriver {
+
+  /********************************************************************************************************************/
+
+  std::shared_ptr<MotionPoller> MotionPoller::getInstance(mtca4u::MotorDriverCard const* motorDriverCard) {
+    static std::mutex instancesMutex;
+    static std::map<mtca4u::MotorDriverCard const*, std::weak_ptr<MotionPoller>> instances;
+
+    std::lock_guard<std::mutex> guard(instancesMutex);
+    // drop the entries of destroyed pollers, so cards which have been closed do not pile up
+    for(auto instance = instances.begin(); instance != instances.end();) {
+      if(instance->second.expired()) {
+        instance = instances.erase(instance);
+      }
+      else {
+        ++instance;
+      }
+    }
+    auto poller = instances[motorDriverCard].lock();
+    if(!poller) {
+      // the constructor is private, so std::make_shared cannot be used
+      poller = std::shared_ptr<MotionPoller>(new MotionPoller());
+      instances[motorDriverCard] = poller;
+    }
+    return poller;
+  }
+
+  /********************************************************************************************************************/
+
+  MotionPoller::MotionPoller() : _pollThread(&MotionPoller::pollThreadFunction, this) {}
+
+  /********************************************************************************************************************/
+
+  MotionPoller::~MotionPoller() {
+    std::set<std::shared_ptr<Waiter>> waiters;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _shutdown = true;
+      waiters.swap(_waiters);
+    }
+    _condition.notify_all();
+    _actionCondition.notify_all();
+    // Workers blocked in waitUntil() would never see their condition fulfilled once the poll thread is gone
+    for(auto& waiter : waiters) {
+      std::lock_guard<std::mutex> guard(waiter->mutex);
+      waiter->shutdown = true;
+      waiter->condition.notify_all();
+    }
+    _pollThread.join();
+    for(auto& workerThread : _workerThreads) {
+      workerThread.join();
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::add(void const* owner, PollFunction pollFunction) {
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      auto [registration, isNew] = _registrations.try_emplace(owner, Registration{std::move(pollFunction)});
+      if(!isNew) {
+        // The owner might have finished in the poll pass which is running right now.
+        // Make sure it is not dropped at the end of that pass.
+        registration->second.renewed = true;
+      }
+    }
+    _condition.notify_all();
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::remove(void const* owner) {
+    std::lock_guard<std::mutex> passGuard(_passMutex);
+    std::lock_guard<std::mutex> guard(_mutex);
+    _registrations.erase(owner);
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::waitUntil(std::function<bool()> condition) {
+    // The poll function keeps the waiter alive, so its address cannot be reused as owner
+    // by another waitUntil() before the poll thread has dropped the registration.
+    auto waiter = std::make_shared<Waiter>();
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(_shutdown) {
+        throw ChimeraTK::runtime_error("MotionPoller::waitUntil(): The poller has been shut down.");
+      }
+      _waiters.insert(waiter);
+      _registrations.try_emplace(waiter.get(), Registration{[waiter, condition = std::move(condition)] {
+        if(!condition()) {
+          return false;
+        }
+        std::lock_guard<std::mutex> waiterGuard(waiter->mutex);
+        waiter->done = true;
+        waiter->condition.notify_all();
+        return true;
+      }});
+    }
+    _condition.notify_all();
+
+    bool isShutdown;
+    {
+      std::unique_lock<std::mutex> lock(waiter->mutex);
+      waiter->condition.wait(lock, [&] { return waiter->done || waiter->shutdown; });
+      isShutdown = !waiter->done;
+    }
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _waiters.erase(waiter);
+    }
+    if(isShutdown) {
+      throw ChimeraTK::runtime_error("MotionPoller::waitUntil(): The poller has been shut down.");
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::post(std::function<void()> action) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    _actions.push_back(std::move(action));
+    if(_nIdleWorkers == 0 && _workerThreads.size() < _maxWorkerThreads) {
+      _workerThreads.emplace_back(&MotionPoller::workerThreadFunction, this);
+    }
+    _actionCondition.notify_one();
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::setMaxWorkerThreads(size_t maxWorkerThreads) {
+    if(maxWorkerThreads == 0) {
+      throw ChimeraTK::logic_error("MotionPoller::setMaxWorkerThreads(): At least one worker thread is needed.");
+    }
+    std::lock_guard<std::mutex> guard(_mutex);
+    _maxWorkerThreads = maxWorkerThreads;
+  }
+
+  /********************************************************************************************************************/
+
+  size_t MotionPoller::getMaxWorkerThreads() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _maxWorkerThreads;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::setPollPeriod(std::chrono::microseconds pollPeriod) {
+    if(pollPeriod <= std::chrono::microseconds(0)) {
+      throw ChimeraTK::logic_error("MotionPoller::setPollPeriod(): The poll period must be positive.");
+    }
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      _pollPeriod = pollPeriod;
+    }
+    _condition.notify_all();
+  }
+
+  /********************************************************************************************************************/
+
+  std::chrono::microseconds MotionPoller::getPollPeriod() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _pollPeriod;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::pollThreadFunction() {
+    std::vector<std::pair<void const*, PollFunction>> pass;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(true) {
+      _condition.wait(lock, [this] { return _shutdown || !_registrations.empty(); });
+      if(_shutdown) {
+        return;
+      }
+      auto nextPass = std::chrono::steady_clock::now() + _pollPeriod;
+
+      // The poll functions are called without holding _mutex, so they can register
+      // further functions. _passMutex keeps the owners from removing themselves meanwhile.
+      pass.clear();
+      for(auto& [owner, registration] : _registrations) {
+        pass.emplace_back(owner, registration.pollFunction);
+        registration.renewed = false;
+      }
+      lock.unlock();
+      {
+        std::lock_guard<std::mutex> passGuard(_passMutex);
+        std::vector<void const*> finishedOwners;
+        for(auto& [owner, pollFunction] : pass) {
+          if(pollFunction()) {
+            finishedOwners.push_back(owner);
+          }
+        }
+        std::lock_guard<std::mutex> guard(_mutex);
+        for(auto owner : finishedOwners) {
+          auto registration = _registrations.find(owner);
+          if(registration != _registrations.end() && !registration->second.renewed) {
+            _registrations.erase(registration);
+          }
+        }
+      }
+      lock.lock();
+
+      _condition.wait_until(lock, nextPass, [&] { return _shutdown; });
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotionPoller::workerThreadFunction() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(true) {
+      ++_nIdleWorkers;
+      _actionCondition.wait(lock, [this] { return _shutdown || !_actions.empty(); });
+      --_nIdleWorkers;
+      if(_shutdown) {
+        return;
+      }
+      auto action = std::move(_actions.front());
+      _actions.pop_front();
+
+      lock.unlock();
+      try {
+        action();
+      }
+      catch(...) {
+        // nobody to report to, but the worker has to survive for the next action
+      }
+      lock.lock();
+    }
+  }
+
+  /********************************************************************************************************************/
+
+} // namespace ChimeraTK::MotorDriver
@@ -0,0 +1,382 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "MotorGroup.h"
+
+#include "BasicStepperMotor.h"
+#include "MotionPoller.h"
+#include "MotorControler.h"
+#include "MotorDriverCard.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+namespace ChimeraTK::MotorDriver {
+
+  MotorGroup::MotorGroup(const std::vector<std::shared_ptr<StepperMotor>>& motors) {
+    if(motors.empty()) {
+      throw ChimeraTK::logic_error("MotorGroup: The group must contain at least one motor.");
+    }
+    for(auto const& motor : motors) {
+      auto basicStepperMotor = std::dynamic_pointer_cast<BasicStepperMotor>(motor);
+      if(!basicStepperMotor || !basicStepperMotor->_motorDriverCard) {
+        throw ChimeraTK::logic_error("MotorGroup: All motors must be BasicStepperMotors with a MotorDriverCard.");
+      }
+      if(!_motors.empty() && basicStepperMotor->_motorDriverCard != _motors.front()->_motorDriverCard) {
+        throw ChimeraTK::logic_error("MotorGroup: All motors must be on the same MotorDriverCard.");
+      }
+      for(auto const& otherMotor : _motors) {
+        if(otherMotor == basicStepperMotor ||
+            otherMotor->_motorController->getID() == basicStepperMotor->_motorController->getID()) {
+          throw ChimeraTK::logic_error("MotorGroup: Each motor must be in the group only once.");
+        }
+      }
+      _motors.push_back(basicStepperMotor);
+    }
+    _motionPoller = _motors.front()->_motionPoller;
+  }
+
+  /********************************************************************************************************************/
+
+  MotorGroup::~MotorGroup() {
+    _motionPoller->remove(this);
+
+    // Only the poll function ends a move, so a move in progress has to be ended here
+    std::lock_guard<std::mutex> guard(_mutex);
+    if(!_activeMove) {
+      return;
+    }
+    restoreSpeedLimits(*_activeMove);
+    try {
+      std::vector<MoveResult> results;
+      for(auto const& motor : _motors) {
+        boost::lock_guard<boost::mutex> motorGuard(motor->_mutex);
+        results.push_back(motor->createMoveResult(ExitStatus::ERR_SYSTEM_IN_ACTION, _activeMove->startTime));
+      }
+      // The callback usually belongs to the owner of the group, which is being destroyed
+      _activeMove->callback = {};
+      completeGroupMove(*_activeMove, results);
+    }
+    catch(...) {
+      _activeMove->promise.set_exception(std::current_exception());
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  std::vector<int> MotorGroup::toSteps(const std::vector<float>& positions) {
+    std::vector<int> positionsInSteps;
+    for(size_t i = 0; i < positions.size() && i < _motors.size(); ++i) {
+      positionsInSteps.push_back(_motors[i]->recalculateUnitsInSteps(positions[i]));
+    }
+    // A size mismatch is reported when the move is started
+    positionsInSteps.resize(positions.size());
+    return positionsInSteps;
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotorGroup::moveTo(const std::vector<float>& newPositions) {
+    return moveToInSteps(toSteps(newPositions));
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotorGroup::moveToInSteps(const std::vector<int>& newPositionsInSteps) {
+    auto groupMove = std::make_shared<GroupMove>();
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto status = startMove(newPositionsInSteps, *groupMove);
+    if(status == ExitStatus::SUCCESS) {
+      _activeMove = groupMove;
+      _motionPoller->add(this, [this] { return pollGroupMove(); });
+    }
+    return status;
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<std::vector<MoveResult>> MotorGroup::moveToAsync(
+      const std::vector<float>& newPositions, GroupMoveCallback callback) {
+    return moveToAsyncInSteps(toSteps(newPositions), std::move(callback));
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<std::vector<MoveResult>> MotorGroup::moveToAsyncInSteps(
+      const std::vector<int>& newPositionsInSteps, GroupMoveCallback callback) {
+    return moveToAsyncInSteps(newPositionsInSteps, std::move(callback), 0, {});
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<std::vector<MoveResult>> MotorGroup::moveToAsyncInSteps(const std::vector<int>& newPositionsInSteps,
+      GroupMoveCallback callback, double minimumDuration, std::function<void(std::exception_ptr)> errorCallback) {
+    auto groupMove = std::make_shared<GroupMove>();
+    groupMove->callback = std::move(callback);
+    groupMove->minimumDuration = minimumDuration;
+    groupMove->errorCallback = std::move(errorCallback);
+    auto future = groupMove->promise.get_future();
+
+    ExitStatus status;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      status = startMove(newPositionsInSteps, *groupMove);
+      if(status == ExitStatus::SUCCESS) {
+        _activeMove = groupMove;
+        _motionPoller->add(this, [this] { return pollGroupMove(); });
+        return future;
+      }
+    }
+
+    // The move has not been started, report this right away
+    std::vector<MoveResult> results;
+    for(auto const& motor : _motors) {
+      boost::lock_guard<boost::mutex> motorGuard(motor->_mutex);
+      results.push_back(motor->createMoveResult(status, groupMove->startTime));
+    }
+    completeGroupMove(*groupMove, results);
+    return future;
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotorGroup::checkMoveInSteps(const std::vector<int>& newPositionsInSteps) {
+    double duration;
+    return checkMoveInSteps(newPositionsInSteps, duration);
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotorGroup::checkMoveInSteps(const std::vector<int>& newPositionsInSteps, double& duration) {
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto motorLocks = lockMotors();
+    auto checkResult = checkMove(newPositionsInSteps);
+    if(checkResult == ExitStatus::SUCCESS) {
+      std::vector<int> distances;
+      std::vector<double> speedLimits;
+      duration = moveDuration(newPositionsInSteps, distances, speedLimits);
+    }
+    return checkResult;
+  }
+
+  /********************************************************************************************************************/
+
+  std::vector<boost::unique_lock<boost::mutex>> MotorGroup::lockMotors() {
+    std::vector<boost::unique_lock<boost::mutex>> motorLocks;
+    motorLocks.reserve(_motors.size());
+    for(auto const& motor : _motors) {
+      motorLocks.emplace_back(motor->_mutex, boost::defer_lock);
+    }
+    boost::lock(motorLocks.begin(), motorLocks.end());
+    return motorLocks;
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotorGroup::checkMove(const std::vector<int>& newPositionsInSteps) {
+    if(newPositionsInSteps.size() != _motors.size()) {
+      return ExitStatus::ERR_INVALID_PARAMETER;
+    }
+    if(_activeMove) {
+      return ExitStatus::ERR_SYSTEM_IN_ACTION;
+    }
+    for(size_t i = 0; i < _motors.size(); ++i) {
+      auto& motor = *_motors[i];
+      if(motor.motorActive() ||
+          motor._stateMachine->getCurrentStateId() != BasicStepperMotor::StateMachine::IDLE_STATE) {
+        return ExitStatus::ERR_SYSTEM_IN_ACTION;
+      }
+      auto checkResult = motor.checkNewPosition(newPositionsInSteps[i]);
+      if(checkResult != ExitStatus::SUCCESS) {
+        return checkResult;
+      }
+    }
+    return ExitStatus::SUCCESS;
+  }
+
+  /********************************************************************************************************************/
+
+  double MotorGroup::moveDuration(
+      const std::vector<int>& newPositionsInSteps, std::vector<int>& distances, std::vector<double>& speedLimits) {
+    double duration = 0;
+    for(size_t i = 0; i < _motors.size(); ++i) {
+      auto& motorController = *_motors[i]->_motorController;
+      distances.push_back(std::abs(newPositionsInSteps[i] - motorController.getActualPosition()));
+      speedLimits.push_back(motorController.getUserSpeedLimit());
+      if(speedLimits.back() > 0) {
+        duration = std::max(duration, distances.back() / speedLimits.back());
+      }
+    }
+    return duration;
+  }
+
+  /********************************************************************************************************************/
+
+  ExitStatus MotorGroup::startMove(const std::vector<int>& newPositionsInSteps, GroupMove& groupMove) {
+    groupMove.startTime = std::chrono::steady_clock::now();
+
+    // Hold all motors while the move is checked and started, so none of them can be started in between
+    auto motorLocks = lockMotors();
+    auto checkResult = checkMove(newPositionsInSteps);
+    if(checkResult != ExitStatus::SUCCESS) {
+      return checkResult;
+    }
+
+    // The other motors are slowed down to need the same time as the slowest one
+    std::vector<int> distances;
+    auto duration = moveDuration(newPositionsInSteps, distances, groupMove.originalSpeedLimits);
+    duration = std::max(duration, groupMove.minimumDuration);
+    std::map<unsigned int, int> targetPositions;
+    try {
+      for(size_t i = 0; i < _motors.size(); ++i) {
+        auto& motor = *_motors[i];
+        if(duration > 0 && distances[i] > 0) {
+          motor._motorController->setUserSpeedLimit(distances[i] / duration);
+        }
+        targetPositions[motor._motorController->getID()] = newPositionsInSteps[i];
+      }
+      _motors.front()->_motorDriverCard->setTargetPositions(targetPositions);
+    }
+    catch(...) {
+      for(size_t i = 0; i < _motors.size(); ++i) {
+        _motors[i]->_motorController->setUserSpeedLimit(groupMove.originalSpeedLimits[i]);
+      }
+      throw;
+    }
+    // The motors start with the end of the batch transfer
+    groupMove.startTime = std::chrono::steady_clock::now();
+    _startTime = groupMove.startTime;
+    groupMove.endTimes.resize(_motors.size());
+
+    // The targets have been written, the state machines only have to follow
+    for(size_t i = 0; i < _motors.size(); ++i) {
+      auto& motor = *_motors[i];
+      motor._targetPositionInSteps = newPositionsInSteps[i];
+      motor._targetPositionWritten = true;
+      motor._stateMachine->setAndProcessUserEvent(BasicStepperMotor::StateMachine::moveEvent);
+      groupMove.moveNumbers.push_back(motor._moveCounter);
+    }
+    return ExitStatus::SUCCESS;
+  }
+
+  /********************************************************************************************************************/
+
+  bool MotorGroup::pollGroupMove() {
+    std::shared_ptr<GroupMove> endedMove;
+    std::vector<MoveResult> results;
+    {
+      std::lock_guard<std::mutex> guard(_mutex);
+      if(!_activeMove) {
+        return true;
+      }
+      try {
+        auto now = std::chrono::steady_clock::now();
+        bool allStopped = true;
+        for(size_t i = 0; i < _motors.size(); ++i) {
+          auto& motor = *_motors[i];
+          boost::lock_guard<boost::mutex> motorGuard(motor._mutex);
+          // Processing the state machine detects the end of the move
+          bool moving = (motor._stateMachine->getCurrentStateId() == BasicStepperMotor::StateMachine::MOVING_STATE);
+          if(moving && _activeMove->moveNumbers[i] == motor._moveCounter) {
+            allStopped = false;
+          }
+          else if(_activeMove->endTimes[i] == std::chrono::steady_clock::time_point()) {
+            _activeMove->endTimes[i] = now;
+          }
+        }
+        if(!allStopped) {
+          return false;
+        }
+
+        for(size_t i = 0; i < _motors.size(); ++i) {
+          auto& motor = *_motors[i];
+          boost::lock_guard<boost::mutex> motorGuard(motor._mutex);
+          motor._motorController->setUserSpeedLimit(_activeMove->originalSpeedLimits[i]);
+          results.push_back(motor.createMoveResult(ExitStatus::SUCCESS, _activeMove->startTime));
+          // Each motor reports the time when its own end has been detected
+          results.back().elapsedTime = _activeMove->endTimes[i] - _activeMove->startTime;
+        }
+      }
+      catch(...) {
+        // The end of the move cannot be detected any more, so the move ends with the error
+        _activeMove->error = std::current_exception();
+        restoreSpeedLimits(*_activeMove);
+        results.clear();
+      }
+      std::swap(endedMove, _activeMove);
+    }
+    _idleCondition.notify_all();
+
+    // Complete outside of the lock so the callback can use the group
+    completeGroupMove(*endedMove, results);
+    return true;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotorGroup::restoreSpeedLimits(const GroupMove& groupMove) {
+    for(size_t i = 0; i < _motors.size(); ++i) {
+      try {
+        boost::lock_guard<boost::mutex> motorGuard(_motors[i]->_mutex);
+        _motors[i]->_motorController->setUserSpeedLimit(groupMove.originalSpeedLimits[i]);
+      }
+      catch(...) {
+        // The other motors shall keep their speed limits anyway
+      }
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotorGroup::completeGroupMove(GroupMove& groupMove, const std::vector<MoveResult>& results) {
+    try {
+      if(groupMove.error) {
+        if(groupMove.errorCallback) {
+          groupMove.errorCallback(groupMove.error);
+        }
+        std::rethrow_exception(groupMove.error);
+      }
+      if(groupMove.callback) {
+        groupMove.callback(results);
+      }
+      groupMove.promise.set_value(results);
+    }
+    catch(...) {
+      // Hand an exception from the device or the callback to the owner of the future
+      groupMove.promise.set_exception(std::current_exception());
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  void MotorGroup::stop() {
+    for(auto const& motor : _motors) {
+      motor->stop();
+    }
+  }
+
+  /********************************************************************************************************************/
+
+  bool MotorGroup::isSystemIdle() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return !_activeMove;
+  }
+
+  /********************************************************************************************************************/
+
+  std::chrono::steady_clock::time_point MotorGroup::getStartTime() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _startTime;
+  }
+
+  /********************************************************************************************************************/
+
+  void MotorGroup::waitForIdle() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idleCondition.wait(lock, [this] { return !_activeMove; });
+  }
+
+} // namespace ChimeraTK::MotorDriver
@@ -7,9 +7,7 @@
 
 #include <ChimeraTK/Exception.h>
 
-#include <thread>
-
-constexpr unsigned wakeupPeriodInMilliseconds = 500U;
+#include <string>
 
 namespace ChimeraTK::MotorDriver {
 
@@ -17,9 +15,9 @@ namespace ChimeraTK::MotorDriver {
   const utility::StateMachine::Event ReferenceStateMachine::calcToleranceEvent("calcToleranceEvent");
 
   ReferenceStateMachine::ReferenceStateMachine(ReferenceStepperMotor& stepperMotorWithReference)
-  : BasicStepperMotor::StateMachine(stepperMotorWithReference), _calibrating("calibrating"),
-    _calculatingTolerance("calculatingTolerance"), _motor(stepperMotorWithReference), _stopAction(false),
-    _moveInterrupted(false) {
+  : BasicStepperMotor::StateMachine(stepperMotorWithReference), _calibrating("calibrating", CALIBRATING_STATE),
+    _calculatingTolerance("calculatingTolerance", CALCULATING_TOLERANCE_STATE), _motor(stepperMotorWithReference),
+    _stopAction(false), _moveInterrupted(false) {
     _idle.setTransition(calibEvent, &_calibrating, [this]() { actionStartCalib(); }, [this]() { actionEndCallback(); });
     _idle.setTransition(ReferenceStateMachine::calcToleranceEvent, &_calculatingTolerance,
         std::bind(&ReferenceStateMachine::actionStartCalcTolercance, this),
@@ -49,7 +47,7 @@ namespace ChimeraTK::MotorDriver {
 
   void ReferenceStateMachine::actionStartCalib() {
     _asyncActionActive.store(true);
-    std::thread(&ReferenceStateMachine::calibrationThreadFunction, this).detach();
+    _motor._motionPoller->post([this] { calibrationThreadFunction(); });
   }
 
   void ReferenceStateMachine::calibrationThreadFunction() {
@@ -81,19 +79,94 @@ namespace ChimeraTK::MotorDriver {
 
   void ReferenceStateMachine::actionStartCalcTolercance() {
     _asyncActionActive.exchange(true);
-    std::thread toleranceCalcThread(&ReferenceStateMachine::toleranceCalcThreadFunction, this);
-    toleranceCalcThread.detach();
+    _motor._motionPoller->post([this] { toleranceCalcThreadFunction(); });
   }
 
   void ReferenceStateMachine::moveToEndSwitch(Sign sign) {
+    moveRelativeAndWait(static_cast<int>(sign) * getOffset());
+  }
+
+  void ReferenceStateMachine::moveRelativeAndWait(int deltaInSteps) {
     {
       boost::lock_guard<boost::mutex&> lck(_motor._mutex);
-      _motor._motorController->setTargetPosition(
-          _motor._motorController->getActualPosition() + static_cast<int>(sign) * getOffset());
+      _motor._motorController->setTargetPosition(_motor._motorController->getActualPosition() + deltaInSteps);
+    }
+    waitForMotorStandstill();
+  }
+
+  void ReferenceStateMachine::searchEndSwitch(Sign sign) {
+    if(_motor._calibrationParameters.twoPhaseSearch) {
+      searchEndSwitchTwoPhase(sign);
+    }
+    else {
+      findEndSwitch(sign);
+    }
+
+    if(!(_stopAction.load() || _moveInterrupted.load())) {
+      reportCalibrationProgress(CalibrationPhase::FOUND, sign);
+    }
+  }
+
+  void ReferenceStateMachine::searchEndSwitchTwoPhase(Sign sign) {
+    const auto& parameters = _motor._calibrationParameters;
+    double userSpeedLimit;
+    double maxSpeed;
+    {
+      boost::lock_guard<boost::mutex> lck(_motor._mutex);
+      userSpeedLimit = _motor._motorController->getUserSpeedLimit();
+      maxSpeed = _motor._motorController->getMaxSpeedCapability();
+    }
+
+    try {
+      reportCalibrationProgress(CalibrationPhase::FAST_APPROACH, sign);
+      setSearchSpeed(maxSpeed);
+      findEndSwitch(sign);
+
+      if(!(_stopAction.load() || _moveInterrupted.load())) {
+        setSearchSpeed(userSpeedLimit * parameters.fineSpeedFraction);
+        reportCalibrationProgress(CalibrationPhase::BACK_OFF, sign);
+        moveRelativeAndWait(-static_cast<int>(sign) * parameters.backOffInSteps);
+        if(_motor.isEndSwitchActive(sign)) {
+          // still on the switch, the back-off distance is too short for this switch
+          _moveInterrupted.exchange(true);
+        }
+      }
+
+      if(!(_stopAction.load() || _moveInterrupted.load())) {
+        // The switch is at most the back-off distance away, so a missing switch is detected after one move
+        reportCalibrationProgress(CalibrationPhase::FINE_APPROACH, sign);
+        moveRelativeAndWait(static_cast<int>(sign) * 2 * parameters.backOffInSteps);
+        if(!_motor.isEndSwitchActive(sign)) {
+          _moveInterrupted.exchange(true);
+        }
+      }
+    }
+    catch(ChimeraTK::runtime_error&) {
+      setSearchSpeed(userSpeedLimit);
+      throw;
     }
-    while(_motor._motorController->isMotorMoving()) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(wakeupPeriodInMilliseconds));
+    setSearchSpeed(userSpeedLimit);
+  }
+
+  void ReferenceStateMachine::setSearchSpeed(double speedInUstepsPerSec) {
+    boost::lock_guard<boost::mutex> lck(_motor._mutex);
+    _motor._motorController->setUserSpeedLimit(speedInUstepsPerSec);
+  }
+
+  void ReferenceStateMachine::reportCalibrationProgress(CalibrationPhase phase, Sign sign) {
+    const auto& callback = _motor._calibrationParameters.progressCallback;
+    if(!callback) {
+      return;
     }
+    CalibrationProgress progress;
+    progress.phase = phase;
+    progress.direction = static_cast<int>(sign);
+    progress.positionInSteps = _motor.getCurrentPositionInSteps();
+    callback(progress);
+  }
+
+  void ReferenceStateMachine::waitForMotorStandstill() {
+    _motor._motionPoller->waitUntil([this] { return !_motor._motorController->isMotorMoving(); });
   }
 
   void ReferenceStateMachine::toleranceCalcThreadFunction() {
@@ -108,11 +181,17 @@ namespace ChimeraTK::MotorDriver {
       _motor._toleranceCalcFailed.exchange(true);
     }
     else {
-      calculateToleranceValues();
+      bool measurementIncomplete = false;
+      try {
+        calculateToleranceValues();
+      }
+      catch(ChimeraTK::runtime_error&) {
+        measurementIncomplete = true;
+      }
       if(_stopAction.load()) {
         _motor._toleranceCalculated.exchange(false);
       }
-      else if(_moveInterrupted.load()) {
+      else if(_moveInterrupted.load() || measurementIncomplete) {
         _motor._toleranceCalculated.exchange(false);
         _motor._toleranceCalcFailed.exchange(true);
 
@@ -139,60 +218,84 @@ namespace ChimeraTK::MotorDriver {
   }
 
   double ReferenceStateMachine::getToleranceEndSwitch(Sign sign) {
-    double meanMeasurement = 0;
-    double stdMeasurement = 0;
-    const int N_TOLERANCE_CALC_SAMPLES = 10;
-    double measurements[N_TOLERANCE_CALC_SAMPLES];
-
-    int endSwitchPosition = getPositionEndSwitch(sign);
+    utility::RunningStatistics statistics;
+    clearToleranceSamples(sign);
 
-    // Get 10 samples for tolerance calculation
-    for(double& measurement : measurements) {
-      if(_stopAction.load() || _moveInterrupted.load()) {
+    while(!isToleranceMeasurementComplete(statistics)) {
+      int positionInSteps;
+      if(!measureEndSwitchPosition(sign, positionInSteps)) {
         break;
       }
+      addToleranceSample(sign, positionInSteps, statistics);
+    }
 
-      // Move close to end switch
-      {
-        boost::lock_guard<boost::mutex> lck(_motor._mutex);
-        _motor._motorController->setTargetPosition(endSwitchPosition - static_cast<int>(sign) * 1000);
-      }
-      while(_motor._motorController->isMotorMoving()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(wakeupPeriodInMilliseconds));
-      }
+    // The statistics of a partial measurement are meaningless
+    if(statistics.count() < _motor._toleranceParameters.minSamples) {
+      throw ChimeraTK::runtime_error("ReferenceStateMachine: The tolerance measurement of the " +
+          std::string(sign == Sign::POSITIVE ? "positive" : "negative") + " end switch ended after " +
+          std::to_string(statistics.count()) + " samples.");
+    }
+    return statistics.standardDeviation();
+  }
 
-      // Check if in expected position
-      if(!_motor.verifyMoveAction()) {
-        _moveInterrupted.exchange(true);
-        break;
-      }
+  bool ReferenceStateMachine::measureEndSwitchPosition(Sign sign, int& positionInSteps) {
+    if(_stopAction.load() || _moveInterrupted.load()) {
+      return false;
+    }
 
-      // Try to move beyond end switch
-      {
-        boost::lock_guard<boost::mutex> lck(_motor._mutex);
-        _motor._motorController->setTargetPosition(endSwitchPosition + static_cast<int>(sign) * 1000);
-      }
-      while(_motor._motorController->isMotorMoving()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(wakeupPeriodInMilliseconds));
-      }
-      if(!_motor.isEndSwitchActive(sign)) {
-        _moveInterrupted.exchange(true);
-        break;
-      }
+    int endSwitchPosition = getPositionEndSwitch(sign);
+    int approachDistance = _motor._toleranceParameters.approachDistanceInSteps;
 
-      // Mean calculation
-      meanMeasurement += static_cast<double>(_motor.getCurrentPositionInSteps()) / N_TOLERANCE_CALC_SAMPLES;
-      measurement = _motor.getCurrentPositionInSteps();
-    } /* for (i in [0,9]) */
+    // Move close to end switch
+    {
+      boost::lock_guard<boost::mutex> lck(_motor._mutex);
+      _motor._motorController->setTargetPosition(endSwitchPosition - static_cast<int>(sign) * approachDistance);
+    }
+    waitForMotorStandstill();
 
-    // Compute variance
-    if(!(_stopAction.load() || _moveInterrupted.load())) {
-      for(unsigned int i = 0; i < N_TOLERANCE_CALC_SAMPLES; i++) {
-        stdMeasurement += ((measurements[i] - meanMeasurement) / (N_TOLERANCE_CALC_SAMPLES - 1)) *
-            (measurements[i] - meanMeasurement);
-      }
+    // Check if in expected position
+    if(!_motor.verifyMoveAction()) {
+      _moveInterrupted.exchange(true);
+      return false;
+    }
+
+    // Try to move beyond end switch
+    {
+      boost::lock_guard<boost::mutex> lck(_motor._mutex);
+      _motor._motorController->setTargetPosition(endSwitchPosition + static_cast<int>(sign) * approachDistance);
+    }
+    waitForMotorStandstill();
+    if(_stopAction.load()) {
+      return false;
+    }
+    if(!_motor.isEndSwitchActive(sign)) {
+      _moveInterrupted.exchange(true);
+      return false;
     }
 
-    return sqrt(stdMeasurement);
+    positionInSteps = _motor.getCurrentPositionInSteps();
+    return true;
+  }
+
+  bool ReferenceStateMachine::isToleranceMeasurementComplete(const utility::RunningStatistics& statistics) const {
+    const auto& parameters = _motor._toleranceParameters;
+    if(statistics.count() >= parameters.maxSamples) {
+      return true;
+    }
+    return statistics.count() >= parameters.minSamples && parameters.confidenceWidthInSteps > 0. &&
+        statistics.standardDeviationConfidenceWidth(parameters.confidenceFactor) <= parameters.confidenceWidthInSteps;
+  }
+
+  void ReferenceStateMachine::clearToleranceSamples(Sign sign) {
+    boost::lock_guard<boost::mutex> lck(_motor._mutex);
+    (sign == Sign::POSITIVE ? _motor._positiveEndSwitchSamples : _motor._negativeEndSwitchSamples).clear();
+  }
+
+  void ReferenceStateMachine::addToleranceSample(
+      Sign sign, int positionInSteps, utility::RunningStatistics& statistics) {
+    statistics.add(positionInSteps);
+    boost::lock_guard<boost::mutex> lck(_motor._mutex);
+    (sign == Sign::POSITIVE ? _motor._positiveEndSwitchSamples : _motor._negativeEndSwitchSamples)
+        .push_back(positionInSteps);
   }
 } // namespace ChimeraTK::MotorDriver
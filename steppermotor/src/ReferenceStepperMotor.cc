@@ -17,7 +17,23 @@ namespace ChimeraTK::MotorDriver {
 
   ReferenceStepperMotor::ReferenceStepperMotor(
       const StepperMotorParameters& parameters, std::shared_ptr<utility::StateMachine> stateMachine)
-  : BasicStepperMotor(parameters) {
+  : BasicStepperMotor(parameters), _calibrationParameters(parameters.calibration),
+    _toleranceParameters(parameters.tolerance) {
+    if(!(_calibrationParameters.fineSpeedFraction > 0. && _calibrationParameters.fineSpeedFraction <= 1.)) {
+      throw ChimeraTK::logic_error(
+          "ReferenceStepperMotor: The fine speed fraction of the calibration must be in (0, 1].");
+    }
+    if(_calibrationParameters.backOffInSteps <= 0) {
+      throw ChimeraTK::logic_error("ReferenceStepperMotor: The calibration back-off distance must be positive.");
+    }
+    if(_toleranceParameters.minSamples < 2 || _toleranceParameters.maxSamples < _toleranceParameters.minSamples) {
+      throw ChimeraTK::logic_error(
+          "ReferenceStepperMotor: The tolerance measurement needs 2 <= minSamples <= maxSamples.");
+    }
+    if(!(_toleranceParameters.confidenceWidthInSteps >= 0.) || !(_toleranceParameters.confidenceFactor > 0.) ||
+        _toleranceParameters.approachDistanceInSteps <= 0) {
+      throw ChimeraTK::logic_error("ReferenceStepperMotor: Invalid parameters for the tolerance measurement.");
+    }
     _stateMachine = std::move(stateMachine);
     initStateMachine();
     _negativeEndSwitchEnabled = _motorController->getReferenceSwitchData().getNegativeSwitchEnabled();
@@ -28,8 +44,9 @@ namespace ChimeraTK::MotorDriver {
   ReferenceStepperMotor::~ReferenceStepperMotor() = default;
 
   bool ReferenceStepperMotor::motorActive() {
-    std::string stateName = _stateMachine->getCurrentState()->getName();
-    return (stateName == "moving" || stateName == "calibrating" || stateName == "calculatingTolerance");
+    auto state = _stateMachine->getCurrentStateId();
+    return (state == StateMachine::MOVING_STATE || state == ReferenceStateMachine::CALIBRATING_STATE ||
+        state == ReferenceStateMachine::CALCULATING_TOLERANCE_STATE);
   }
 
   bool ReferenceStepperMotor::limitsOK(int newPositionInSteps) {
@@ -42,7 +59,7 @@ namespace ChimeraTK::MotorDriver {
   }
 
   ExitStatus ReferenceStepperMotor::checkNewPosition(int newPositionInSteps) {
-    if(_stateMachine->getCurrentState()->getName() == "calibrating") {
+    if(_stateMachine->getCurrentStateId() == ReferenceStateMachine::CALIBRATING_STATE) {
       return ExitStatus::ERR_SYSTEM_IN_ACTION;
     }
     return BasicStepperMotor::checkNewPosition(newPositionInSteps);
@@ -145,7 +162,7 @@ namespace ChimeraTK::MotorDriver {
 
   float ReferenceStepperMotor::getPositiveEndReference() {
     LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(_calibPositiveEndSwitchInSteps.load());
+    return unitsConverter()->stepsToUnits(_calibPositiveEndSwitchInSteps.load());
   }
 
   int ReferenceStepperMotor::getNegativeEndReferenceInSteps() {
@@ -155,7 +172,7 @@ namespace ChimeraTK::MotorDriver {
 
   float ReferenceStepperMotor::getNegativeEndReference() {
     LockGuard guard(_mutex);
-    return _stepperMotorUnitsConverter->stepsToUnits(_calibNegativeEndSwitchInSteps.load());
+    return unitsConverter()->stepsToUnits(_calibNegativeEndSwitchInSteps.load());
   }
 
   float ReferenceStepperMotor::getTolerancePositiveEndSwitch() {
@@ -168,6 +185,16 @@ namespace ChimeraTK::MotorDriver {
     return _toleranceNegativeEndSwitch.load();
   }
 
+  std::vector<int> ReferenceStepperMotor::getPositiveEndSwitchSamplesInSteps() {
+    LockGuard guard(_mutex);
+    return _positiveEndSwitchSamples;
+  }
+
+  std::vector<int> ReferenceStepperMotor::getNegativeEndSwitchSamplesInSteps() {
+    LockGuard guard(_mutex);
+    return _negativeEndSwitchSamples;
+  }
+
   bool ReferenceStepperMotor::isPositiveReferenceActive() {
     LockGuard guard(_mutex);
     return isEndSwitchActive(Sign::POSITIVE);
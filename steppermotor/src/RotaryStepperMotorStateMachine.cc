@@ -16,7 +16,7 @@ namespace ChimeraTK::MotorDriver {
     _stopAction.exchange(false);
     _moveInterrupted.exchange(false);
     try {
-      findEndSwitch(Sign::POSITIVE); // "home direction search"
+      searchEndSwitch(Sign::POSITIVE); // "home direction search"
       int homePosition = _motor.getCurrentPositionInSteps();
 
       if(_moveInterrupted.load() || _stopAction.load()) {
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: Deutsches Elektronen-Synchrotron DESY, MSK, ChimeraTK Project <chimeratk-support@desy.de>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "StepperMotor.h"
+
+#include <ChimeraTK/Exception.h>
+
+namespace ChimeraTK::MotorDriver {
+
+  std::future<MoveResult> StepperMotor::moveToAsync(float, MoveCallback) {
+    throw ChimeraTK::logic_error("Asynchronous moves are not supported by this StepperMotor");
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> StepperMotor::moveToAsyncInSteps(int, MoveCallback) {
+    throw ChimeraTK::logic_error("Asynchronous moves are not supported by this StepperMotor");
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> StepperMotor::moveRelativeAsync(float, MoveCallback) {
+    throw ChimeraTK::logic_error("Asynchronous moves are not supported by this StepperMotor");
+  }
+
+  /********************************************************************************************************************/
+
+  std::future<MoveResult> StepperMotor::moveRelativeAsyncInSteps(int, MoveCallback) {
+    throw ChimeraTK::logic_error("Asynchronous moves are not supported by this StepperMotor");
+  }
+
+  /********************************************************************************************************************/
+
+  std::vector<int> StepperMotor::getPositiveEndSwitchSamplesInSteps() {
+    return {};
+  }
+
+  /********************************************************************************************************************/
+
+  std::vector<int> StepperMotor::getNegativeEndSwitchSamplesInSteps() {
+    return {};
+  }
+
+} // namespace ChimeraTK::MotorDriver
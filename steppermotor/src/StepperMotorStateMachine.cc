@@ -71,6 +71,11 @@ namespace ChimeraTK::MotorDriver {
 
   void BasicStepperMotor::StateMachine::actionIdleToMove() {
     _asyncActionActive.exchange(true);
+    ++_stepperMotor._moveCounter;
+    if(_stepperMotor._targetPositionWritten) {
+      _stepperMotor._targetPositionWritten = false;
+      return;
+    }
     _motorControler->setTargetPosition(_stepperMotor._targetPositionInSteps);
   }
 
@@ -94,9 +99,7 @@ namespace ChimeraTK::MotorDriver {
   /********************************************************************************************************************/
 
   void BasicStepperMotor::StateMachine::actionEmergencyStop() {
-    _motorControler->setMotorCurrentEnabled(false);
-    _motorControler->setEndSwitchPowerEnabled(false);
-    actionMovetoStop();
+    _motorControler->emergencyStop();
     _motorControler->setCalibrationTime(0);
     _stepperMotor._calibrationMode.exchange(CalibrationMode::NONE);
     _stepperMotor._errorMode.exchange(Error::EMERGENCY_STOP);
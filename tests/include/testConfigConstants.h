@@ -9,6 +9,8 @@ const ChimeraTK::RegisterPath MODULE_NAME_1("MD22_1");
 const std::string MAP_FILE_NAME("newer_firmware_mapfile.map");
 const std::string DFMC_ALIAS("DFMC_MD22");
 const std::string DFMC_ALIAS2("DFMC_MD22_PERSISTENT_BACKEND");
+// like DFMC_ALIAS, with the registers for batch transfers on the controler SPI
+const std::string DFMC_BATCH_SPI_ALIAS("DFMC_MD22_BATCH_SPI");
 const std::string BROKEN_MAP_FILE_NAME("DFMC_MD22_broken.mapp");
 const std::string DUMMY_MOC_MAP("mtcadummy_DFMC_MD22_mock.mapp");
 
@@ -0,0 +1,108 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE HotPathAllocationsTest
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test_framework;
+
+#include "MotorControlerExpert.h"
+#include "MotorDriverCard.h"
+#include "MotorDriverCardFactory.h"
+
+#include "testConfigConstants.h"
+
+#include <cstdlib>
+#include <new>
+
+using namespace mtca4u;
+
+/* Counts the heap allocations of the thread which has enabled the counting.
+ * Replacing the global operator new affects the whole test executable, which
+ * is why this test has an executable of its own.
+ */
+namespace {
+  thread_local bool countAllocations = false;
+  thread_local size_t nAllocations = 0;
+} // namespace
+
+void* operator new(size_t size) {
+  if(countAllocations) {
+    ++nAllocations;
+  }
+  if(void* memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+  std::free(memory);
+}
+
+/// The number of allocations per call of the function, after it has been called once to set up all caches
+template<class Function>
+double allocationsPerCall(Function function, size_t nCalls = 10) {
+  function();
+  nAllocations = 0;
+  countAllocations = true;
+  for(size_t i = 0; i < nCalls; ++i) {
+    function();
+  }
+  countAllocations = false;
+  return static_cast<double>(nAllocations) / static_cast<double>(nCalls);
+}
+
+class HotPathFixture {
+ public:
+  HotPathFixture() {
+    MotorDriverCardFactory::setDeviceaccessDMapFilePath("./dummies.dmap");
+    _motorDriverCard = MotorDriverCardFactory::instance().createMotorDriverCard(
+        DFMC_ALIAS, MODULE_NAME_0, "MotorDriverCardConfig_minimal_test.xml");
+    _motorControler = boost::dynamic_pointer_cast<MotorControlerExpert>(_motorDriverCard->getMotorControler(0));
+  }
+
+ protected:
+  boost::shared_ptr<MotorDriverCard> _motorDriverCard;
+  boost::shared_ptr<MotorControlerExpert> _motorControler;
+};
+
+BOOST_FIXTURE_TEST_SUITE(HotPathAllocationsTestSuite, HotPathFixture)
+
+BOOST_AUTO_TEST_CASE(testAllocationCounting) {
+  // make sure the hook works, otherwise all other tests would pass trivially
+  BOOST_CHECK_EQUAL(allocationsPerCall([] { delete new int(42); }), 1.);
+}
+
+BOOST_AUTO_TEST_CASE(testSpiTransactions) {
+  BOOST_REQUIRE(_motorControler);
+  int volatile result = 0;
+
+  // each of these is one handshake with the controler SPI
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = static_cast<int>(_motorControler->getTargetPosition()); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { _motorControler->setActualPosition(5); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { _motorControler->setTargetPosition(10); }), 0.);
+  BOOST_CHECK_EQUAL(
+      allocationsPerCall([&] { result = static_cast<int>(_motorControler->getReferenceSwitchData().getDataWord()); }),
+      0.);
+  BOOST_CHECK_EQUAL(
+      allocationsPerCall([&] { result = static_cast<int>(_motorControler->getInterruptData().getDataWord()); }), 0.);
+}
+
+BOOST_AUTO_TEST_CASE(testRegisterGetters) {
+  BOOST_REQUIRE(_motorControler);
+  int volatile result = 0;
+
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = _motorControler->getActualPosition(); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = _motorControler->getActualVelocity(); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = static_cast<int>(_motorControler->getMicroStepCount()); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = static_cast<int>(_motorControler->getDecoderPosition()); }), 0.);
+  BOOST_CHECK_EQUAL(
+      allocationsPerCall([&] { result = static_cast<int>(_motorControler->getStatus().getDataWord()); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = _motorControler->isMotorMoving(); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = _motorControler->targetPositionReached(); }), 0.);
+  BOOST_CHECK_EQUAL(allocationsPerCall([&] { result = _motorControler->isMotorCurrentEnabled(); }), 0.);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@ using namespace boost::unit_test_framework;
 #include "MotorDriverCard.h"
 #include "testWordFromPCIeAddress.h"
 
+#include <functional>
 #include <sstream>
 #include <thread>
 using namespace mtca4u::dfmc_md22;
@@ -189,6 +190,12 @@ namespace mtca4u {
 
     void testThreadSaftey();
     void testSetEndSwitchPowerEnabled();
+    void testEmergencyStop();
+    void testTargetPositionStreaming();
+    void testIsMotorMovingFastPath();
+    void testIsMotorMovingAtEndSwitches();
+    void testReadAllStatus();
+    void testReadbackRefresher();
 
    private:
     boost::shared_ptr<MotorControlerImpl> _motorControler;
@@ -311,6 +318,12 @@ namespace mtca4u {
   ADD_TEST(GetReferenceSwitchBit);
   ADD_TEST(ThreadSaftey);
   ADD_TEST(SetEndSwitchPowerEnabled);
+  ADD_TEST(EmergencyStop);
+  ADD_TEST(TargetPositionStreaming);
+  ADD_TEST(IsMotorMovingFastPath);
+  ADD_TEST(IsMotorMovingAtEndSwitches);
+  ADD_TEST(ReadAllStatus);
+  ADD_TEST(ReadbackRefresher);
 
   MotorControlerTest::MotorControlerTest(
       boost::shared_ptr<MotorControler> const& motorControler, boost::shared_ptr<DFMC_MD22Dummy> dummyDevice)
@@ -370,6 +383,236 @@ namespace mtca4u {
     BOOST_CHECK(controller_old->isEndSwitchPowerEnabled() == false);
   }
 
+  void MotorControlerTest::testEmergencyStop() {
+    bool wasMotorCurrentEnabled = _motorControler->isMotorCurrentEnabled();
+    bool wasEndSwitchPowerEnabled = _motorControler->isEndSwitchPowerEnabled();
+    _motorControler->setMotorCurrentEnabled(true);
+    _motorControler->setActualPosition(1234);
+    _motorControler->setTargetPosition(5000);
+
+    _motorControler->emergencyStop();
+    BOOST_CHECK(_motorControler->isMotorCurrentEnabled() == false);
+    BOOST_CHECK(_motorControler->isEndSwitchPowerEnabled() == false);
+    BOOST_CHECK(_motorControler->getTargetPosition() == 1234);
+
+    _motorControler->setMotorCurrentEnabled(wasMotorCurrentEnabled);
+    _motorControler->setEndSwitchPowerEnabled(wasEndSwitchPowerEnabled);
+  }
+
+  void MotorControlerTest::testTargetPositionStreaming() {
+    // The controler status is a plain register in the dummy, it is set here to simulate the motor
+    ChimeraTK::Device device;
+    device.open("DFMC_MD22");
+    auto controlerStatus = device.getScalarRegisterAccessor<int32_t>(
+        MODULE_NAME_0 / CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {ChimeraTK::AccessMode::raw});
+    controlerStatus.read();
+    int32_t originalControlerStatus = controlerStatus;
+    auto setMoveEnded = [&](bool moveEnded) {
+      TMC429StatusWord statusWord;
+      if(moveEnded) {
+        statusWord.setDataWord(1U << (2 * _motorControler->getID()));
+      }
+      controlerStatus = static_cast<int32_t>(statusWord.getDataWord());
+      controlerStatus.write();
+    };
+    auto countTransactions = [&](std::function<void()> action) {
+      auto handshakeCount = _dummyDevice->getControllerSpiHandshakeCount();
+      action();
+      return _dummyDevice->getControllerSpiHandshakeCount() - handshakeCount;
+    };
+
+    // The first move sets the interrupt masks and clears the flags, the following target updates while the motor is
+    // moving only write the target position
+    setMoveEnded(false);
+    BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(1000); }), 2U);
+    for(int target = 1010; target < 1100; target += 10) {
+      BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(target); }), 1U);
+    }
+    BOOST_CHECK(_motorControler->getTargetPosition() == 1090);
+    InterruptData interruptData = _motorControler->getInterruptData();
+    BOOST_CHECK(interruptData.getMaskFlags() == 255);
+
+    // After the move has ended the flags are cleared again
+    setMoveEnded(true);
+    BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(2000); }), 2U);
+    setMoveEnded(false);
+    BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(2010); }), 1U);
+
+    // Changing the interrupt configuration requires setting the masks again
+    _motorControler->setInterruptData(InterruptData());
+    BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(3000); }), 2U);
+    BOOST_CHECK(_motorControler->getInterruptData().getMaskFlags() == 255);
+    BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(3010); }), 1U);
+
+    // A failed write does not change the local state, the next move sets the masks again
+    _motorControler->setInterruptData(InterruptData());
+    _dummyDevice->causeSpiErrors(true);
+    BOOST_CHECK_THROW(_motorControler->setTargetPosition(4000), ChimeraTK::runtime_error);
+    _dummyDevice->causeSpiErrors(false);
+    BOOST_CHECK_EQUAL(countTransactions([&] { _motorControler->setTargetPosition(4000); }), 2U);
+    BOOST_CHECK(_motorControler->getInterruptData().getMaskFlags() == 255);
+
+    controlerStatus = originalControlerStatus;
+    controlerStatus.write();
+  }
+
+  void MotorControlerTest::testIsMotorMovingFastPath() {
+    // The controler status is a plain register in the dummy, it is set here to simulate the motor
+    ChimeraTK::Device device;
+    device.open("DFMC_MD22");
+    auto controlerStatus = device.getScalarRegisterAccessor<int32_t>(
+        MODULE_NAME_0 / CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {ChimeraTK::AccessMode::raw});
+    controlerStatus.read();
+    int32_t originalControlerStatus = controlerStatus;
+    auto setControlerStatus = [&](bool targetPositionReached, bool referenceSwitchBit) {
+      auto id = _motorControler->getID();
+      controlerStatus = static_cast<int32_t>((targetPositionReached ? 1U << (2 * id) : 0U) |
+          (referenceSwitchBit ? 1U << (2 * id + 1) : 0U));
+      controlerStatus.write();
+    };
+    auto countTransactions = [&](std::function<void()> action) {
+      auto handshakeCount = _dummyDevice->getControllerSpiHandshakeCount();
+      action();
+      return _dummyDevice->getControllerSpiHandshakeCount() - handshakeCount;
+    };
+    bool isMoving = false;
+
+    // At the target position no SPI transfer is needed
+    setControlerStatus(true, false);
+    BOOST_CHECK_EQUAL(countTransactions([&] { isMoving = _motorControler->isMotorMoving(); }), 0U);
+    BOOST_CHECK(isMoving == (_motorControler->getStatus().getStandstillIndicator() == 0));
+
+    // Otherwise the motor might have been stopped by either of the reference switches, but the status word only has
+    // one reference switch bit. The interrupt flags are needed from the controler.
+    setControlerStatus(false, false);
+    BOOST_CHECK(countTransactions([&] { _motorControler->isMotorMoving(); }) > 0U);
+    setControlerStatus(false, true);
+    BOOST_CHECK(countTransactions([&] { _motorControler->isMotorMoving(); }) > 0U);
+
+    controlerStatus = originalControlerStatus;
+    controlerStatus.write();
+  }
+
+  void MotorControlerTest::testIsMotorMovingAtEndSwitches() {
+    auto id = _motorControler->getID();
+    // The driver status is a plain register in the dummy, the standstill is set here to simulate a stopped motor
+    ChimeraTK::Device device;
+    device.open("DFMC_MD22");
+    auto driverStatus = device.getScalarRegisterAccessor<int32_t>(
+        MODULE_NAME_0 / createMotorRegisterName(id, STATUS_SUFFIX), 0, {ChimeraTK::AccessMode::raw});
+    driverStatus.read();
+    int32_t originalDriverStatus = driverStatus;
+    DriverStatusData standstillStatus;
+    standstillStatus.setStandstillIndicator(1);
+    driverStatus = static_cast<int32_t>(standstillStatus.getDataWord());
+    driverStatus.write();
+
+    auto originalSwitchData = _motorControler->getReferenceSwitchData();
+    _motorControler->setPositiveReferenceSwitchEnabled(true);
+    _motorControler->setNegativeReferenceSwitchEnabled(true);
+
+    // The motor is stopped by the switch before it reaches the target position, and does not raise INT_STOP
+    for(bool positiveSwitch : {true, false}) {
+      _dummyDevice->setReferenceSwitchesActive(id, false, false);
+      _motorControler->setActualPosition(0);
+      _motorControler->setTargetPosition(positiveSwitch ? 1000 : -1000);
+      _motorControler->setInterruptData(InterruptData());
+      BOOST_CHECK(!_motorControler->targetPositionReached());
+      BOOST_CHECK(_motorControler->isMotorMoving());
+
+      _dummyDevice->setReferenceSwitchesActive(id, positiveSwitch, !positiveSwitch);
+      // The status word only reports the negative switch
+      BOOST_CHECK_EQUAL(_motorControler->getReferenceSwitchBit(), positiveSwitch ? 0U : 1U);
+      BOOST_CHECK(!_motorControler->isMotorMoving());
+    }
+
+    _dummyDevice->setReferenceSwitchesActive(
+        id, originalSwitchData.getPositiveSwitchActive(), originalSwitchData.getNegativeSwitchActive());
+    _motorControler->setPositiveReferenceSwitchEnabled(originalSwitchData.getPositiveSwitchEnabled());
+    _motorControler->setNegativeReferenceSwitchEnabled(originalSwitchData.getNegativeSwitchEnabled());
+    driverStatus = originalDriverStatus;
+    driverStatus.write();
+  }
+
+  void MotorControlerTest::testReadAllStatus() {
+    auto snapshot = _motorControler->readAllStatus();
+    BOOST_CHECK(snapshot.updateCounter > 0);
+    BOOST_CHECK(snapshot.actualPosition == _motorControler->getActualPosition());
+    BOOST_CHECK(snapshot.actualVelocity == _motorControler->getActualVelocity());
+    BOOST_CHECK(snapshot.actualAcceleration == _motorControler->getActualAcceleration());
+    BOOST_CHECK(snapshot.microStepCount == _motorControler->getMicroStepCount());
+    BOOST_CHECK(snapshot.stallGuardValue == testWordFromPCIeSuffix(STALL_GUARD_VALUE_SUFFIX));
+    BOOST_CHECK(snapshot.coolStepValue == testWordFromPCIeSuffix(COOL_STEP_VALUE_SUFFIX));
+    BOOST_CHECK(snapshot.driverStatusWord == testWordFromPCIeSuffix(STATUS_SUFFIX));
+    BOOST_CHECK(snapshot.decoderReadoutMode == _motorControler->getDecoderReadoutMode());
+    BOOST_CHECK(snapshot.decoderPosition == testWordFromPCIeSuffix(DECODER_POSITION_SUFFIX));
+    BOOST_CHECK(snapshot.motorCurrentEnabled == _motorControler->isMotorCurrentEnabled());
+
+    // the signed registers are converted like in the getters
+    _motorControler->setActualPosition(-5);
+    _motorControler->setActualVelocity(-3);
+    snapshot = _motorControler->readAllStatus();
+    BOOST_CHECK(snapshot.actualPosition == -5);
+    BOOST_CHECK(snapshot.actualVelocity == -3);
+
+    // the individual getters still work after the group has been read
+    BOOST_CHECK(_motorControler->getActualPosition() == -5);
+    BOOST_CHECK(_motorControler->readAllStatus().updateCounter > snapshot.updateCounter);
+  }
+
+  void MotorControlerTest::testReadbackRefresher() {
+    // the snapshot is not valid before the refresher has run
+    BOOST_CHECK(_motorControler->isReadbackRefresherRunning() == false);
+    BOOST_CHECK(_motorControler->getReadbackSnapshot().updateCounter == 0);
+    BOOST_CHECK_THROW(
+        _motorControler->startReadbackRefresher(std::chrono::microseconds(0)), ChimeraTK::logic_error);
+
+    auto waitForSnapshot = [&](std::function<bool(MotorStatusSnapshot const&)> condition) {
+      for(size_t i = 0; i < 5000; ++i) {
+        if(condition(_motorControler->getReadbackSnapshot())) {
+          return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return false;
+    };
+
+    _motorControler->startReadbackRefresher(std::chrono::milliseconds(1));
+    BOOST_CHECK(_motorControler->isReadbackRefresherRunning());
+    BOOST_REQUIRE(waitForSnapshot([](MotorStatusSnapshot const& s) { return s.updateCounter > 0; }));
+
+    auto snapshot = _motorControler->getReadbackSnapshot();
+    BOOST_CHECK(snapshot.actualPosition == _motorControler->getActualPosition());
+    BOOST_CHECK(snapshot.actualVelocity == _motorControler->getActualVelocity());
+    BOOST_CHECK(snapshot.actualAcceleration == _motorControler->getActualAcceleration());
+    BOOST_CHECK(snapshot.microStepCount == _motorControler->getMicroStepCount());
+    BOOST_CHECK(snapshot.stallGuardValue == _motorControler->getStallGuardValue());
+    BOOST_CHECK(snapshot.coolStepValue == _motorControler->getCoolStepValue());
+    BOOST_CHECK(snapshot.getStatus() == _motorControler->getStatus());
+    BOOST_CHECK(snapshot.decoderReadoutMode == _motorControler->getDecoderReadoutMode());
+    BOOST_CHECK(snapshot.decoderPosition == _motorControler->getDecoderPosition());
+    BOOST_CHECK(snapshot.motorCurrentEnabled == _motorControler->isMotorCurrentEnabled());
+
+    // changes in the hardware show up in one of the next snapshots
+    _motorControler->setActualAcceleration(0x1234);
+    BOOST_CHECK(waitForSnapshot([](MotorStatusSnapshot const& s) { return s.actualAcceleration == 0x1234; }));
+    auto newSnapshot = _motorControler->getReadbackSnapshot();
+    BOOST_CHECK(newSnapshot.updateCounter > snapshot.updateCounter);
+    BOOST_CHECK(newSnapshot.timestamp > snapshot.timestamp);
+
+    // starting again only changes the period
+    _motorControler->startReadbackRefresher(std::chrono::milliseconds(2));
+    BOOST_CHECK(_motorControler->isReadbackRefresherRunning());
+
+    _motorControler->stopReadbackRefresher();
+    BOOST_CHECK(_motorControler->isReadbackRefresherRunning() == false);
+    auto lastCounter = _motorControler->getReadbackSnapshot().updateCounter;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK(_motorControler->getReadbackSnapshot().updateCounter == lastCounter);
+    // stopping twice is harmless
+    _motorControler->stopReadbackRefresher();
+  }
+
   unsigned int MotorControlerTest::testWordFromPCIeSuffix(std::string const& registerSuffix) {
     std::string registerName = createMotorRegisterName(_motorControler->getID(), registerSuffix);
     auto registerInfo = _dummyDevice->getRegisterInfo(MODULE_NAME_0 / registerName);
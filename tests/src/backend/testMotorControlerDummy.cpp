@@ -381,6 +381,14 @@ BOOST_FIXTURE_TEST_CASE(TestMoveTowardsTarget, MotorControlerDummyTest) {
   _motorControlerDummy.setEnabled(false);
 }
 
+BOOST_FIXTURE_TEST_CASE(TestGetSetMaxSpeedCapability, MotorControlerDummyTest) {
+  BOOST_CHECK(_motorControlerDummy.getMaxSpeedCapability() == 1000000);
+  BOOST_CHECK(_motorControlerDummy.getMaxSpeedCapability() > _motorControlerDummy.getUserSpeedLimit());
+  _motorControlerDummy.setMaxSpeedCapability(5000);
+  BOOST_CHECK(_motorControlerDummy.getMaxSpeedCapability() == 5000);
+  _motorControlerDummy.setMaxSpeedCapability(1000000);
+}
+
 DECLARE_GET_SET_THROW_TEST(MinimumVelocity)
 DECLARE_GET_SET_THROW_TEST(MaximumVelocity)
 DECLARE_GET_SET_THROW_TEST(TargetVelocity)
@@ -20,6 +20,11 @@ using namespace mtca4u::tmc429;
 
 #include "DFMC_MD22Constants.h"
 #include "testConfigConstants.h"
+#include "TMC260DummyConstants.h"
+
+#include <boost/make_shared.hpp>
+
+#include <functional>
 
 namespace mtca4u {
   using namespace ChimeraTK;
@@ -42,7 +47,8 @@ namespace mtca4u {
 
     // needed because the constructor of MotorDriverCardImpl is private, and the test is a friend
     static boost::shared_ptr<MotorDriverCardImpl> createCard(boost::shared_ptr<ChimeraTK::Device> const& device,
-        std::string const& moduleName, MotorDriverCardConfig const& cardConfiguration);
+        std::string const& moduleName, MotorDriverCardConfig const& cardConfiguration, bool differentialInit = false,
+        boost::shared_ptr<RegisterShadow> const& registerShadow = boost::shared_ptr<RegisterShadow>());
 
     boost::shared_ptr<MotorDriverCardImpl> motorDriverCard;
     boost::shared_ptr<DFMC_MD22Dummy> dummyDevice;
@@ -58,8 +64,10 @@ namespace mtca4u {
 
   boost::shared_ptr<MotorDriverCardImpl> MotorDriverCardTest::createCard(
       boost::shared_ptr<ChimeraTK::Device> const& device, std::string const& moduleName,
-      MotorDriverCardConfig const& cardConfiguration) {
-    return boost::shared_ptr<MotorDriverCardImpl>(new MotorDriverCardImpl(device, moduleName, cardConfiguration));
+      MotorDriverCardConfig const& cardConfiguration, bool differentialInit,
+      boost::shared_ptr<RegisterShadow> const& registerShadow) {
+    return boost::shared_ptr<MotorDriverCardImpl>(
+        new MotorDriverCardImpl(device, moduleName, cardConfiguration, differentialInit, registerShadow));
   }
 
   void testConfiguration(MotorDriverCardConfig const& motorDriverCardConfig);
@@ -319,4 +327,217 @@ namespace mtca4u {
     BOOST_CHECK_THROW(gTest.motorDriverCard->getMotorControler(N_MOTORS_MAX), ChimeraTK::logic_error);
   }
 
+  BOOST_AUTO_TEST_CASE(TestSetTargetPositions) {
+    BOOST_CHECK_THROW(
+        gTest.motorDriverCard->setTargetPositions({{0, 100}, {N_MOTORS_MAX, 200}}), ChimeraTK::logic_error);
+
+    // Without firmware support for batch transfers each word is written with its own handshake
+    auto nHandshakesBefore = gTest.dummyDevice->getControllerSpiHandshakeCount();
+    gTest.motorDriverCard->setTargetPositions({{0, 100}, {1, -200}});
+    BOOST_CHECK_EQUAL(gTest.dummyDevice->getControllerSpiHandshakeCount() - nHandshakesBefore, 4);
+    BOOST_CHECK_EQUAL(gTest.motorDriverCard->getMotorControler(0)->getTargetPosition(), 100);
+    BOOST_CHECK_EQUAL(gTest.motorDriverCard->getMotorControler(1)->getTargetPosition(), -200);
+
+    // With firmware support the targets of both motors are written in one batch transfer
+    auto batchDummyDevice = boost::dynamic_pointer_cast<DFMC_MD22Dummy>(
+        ChimeraTK::BackendFactory::getInstance().createBackend(DFMC_BATCH_SPI_ALIAS));
+    auto device = boost::make_shared<Device>();
+    device->open(DFMC_BATCH_SPI_ALIAS);
+    auto batchCard = MotorDriverCardTest::createCard(device, MODULE_NAME_0, MotorDriverCardConfig());
+    nHandshakesBefore = batchDummyDevice->getControllerSpiHandshakeCount();
+    batchCard->setTargetPositions({{0, 300}, {1, -400}});
+    BOOST_CHECK_EQUAL(batchDummyDevice->getControllerSpiHandshakeCount() - nHandshakesBefore, 1);
+    BOOST_CHECK_EQUAL(batchCard->getMotorControler(0)->getTargetPosition(), 300);
+    BOOST_CHECK_EQUAL(batchCard->getMotorControler(1)->getTargetPosition(), -400);
+  }
+
+  BOOST_AUTO_TEST_CASE(TestSpiCounters) {
+    // Every handshake on the controler SPI is one transaction
+    gTest.motorDriverCard->resetControlerSpiCounters();
+    auto nHandshakesBefore = gTest.dummyDevice->getControllerSpiHandshakeCount();
+    gTest.motorDriverCard->setTargetPositions({{0, 10}, {1, 20}});
+    gTest.motorDriverCard->getMotorControler(0)->getTargetPosition();
+    auto counters = gTest.motorDriverCard->getControlerSpiCounters();
+    BOOST_CHECK_EQUAL(counters.nTransactions, gTest.dummyDevice->getControllerSpiHandshakeCount() - nHandshakesBefore);
+    BOOST_CHECK_EQUAL(counters.nTimeouts, 0U);
+
+    // The controler SPI is shared by all motors, the driver SPI belongs to one motor
+    auto motorControler =
+        boost::dynamic_pointer_cast<MotorControlerExpert>(gTest.motorDriverCard->getMotorControler(0));
+    BOOST_REQUIRE(motorControler);
+    BOOST_CHECK_EQUAL(motorControler->getControlerSpiCounters().nTransactions, counters.nTransactions);
+    motorControler->resetDriverSpiCounters();
+    motorControler->setChopperControlData(motorControler->getChopperControlData());
+    BOOST_CHECK_EQUAL(motorControler->getDriverSpiCounters().nTransactions, 1U);
+
+    gTest.motorDriverCard->resetControlerSpiCounters();
+    BOOST_CHECK_EQUAL(motorControler->getControlerSpiCounters().nTransactions, 0U);
+  }
+
+  BOOST_AUTO_TEST_CASE(TestCommonRegisterCache) {
+    Device device;
+    device.open(DFMC_ALIAS);
+    auto controlerStatus = device.getScalarRegisterAccessor<int32_t>(
+        MODULE_NAME_0 / CONTROLER_STATUS_BITS_ADDRESS_STRING, 0, {AccessMode::raw});
+    controlerStatus.read();
+    int32_t originalControlerStatus = controlerStatus;
+    auto setControlerStatus = [&](int32_t value) {
+      controlerStatus = value;
+      controlerStatus.write();
+    };
+    auto countHandshakes = [&](std::function<void()> action) {
+      auto handshakeCount = gTest.dummyDevice->getControllerSpiHandshakeCount();
+      action();
+      return gTest.dummyDevice->getControllerSpiHandshakeCount() - handshakeCount;
+    };
+    auto motorControler0 = gTest.motorDriverCard->getMotorControler(0);
+    auto motorControler1 = gTest.motorDriverCard->getMotorControler(1);
+
+    // By default every request reads the hardware
+    BOOST_CHECK(gTest.motorDriverCard->getCommonRegisterMaximumAge() == std::chrono::microseconds(0));
+    setControlerStatus(0x1);
+    BOOST_CHECK(motorControler0->targetPositionReached());
+    setControlerStatus(0x0);
+    BOOST_CHECK(!motorControler0->targetPositionReached());
+
+    BOOST_CHECK_THROW(
+        gTest.motorDriverCard->setCommonRegisterMaximumAge(std::chrono::microseconds(-1)), ChimeraTK::logic_error);
+    gTest.motorDriverCard->setCommonRegisterMaximumAge(std::chrono::seconds(10));
+    BOOST_CHECK(gTest.motorDriverCard->getCommonRegisterMaximumAge() == std::chrono::seconds(10));
+
+    // Both motors use the status word which has been read first
+    setControlerStatus(0x1);
+    BOOST_CHECK(motorControler0->targetPositionReached());
+    setControlerStatus(0x4);
+    BOOST_CHECK(motorControler1->targetPositionReached() == false);
+    BOOST_CHECK(gTest.motorDriverCard->getStatusWord().getDataWord() == 0x1);
+
+    // The reference switch word is read once for both motors. Reading the switch configuration is still needed.
+    BOOST_CHECK_EQUAL(countHandshakes([&] { motorControler0->getReferenceSwitchData(); }), 2U);
+    BOOST_CHECK_EQUAL(countHandshakes([&] { motorControler1->getReferenceSwitchData(); }), 1U);
+    BOOST_CHECK_EQUAL(countHandshakes([&] { gTest.motorDriverCard->getReferenceSwitchData(); }), 0U);
+
+    // A write via the controler SPI invalidates the cache
+    motorControler0->setTargetPosition(motorControler0->getTargetPosition());
+    BOOST_CHECK(motorControler1->targetPositionReached());
+    BOOST_CHECK_EQUAL(countHandshakes([&] { gTest.motorDriverCard->getReferenceSwitchData(); }), 1U);
+
+    gTest.motorDriverCard->setCommonRegisterMaximumAge(std::chrono::microseconds(0));
+    BOOST_CHECK_EQUAL(countHandshakes([&] { gTest.motorDriverCard->getReferenceSwitchData(); }), 1U);
+    setControlerStatus(originalControlerStatus);
+  }
+
+  BOOST_AUTO_TEST_CASE(TestDifferentialInit) {
+    boost::shared_ptr<Device> device(new Device());
+    device->open(DFMC_ALIAS);
+
+    MotorDriverCardConfig motorDriverCardConfig;
+    motorDriverCardConfig.coverDatagram = asciiToInt("DIFF");
+    motorDriverCardConfig.motorControlerConfigurations[1].maximumVelocity = asciiToInt("vd");
+
+    // the registers still contain the test words, so the configuration has to be written
+    gTest.motorDriverCard = MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true);
+    testConfiguration(motorDriverCardConfig);
+
+    // The card is configured already, only the readback is done and nothing is written
+    auto nHandshakesBefore = gTest.dummyDevice->getControllerSpiHandshakeCount();
+    gTest.motorDriverCard = MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true);
+    auto nHandshakesUnchanged = gTest.dummyDevice->getControllerSpiHandshakeCount() - nHandshakesBefore;
+    testConfiguration(motorDriverCardConfig);
+
+    // Only the changed registers are written. The readback is the same, plus one handshake for each changed
+    // register, as this firmware has no batch transfers: the cover datagram and the maximum velocity of motor 1.
+    motorDriverCardConfig.coverDatagram = asciiToInt("DIFF") + 1;
+    motorDriverCardConfig.motorControlerConfigurations[1].maximumVelocity = asciiToInt("vd") + 1;
+    nHandshakesBefore = gTest.dummyDevice->getControllerSpiHandshakeCount();
+    gTest.motorDriverCard = MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true);
+    BOOST_CHECK_EQUAL(
+        gTest.dummyDevice->getControllerSpiHandshakeCount() - nHandshakesBefore, nHandshakesUnchanged + 2);
+    testConfiguration(motorDriverCardConfig);
+
+    // the full initialisation writes the same configuration
+    gTest.motorDriverCard = MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig);
+    testConfiguration(motorDriverCardConfig);
+  }
+
+  BOOST_AUTO_TEST_CASE(TestDifferentialInitUnchanged) {
+    // For an unchanged card the common registers and the registers of both motors are only read back, except for
+    // the two datagram words. They do not read back what has been written and are always written. Each motor also
+    // reads its target position.
+    unsigned int const nReadbacks = 6 + N_MOTORS_MAX * (11 + 1);
+    for(auto alias : {DFMC_ALIAS, DFMC_BATCH_SPI_ALIAS}) {
+      BOOST_TEST_CONTEXT(alias) {
+        auto dummyDevice = boost::dynamic_pointer_cast<DFMC_MD22Dummy>(
+            ChimeraTK::BackendFactory::getInstance().createBackend(alias));
+        auto device = boost::make_shared<Device>();
+        device->open(alias);
+        MotorDriverCardConfig motorDriverCardConfig;
+        MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true);
+
+        auto nHandshakesBefore = dummyDevice->getControllerSpiHandshakeCount();
+        MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true);
+        // with batch support both datagram words are written in one transfer
+        unsigned int nWriteHandshakes = (alias == DFMC_BATCH_SPI_ALIAS ? 1 : 2);
+        BOOST_CHECK_EQUAL(
+            dummyDevice->getControllerSpiHandshakeCount() - nHandshakesBefore, nReadbacks + nWriteHandshakes);
+      }
+    }
+  }
+
+  BOOST_AUTO_TEST_CASE(TestRegisterShadow) {
+    boost::shared_ptr<Device> device(new Device());
+    device->open(DFMC_ALIAS);
+    RegisterShadow::remove(DFMC_ALIAS, MODULE_NAME_0);
+    auto registerShadow = boost::make_shared<RegisterShadow>(DFMC_ALIAS, MODULE_NAME_0);
+
+    MotorDriverCardConfig motorDriverCardConfig;
+    for(unsigned int motorID = 0; motorID < N_MOTORS_MAX; ++motorID) {
+      motorDriverCardConfig.motorControlerConfigurations[motorID].chopperControlData.setPayloadData(
+          asciiToInt("sh") + motorID);
+    }
+    gTest.motorDriverCard =
+        MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true, registerShadow);
+    testConfiguration(motorDriverCardConfig);
+    for(unsigned int motorID = 0; motorID < N_MOTORS_MAX; ++motorID) {
+      ChopperControlData chopperControlData;
+      BOOST_CHECK(registerShadow->loadDriverWord(motorID, chopperControlData));
+      BOOST_CHECK(chopperControlData == motorDriverCardConfig.motorControlerConfigurations[motorID].chopperControlData);
+    }
+
+    // A second card on the same device (e.g. in another process) sees the driver data written by the first one
+    auto secondCard = MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true,
+        boost::make_shared<RegisterShadow>(DFMC_ALIAS, MODULE_NAME_0));
+    auto motorControler =
+        boost::dynamic_pointer_cast<MotorControlerExpert>(gTest.motorDriverCard->getMotorControler(1));
+    auto secondMotorControler = boost::dynamic_pointer_cast<MotorControlerExpert>(secondCard->getMotorControler(1));
+    motorControler->setCoolStepControlData(CoolStepControlData(0x1234));
+    BOOST_CHECK(secondMotorControler->getCoolStepControlData() == CoolStepControlData(0x1234));
+    secondCard.reset();
+
+    // The TMC429 registers are unchanged, so the driver registers are known from the shadow and not written again
+    gTest.dummyDevice->setDriverSpiRegistersForTesting();
+    gTest.motorDriverCard =
+        MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true, registerShadow);
+    BOOST_CHECK_EQUAL(gTest.dummyDevice->readDriverSpiRegister(0, tmc260::ADDRESS_CHOPPER_CONFIG),
+        tmc260::testWordFromSpiAddress(tmc260::ADDRESS_CHOPPER_CONFIG, 0));
+    // only the changed cool step data of motor 1 has been written
+    BOOST_CHECK_EQUAL(gTest.dummyDevice->readDriverSpiRegister(1, tmc260::ADDRESS_COOL_STEP_CONFIG),
+        motorDriverCardConfig.motorControlerConfigurations[1].coolStepControlData.getPayloadData());
+    BOOST_CHECK_EQUAL(gTest.dummyDevice->readDriverSpiRegister(1, tmc260::ADDRESS_CHOPPER_CONFIG),
+        tmc260::testWordFromSpiAddress(tmc260::ADDRESS_CHOPPER_CONFIG, 1));
+    testConfiguration(motorDriverCardConfig);
+
+    // If the TMC429 registers have been changed (e.g. by power cycling the card) the shadow is not trusted
+    gTest.dummyDevice->setRegistersForTesting();
+    gTest.motorDriverCard =
+        MotorDriverCardTest::createCard(device, MODULE_NAME_0, motorDriverCardConfig, true, registerShadow);
+    for(unsigned int motorID = 0; motorID < N_MOTORS_MAX; ++motorID) {
+      BOOST_CHECK_EQUAL(gTest.dummyDevice->readDriverSpiRegister(motorID, tmc260::ADDRESS_CHOPPER_CONFIG),
+          motorDriverCardConfig.motorControlerConfigurations[motorID].chopperControlData.getPayloadData());
+    }
+    testConfiguration(motorDriverCardConfig);
+
+    RegisterShadow::remove(DFMC_ALIAS, MODULE_NAME_0);
+  }
+
 } // namespace mtca4u
@@ -4,6 +4,7 @@
 using namespace boost::unit_test_framework;
 
 #include "DFMC_MD22Constants.h"
+#include "impl/MotorDriverCardImpl.h"
 #include "MotorDriverCardDummy.h"
 #include "MotorDriverCardFactory.h"
 #include "testConfigConstants.h"
@@ -82,6 +83,27 @@ BOOST_AUTO_TEST_CASE(testCreate) {
   BOOST_CHECK_EQUAL(motorDriverCard_PCIe1.use_count(), 2);
 }
 
+BOOST_AUTO_TEST_CASE(testSpiTransferThread) {
+  auto& factory = mtca4u::MotorDriverCardFactory::instance();
+  BOOST_CHECK(!factory.getSpiTransferThread());
+  factory.setSpiTransferThread();
+  BOOST_CHECK(factory.getSpiTransferThread());
+
+  // the cards of the previous tests are gone, so a new card is created
+  auto motorDriverCard = boost::dynamic_pointer_cast<mtca4u::MotorDriverCardImpl>(
+      factory.createMotorDriverCard(DFMC_ALIAS, MODULE_NAME_0, CONFIG_FILE));
+  factory.setSpiTransferThread(false);
+  BOOST_REQUIRE(motorDriverCard);
+
+  // the transfers of the motion commands are counted in their priority class
+  motorDriverCard->getMotorControler(0)->setTargetPosition(100);
+  BOOST_CHECK(motorDriverCard->getMotorControler(0)->getTargetPosition() == 100);
+  using Priority = mtca4u::SPIviaPCIe::Priority;
+  BOOST_CHECK(motorDriverCard->getControlerSpiPriorityStatistics(Priority::MOTION).nRequests > 0);
+  BOOST_CHECK(motorDriverCard->getControlerSpiPriorityStatistics(Priority::DIAGNOSTICS).nRequests > 0);
+  BOOST_CHECK_EQUAL(motorDriverCard->getControlerSpiPriorityStatistics(Priority::EMERGENCY_STOP).nRequests, 0);
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weffc++"
 BOOST_AUTO_TEST_CASE(testCreateDummy) {
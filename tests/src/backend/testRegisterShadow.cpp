@@ -0,0 +1,124 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE RegisterShadowTest
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test_framework;
+
+#include "DFMC_MD22Constants.h"
+#include "impl/RegisterShadow.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <thread>
+#include <vector>
+
+using namespace mtca4u;
+
+static const std::string shadowAlias("RegisterShadowTest");
+static const std::string shadowModule("MD22_0");
+
+struct RegisterShadowFixture {
+  RegisterShadowFixture() { RegisterShadow::remove(shadowAlias, shadowModule); }
+  ~RegisterShadowFixture() { RegisterShadow::remove(shadowAlias, shadowModule); }
+};
+
+BOOST_FIXTURE_TEST_SUITE(RegisterShadowTestSuite, RegisterShadowFixture)
+
+BOOST_AUTO_TEST_CASE(testSharedMemoryName) {
+  BOOST_CHECK_EQUAL(RegisterShadow::sharedMemoryName("DFMC_MD22", "MD22_0"), "MotorDriverCard_v1_DFMC_MD22_MD22_0");
+  // characters which are not allowed in file names are replaced
+  BOOST_CHECK_EQUAL(
+      RegisterShadow::sharedMemoryName("(sharedMemoryDummy:1?map=a/b.map)", "MD22/0"),
+      "MotorDriverCard_v1__sharedMemoryDummy_1_map_a_b.map__MD22_0");
+}
+
+BOOST_AUTO_TEST_CASE(testStoreAndLoad) {
+  RegisterShadow shadow(shadowAlias, shadowModule);
+
+  // nothing has been stored yet, the word is unchanged
+  ChopperControlData chopperControlData(0x123);
+  BOOST_CHECK(!shadow.loadDriverWord(0, chopperControlData));
+  BOOST_CHECK_EQUAL(chopperControlData.getPayloadData(), 0x123);
+
+  shadow.storeDriverWord(0, ChopperControlData(0x456));
+  shadow.storeDriverWord(1, ChopperControlData(0x789));
+  shadow.storeDriverWord(1, StallGuardControlData(0xAB));
+
+  BOOST_CHECK(shadow.loadDriverWord(0, chopperControlData));
+  BOOST_CHECK(chopperControlData == ChopperControlData(0x456));
+  BOOST_CHECK(shadow.loadDriverWord(1, chopperControlData));
+  BOOST_CHECK(chopperControlData == ChopperControlData(0x789));
+
+  // registers are distinguished by the address
+  StallGuardControlData stallGuardControlData;
+  BOOST_CHECK(!shadow.loadDriverWord(0, stallGuardControlData));
+  BOOST_CHECK(shadow.loadDriverWord(1, stallGuardControlData));
+  BOOST_CHECK(stallGuardControlData == StallGuardControlData(0xAB));
+  DriverControlData driverControlData;
+  BOOST_CHECK(!shadow.loadDriverWord(1, driverControlData));
+
+  BOOST_CHECK_THROW(shadow.storeDriverWord(dfmc_md22::N_MOTORS_MAX, DriverControlData()), ChimeraTK::logic_error);
+  BOOST_CHECK_THROW(shadow.loadDriverWord(dfmc_md22::N_MOTORS_MAX, driverControlData), ChimeraTK::logic_error);
+
+  shadow.invalidate();
+  BOOST_CHECK(!shadow.loadDriverWord(0, chopperControlData));
+  BOOST_CHECK(!shadow.loadDriverWord(1, stallGuardControlData));
+}
+
+BOOST_AUTO_TEST_CASE(testPersistence) {
+  // A second instance, like in another process, sees the same content. It stays
+  // after the instances are gone, until the shared memory is removed.
+  {
+    RegisterShadow shadow1(shadowAlias, shadowModule);
+    RegisterShadow shadow2(shadowAlias, shadowModule);
+    shadow1.storeDriverWord(1, DriverConfigData(0x1234));
+
+    DriverConfigData driverConfigData;
+    BOOST_CHECK(shadow2.loadDriverWord(1, driverConfigData));
+    BOOST_CHECK(driverConfigData == DriverConfigData(0x1234));
+  }
+  {
+    RegisterShadow shadow(shadowAlias, shadowModule);
+    DriverConfigData driverConfigData;
+    BOOST_CHECK(shadow.loadDriverWord(1, driverConfigData));
+    BOOST_CHECK(driverConfigData == DriverConfigData(0x1234));
+
+    // other cards have their own shadow
+    RegisterShadow otherShadow(shadowAlias, "MD22_1");
+    BOOST_CHECK(!otherShadow.loadDriverWord(1, driverConfigData));
+    RegisterShadow::remove(shadowAlias, "MD22_1");
+  }
+
+  RegisterShadow::remove(shadowAlias, shadowModule);
+  RegisterShadow shadow(shadowAlias, shadowModule);
+  DriverConfigData driverConfigData;
+  BOOST_CHECK(!shadow.loadDriverWord(1, driverConfigData));
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentAccess) {
+  RegisterShadow shadow(shadowAlias, shadowModule);
+
+  // each thread writes its own register with increasing values and must always
+  // read back what it has written last
+  std::vector<std::thread> threads;
+  std::vector<int> nInconsistent(dfmc_md22::N_MOTORS_MAX, 0);
+  for(unsigned int motorId = 0; motorId < dfmc_md22::N_MOTORS_MAX; ++motorId) {
+    threads.emplace_back([&, motorId] {
+      RegisterShadow threadShadow(shadowAlias, shadowModule);
+      for(unsigned int i = 0; i < 1000; ++i) {
+        threadShadow.storeDriverWord(motorId, CoolStepControlData(i));
+        CoolStepControlData coolStepControlData;
+        if(!shadow.loadDriverWord(motorId, coolStepControlData) || coolStepControlData.getPayloadData() != i) {
+          ++nInconsistent[motorId];
+        }
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  for(unsigned int motorId = 0; motorId < dfmc_md22::N_MOTORS_MAX; ++motorId) {
+    BOOST_CHECK_EQUAL(nInconsistent[motorId], 0);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
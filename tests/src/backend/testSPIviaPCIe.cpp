@@ -8,13 +8,20 @@ using namespace boost::unit_test_framework;
 #include "DFMC_MD22Constants.h"
 #include "DFMC_MD22Dummy.h"
 #include "impl/SPIviaPCIe.h"
+#include "impl/SpiArbitration.h"
 #include "testConfigConstants.h"
 #include "TMC260Words.h"
+#include "TMC429DummyConstants.h"
 #include "TMC429Words.h"
 
 #include <ChimeraTK/Device.h>
 #include <ChimeraTK/MapFileParser.h>
 
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+
 class SPIviaPCIeTestFixture {
  public:
   SPIviaPCIeTestFixture();
@@ -26,6 +33,11 @@ class SPIviaPCIeTestFixture {
   boost::shared_ptr<mtca4u::SPIviaPCIe> _readWriteSPIviaPCIe; // use controler which has read/write
   boost::shared_ptr<mtca4u::SPIviaPCIe> _writeSPIviaPCIe;     // use a motor address which has debug readback in the
                                                               // dummy
+
+  // firmware with the registers for batch transfers
+  boost::shared_ptr<mtca4u::DFMC_MD22Dummy> _batchDummyBackend;
+  boost::shared_ptr<ChimeraTK::Device> _batchDevice;
+  boost::shared_ptr<mtca4u::SPIviaPCIe> createBatchSPIviaPCIe();
 };
 
 SPIviaPCIeTestFixture::SPIviaPCIeTestFixture() {
@@ -45,6 +57,18 @@ SPIviaPCIeTestFixture::SPIviaPCIeTestFixture() {
   _writeSPIviaPCIe = boost::make_shared<mtca4u::SPIviaPCIe>(_device, moduleName,
       mtca4u::dfmc_md22::MOTOR_REGISTER_PREFIX + "2_" + mtca4u::dfmc_md22::SPI_WRITE_SUFFIX,
       mtca4u::dfmc_md22::MOTOR_REGISTER_PREFIX + "2_" + mtca4u::dfmc_md22::SPI_SYNC_SUFFIX);
+
+  _batchDummyBackend = boost::dynamic_pointer_cast<mtca4u::DFMC_MD22Dummy>(
+      ChimeraTK::BackendFactory::getInstance().createBackend(DFMC_BATCH_SPI_ALIAS));
+  _batchDevice = boost::make_shared<ChimeraTK::Device>();
+  _batchDevice->open(DFMC_BATCH_SPI_ALIAS);
+}
+
+boost::shared_ptr<mtca4u::SPIviaPCIe> SPIviaPCIeTestFixture::createBatchSPIviaPCIe() {
+  return boost::make_shared<mtca4u::SPIviaPCIe>(_batchDevice, MODULE_NAME_0,
+      mtca4u::dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING, mtca4u::dfmc_md22::CONTROLER_SPI_SYNC_ADDRESS_STRING,
+      mtca4u::dfmc_md22::CONTROLER_SPI_READBACK_ADDRESS_STRING, mtca4u::dfmc_md22::CONTROLER_SPI_BATCH_ADDRESS_STRING,
+      mtca4u::dfmc_md22::CONTROLER_SPI_BATCH_SIZE_ADDRESS_STRING);
 }
 
 BOOST_FIXTURE_TEST_CASE(TestRead, SPIviaPCIeTestFixture) {
@@ -124,3 +148,688 @@ BOOST_FIXTURE_TEST_CASE(TestGetSetWaitingTime, SPIviaPCIeTestFixture) {
   _writeSPIviaPCIe->setSpiWaitingTime(2 * mtca4u::SPIviaPCIe::SPI_DEFAULT_WAITING_TIME);
   BOOST_CHECK(_writeSPIviaPCIe->getSpiWaitingTime() == 2 * mtca4u::SPIviaPCIe::SPI_DEFAULT_WAITING_TIME);
 }
+
+BOOST_FIXTURE_TEST_CASE(TestWriteBatch, SPIviaPCIeTestFixture) {
+  auto batchSPIviaPCIe = createBatchSPIviaPCIe();
+  BOOST_CHECK(batchSPIviaPCIe->hasBatchSupport());
+  BOOST_CHECK(!_readWriteSPIviaPCIe->hasBatchSupport());
+  // the batch registers are optional
+  auto withoutBatchRegisters = boost::make_shared<mtca4u::SPIviaPCIe>(_device, MODULE_NAME_0,
+      mtca4u::dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING, mtca4u::dfmc_md22::CONTROLER_SPI_SYNC_ADDRESS_STRING,
+      mtca4u::dfmc_md22::CONTROLER_SPI_READBACK_ADDRESS_STRING, mtca4u::dfmc_md22::CONTROLER_SPI_BATCH_ADDRESS_STRING,
+      mtca4u::dfmc_md22::CONTROLER_SPI_BATCH_SIZE_ADDRESS_STRING);
+  BOOST_CHECK(!withoutBatchRegisters->hasBatchSupport());
+
+  // More commands than fit into the batch register (32 words in the test map
+  // file), so two batches are needed. The cover datagram is written several
+  // times, the last value has to win.
+  std::vector<int32_t> spiCommands;
+  mtca4u::TMC429InputWord inputWord;
+  inputWord.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  inputWord.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  for(unsigned int i = 0; i < 40; ++i) {
+    inputWord.setDATA(0x100 + i);
+    spiCommands.push_back(int32_t(inputWord.getDataWord()));
+  }
+
+  mtca4u::TMC429InputWord readRequest;
+  readRequest.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  readRequest.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+
+  auto nHandshakesBefore = _batchDummyBackend->getControllerSpiHandshakeCount();
+  auto batchStart = std::chrono::steady_clock::now();
+  auto status = batchSPIviaPCIe->writeBatch(spiCommands);
+  auto batchDuration = std::chrono::steady_clock::now() - batchStart;
+  BOOST_CHECK(_batchDummyBackend->getControllerSpiHandshakeCount() - nHandshakesBefore == 2);
+  BOOST_REQUIRE(status.size() == spiCommands.size());
+  for(auto s : status) {
+    BOOST_CHECK(s == mtca4u::SPIviaPCIe::TransferStatus::OK);
+  }
+  BOOST_CHECK(mtca4u::TMC429OutputWord(_batchDummyBackend->readTMC429Register(readRequest.getDataWord())).getDATA() ==
+      0x100 + 39);
+
+  // the fallback without batch registers does one handshake per command
+  spiCommands.resize(20);
+  nHandshakesBefore = _dummyBackend->getControllerSpiHandshakeCount();
+  auto fallbackStart = std::chrono::steady_clock::now();
+  status = _readWriteSPIviaPCIe->writeBatch(spiCommands);
+  auto fallbackDuration = std::chrono::steady_clock::now() - fallbackStart;
+  BOOST_CHECK(_dummyBackend->getControllerSpiHandshakeCount() - nHandshakesBefore == 20);
+  for(auto s : status) {
+    BOOST_CHECK(s == mtca4u::SPIviaPCIe::TransferStatus::OK);
+  }
+  BOOST_CHECK(mtca4u::TMC429OutputWord(_dummyBackend->readTMC429Register(readRequest.getDataWord())).getDATA() ==
+      0x100 + 19);
+  BOOST_TEST_MESSAGE("40 words batched: "
+      << std::chrono::duration_cast<std::chrono::microseconds>(batchDuration).count()
+      << " us, 20 words single handshakes: "
+      << std::chrono::duration_cast<std::chrono::microseconds>(fallbackDuration).count() << " us");
+
+  // Error cases. Both paths stop at the first failed command. Up to two timeouts
+  // are caught via retry.
+  for(auto& [spi, dummyBackend] : {std::make_pair(batchSPIviaPCIe, _batchDummyBackend),
+          std::make_pair(_readWriteSPIviaPCIe, _dummyBackend)}) {
+    dummyBackend->causeSpiTimeouts(true, 2);
+    status = spi->writeBatch(spiCommands);
+    BOOST_CHECK(status.front() == mtca4u::SPIviaPCIe::TransferStatus::OK);
+    BOOST_CHECK(status.back() == mtca4u::SPIviaPCIe::TransferStatus::OK);
+
+    dummyBackend->causeSpiTimeouts(true);
+    status = spi->writeBatch(spiCommands);
+    BOOST_CHECK(status.front() == mtca4u::SPIviaPCIe::TransferStatus::TIMEOUT);
+    BOOST_CHECK(status.back() == mtca4u::SPIviaPCIe::TransferStatus::NOT_EXECUTED);
+    dummyBackend->causeSpiTimeouts(false);
+
+    dummyBackend->causeSpiErrors(true);
+    status = spi->writeBatch(spiCommands);
+    BOOST_CHECK(status.front() == mtca4u::SPIviaPCIe::TransferStatus::ERROR);
+    BOOST_CHECK(status.back() == mtca4u::SPIviaPCIe::TransferStatus::NOT_EXECUTED);
+    dummyBackend->causeSpiErrors(false);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestWriteBatchPartiallyExecuted, SPIviaPCIeTestFixture) {
+  auto batchSPIviaPCIe = createBatchSPIviaPCIe();
+
+  // Each command writes the target position of motor 0 with a new value, so the number of
+  // executions of the command can be read back from the dummy.
+  std::vector<int32_t> spiCommands;
+  mtca4u::TMC429InputWord inputWord;
+  inputWord.setSMDA(0);
+  inputWord.setIDX_JDX(mtca4u::tmc429::IDX_TARGET_POSITION);
+  for(unsigned int i = 0; i < 40; ++i) {
+    inputWord.setDATA(0x300 + i);
+    spiCommands.push_back(int32_t(inputWord.getDataWord()));
+  }
+  mtca4u::TMC429InputWord readRequest(inputWord);
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+  readRequest.setDATA(0);
+  using TransferStatus = mtca4u::SPIviaPCIe::TransferStatus;
+
+  // A handshake which times out after 10 of the 32 commands in the batch register is only resent
+  // from the 11th command on. The retry puts it to the start of the batch register.
+  std::vector<int32_t> oneBatch(spiCommands.begin(), spiCommands.begin() + 32);
+  auto nRetriesBefore = batchSPIviaPCIe->getTransactionCounters().nRetries;
+  _batchDummyBackend->interruptNextSpiBatch(10, true);
+  auto status = batchSPIviaPCIe->writeBatch(oneBatch);
+  BOOST_CHECK_EQUAL(batchSPIviaPCIe->getTransactionCounters().nRetries - nRetriesBefore, 1U);
+  for(auto s : status) {
+    BOOST_CHECK(s == TransferStatus::OK);
+  }
+  auto batchRegister = _batchDevice->getOneDRegisterAccessor<int32_t>(
+      MODULE_NAME_0 / mtca4u::dfmc_md22::CONTROLER_SPI_BATCH_ADDRESS_STRING);
+  batchRegister.read();
+  BOOST_CHECK_EQUAL(batchRegister[0], oneBatch[10]);
+  BOOST_CHECK_EQUAL(batchRegister[21], oneBatch[31]);
+  BOOST_CHECK_EQUAL(
+      mtca4u::TMC429OutputWord(_batchDummyBackend->readTMC429Register(readRequest.getDataWord())).getDATA(),
+      0x300 + 31);
+
+  // An error is reported on the command which has failed, not on the first one of the handshake
+  for(unsigned int nExecuted : {0U, 5U, 31U}) {
+    _batchDummyBackend->interruptNextSpiBatch(nExecuted, false);
+    status = batchSPIviaPCIe->writeBatch(spiCommands);
+    for(size_t i = 0; i < status.size(); ++i) {
+      auto expectedStatus = i < nExecuted ? TransferStatus::OK :
+          (i == nExecuted ? TransferStatus::ERROR : TransferStatus::NOT_EXECUTED);
+      BOOST_CHECK_MESSAGE(status[i] == expectedStatus, "command " << i << " after " << nExecuted << " executed");
+    }
+    BOOST_CHECK_EQUAL(
+        mtca4u::TMC429OutputWord(_batchDummyBackend->readTMC429Register(readRequest.getDataWord())).getDATA(),
+        nExecuted > 0 ? 0x300 + nExecuted - 1 : 0x300 + 31);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(TestWaitStrategies, SPIviaPCIeTestFixture) {
+  BOOST_CHECK(_readWriteSPIviaPCIe->getWaitStrategy() == mtca4u::SPIviaPCIe::WaitStrategy::SLEEP);
+  _readWriteSPIviaPCIe->resetLatencyStatistics();
+  BOOST_CHECK(_readWriteSPIviaPCIe->getLatencyStatistics().nHandshakes == 0);
+
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+
+  // the dummy needs at least the controller spi delay for each transfer
+  _dummyBackend->setControllerSpiDelay(100);
+  for(auto waitStrategy : {mtca4u::SPIviaPCIe::WaitStrategy::SLEEP, mtca4u::SPIviaPCIe::WaitStrategy::SPIN,
+          mtca4u::SPIviaPCIe::WaitStrategy::SPIN_THEN_YIELD}) {
+    _readWriteSPIviaPCIe->setWaitStrategy(waitStrategy);
+    BOOST_CHECK(_readWriteSPIviaPCIe->getWaitStrategy() == waitStrategy);
+
+    for(unsigned int i = 0; i < 10; ++i) {
+      coverDatagram.setDATA(i);
+      _readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord()));
+    }
+    // data is transferred with all strategies
+    mtca4u::TMC429InputWord readRequest(coverDatagram.getDataWord());
+    readRequest.setRW(mtca4u::tmc429::RW_READ);
+    BOOST_CHECK(mtca4u::TMC429OutputWord(_dummyBackend->readTMC429Register(readRequest.getDataWord())).getDATA() == 9);
+
+    // an spi timeout is still detected
+    _dummyBackend->causeSpiTimeouts(true);
+    BOOST_CHECK_THROW(_readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord())), ChimeraTK::runtime_error);
+    _dummyBackend->causeSpiTimeouts(false);
+  }
+  _dummyBackend->setControllerSpiDelay(mtca4u::tmc429::DEFAULT_DUMMY_SPI_DELAY);
+
+  // timeouts do not enter the statistics
+  auto statistics = _readWriteSPIviaPCIe->getLatencyStatistics();
+  BOOST_CHECK(statistics.nHandshakes == 30);
+  BOOST_CHECK(statistics.minimum >= std::chrono::microseconds(100));
+  BOOST_CHECK(statistics.minimum <= statistics.average);
+  BOOST_CHECK(statistics.average <= statistics.maximum);
+  BOOST_CHECK(statistics.last >= statistics.minimum);
+  BOOST_CHECK(statistics.last <= statistics.maximum);
+
+  _readWriteSPIviaPCIe->resetLatencyStatistics();
+  BOOST_CHECK(_readWriteSPIviaPCIe->getLatencyStatistics().nHandshakes == 0);
+  BOOST_CHECK(_readWriteSPIviaPCIe->getLatencyStatistics().average == std::chrono::nanoseconds(0));
+
+  // Sleeping adapts to the measured latency. Without a measurement the sync register is checked after each spi
+  // waiting time. With an average latency below the spi waiting time it is checked once more, after the average.
+  // The measured latency depends on the load of the machine, so the expectation is derived from it.
+  _readWriteSPIviaPCIe->setWaitStrategy(mtca4u::SPIviaPCIe::WaitStrategy::SLEEP);
+  auto spiWaitingTime = _readWriteSPIviaPCIe->getSpiWaitingTime();
+  _readWriteSPIviaPCIe->setSpiWaitingTime(10000);
+  for(bool isMeasured : {false, true}) {
+    bool isCheckedEarly =
+        isMeasured && _readWriteSPIviaPCIe->getLatencyStatistics().average < std::chrono::microseconds(10000);
+    _readWriteSPIviaPCIe->resetTransactionCounters();
+    _dummyBackend->causeSpiTimeouts(true);
+    BOOST_CHECK_THROW(_readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord())), ChimeraTK::runtime_error);
+    _dummyBackend->causeSpiTimeouts(false);
+    // the write is tried three times
+    BOOST_CHECK_EQUAL(_readWriteSPIviaPCIe->getTransactionCounters().nPollIterations, isCheckedEarly ? 33U : 30U);
+
+    _readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord()));
+  }
+  _readWriteSPIviaPCIe->setSpiWaitingTime(spiWaitingTime);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTransactionCounters, SPIviaPCIeTestFixture) {
+  using mtca4u::SpiTransactionCounters;
+  BOOST_CHECK_EQUAL(SpiTransactionCounters::getBin(std::chrono::nanoseconds(999)), 0U);
+  BOOST_CHECK_EQUAL(SpiTransactionCounters::getBin(std::chrono::microseconds(1)), 1U);
+  BOOST_CHECK_EQUAL(SpiTransactionCounters::getBin(std::chrono::microseconds(3)), 2U);
+  BOOST_CHECK_EQUAL(SpiTransactionCounters::getBin(std::chrono::microseconds(4)), 3U);
+  BOOST_CHECK_EQUAL(SpiTransactionCounters::getBin(std::chrono::hours(1)), SpiTransactionCounters::N_LATENCY_BINS - 1);
+  BOOST_CHECK(SpiTransactionCounters::getBinUpperLimit(3) == std::chrono::microseconds(8));
+
+  _readWriteSPIviaPCIe->resetTransactionCounters();
+  auto counters = _readWriteSPIviaPCIe->getTransactionCounters();
+  BOOST_CHECK_EQUAL(counters.nTransactions, 0U);
+  BOOST_CHECK(counters.getLatencyPercentile(0.5) == std::chrono::microseconds(0));
+
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  _dummyBackend->setControllerSpiDelay(100);
+  for(unsigned int i = 0; i < 5; ++i) {
+    coverDatagram.setDATA(i);
+    _readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord()));
+  }
+  counters = _readWriteSPIviaPCIe->getTransactionCounters();
+  BOOST_CHECK_EQUAL(counters.nTransactions, 5U);
+  BOOST_CHECK_EQUAL(counters.nRetries, 0U);
+  BOOST_CHECK_EQUAL(counters.nTimeouts, 0U);
+  BOOST_CHECK_EQUAL(counters.nErrors, 0U);
+  uint64_t nCompleted = 0;
+  for(auto n : counters.latencyHistogram) {
+    nCompleted += n;
+  }
+  BOOST_CHECK_EQUAL(nCompleted, 5U);
+  // the dummy needs at least 100 us per transfer
+  BOOST_CHECK(counters.getLatencyPercentile(0.) > std::chrono::microseconds(100));
+  BOOST_CHECK(counters.getLatencyPercentile(0.5) <= counters.getLatencyPercentile(1.));
+
+  // two timeouts are retried, each of them polls the synchronisation register 10 times
+  _readWriteSPIviaPCIe->resetTransactionCounters();
+  _dummyBackend->causeSpiTimeouts(true, 2);
+  _readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord()));
+  _dummyBackend->causeSpiTimeouts(false);
+  counters = _readWriteSPIviaPCIe->getTransactionCounters();
+  BOOST_CHECK_EQUAL(counters.nTransactions, 3U);
+  BOOST_CHECK_EQUAL(counters.nRetries, 2U);
+  BOOST_CHECK_EQUAL(counters.nTimeouts, 2U);
+  BOOST_CHECK(counters.nPollIterations >= 20U);
+
+  _dummyBackend->causeSpiErrors(true);
+  BOOST_CHECK_THROW(_readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord())), ChimeraTK::runtime_error);
+  _dummyBackend->causeSpiErrors(false);
+  _dummyBackend->setControllerSpiDelay(mtca4u::tmc429::DEFAULT_DUMMY_SPI_DELAY);
+  counters = _readWriteSPIviaPCIe->getTransactionCounters();
+  BOOST_CHECK_EQUAL(counters.nTransactions, 4U);
+  BOOST_CHECK_EQUAL(counters.nErrors, 1U);
+
+  _readWriteSPIviaPCIe->resetTransactionCounters();
+  counters = _readWriteSPIviaPCIe->getTransactionCounters();
+  BOOST_CHECK_EQUAL(counters.nTransactions, 0U);
+  BOOST_CHECK_EQUAL(counters.nRetries, 0U);
+  BOOST_CHECK_EQUAL(counters.nTimeouts, 0U);
+  BOOST_CHECK_EQUAL(counters.nErrors, 0U);
+  BOOST_CHECK_EQUAL(counters.nPollIterations, 0U);
+  BOOST_CHECK(counters.getLatencyPercentile(1.) == std::chrono::microseconds(0));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestInterprocessArbitration, SPIviaPCIeTestFixture) {
+  mtca4u::SpiArbitration::remove(DFMC_ALIAS, "MD22_0");
+  auto arbitration = boost::make_shared<mtca4u::SpiArbitration>(DFMC_ALIAS, "MD22_0");
+
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setADDRESS(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  coverDatagram.setDATA(0x123);
+
+  // without arbitration nothing is counted
+  _readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord()));
+  BOOST_CHECK_EQUAL(_readWriteSPIviaPCIe->getArbitrationStatistics().nLocks, 0);
+
+  _readWriteSPIviaPCIe->setInterprocessArbitration(arbitration);
+  _readWriteSPIviaPCIe->write(int32_t(coverDatagram.getDataWord()));
+  coverDatagram.setRW(mtca4u::tmc429::RW_READ);
+  BOOST_CHECK_EQUAL(
+      mtca4u::TMC429OutputWord(_readWriteSPIviaPCIe->read(int32_t(coverDatagram.getDataWord()))).getDATA(), 0x123);
+  auto statistics = _readWriteSPIviaPCIe->getArbitrationStatistics();
+  BOOST_CHECK_EQUAL(statistics.nLocks, 2);
+  BOOST_CHECK_EQUAL(statistics.nContended, 0);
+
+  mtca4u::SpiArbitration otherProcess(DFMC_ALIAS, "MD22_0");
+  auto& otherMutex = otherProcess.getMutex(mtca4u::dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING);
+  // Another process (simulated by a second arbitration instance) holds the
+  // mutex, the transfer has to wait until it is released. A robust mutex can
+  // only be unlocked by the owning thread.
+  std::promise<void> locked;
+  std::thread otherThread([&] {
+    std::lock_guard<mtca4u::RobustMutex> lock(otherMutex);
+    locked.set_value();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  });
+  locked.get_future().wait();
+  auto transferStart = std::chrono::steady_clock::now();
+  _readWriteSPIviaPCIe->read(int32_t(coverDatagram.getDataWord()));
+  auto transferTime = std::chrono::steady_clock::now() - transferStart;
+  otherThread.join();
+
+  statistics = _readWriteSPIviaPCIe->getArbitrationStatistics();
+  BOOST_CHECK_EQUAL(statistics.nLocks, 3);
+  BOOST_CHECK_EQUAL(statistics.nContended, 1);
+  BOOST_CHECK(statistics.waitingTime <= transferTime);
+  BOOST_CHECK(statistics.maximumWaitingTime == statistics.waitingTime);
+  BOOST_CHECK(statistics.waitingTime > std::chrono::nanoseconds(0));
+
+  _readWriteSPIviaPCIe->resetArbitrationStatistics();
+  BOOST_CHECK_EQUAL(_readWriteSPIviaPCIe->getArbitrationStatistics().nContended, 0);
+
+  // switch off again
+  _readWriteSPIviaPCIe->setInterprocessArbitration(boost::shared_ptr<mtca4u::SpiArbitration>());
+  otherMutex.lock();
+  _readWriteSPIviaPCIe->read(int32_t(coverDatagram.getDataWord()));
+  otherMutex.unlock();
+  BOOST_CHECK_EQUAL(_readWriteSPIviaPCIe->getArbitrationStatistics().nLocks, 0);
+
+  mtca4u::SpiArbitration::remove(DFMC_ALIAS, "MD22_0");
+}
+
+BOOST_FIXTURE_TEST_CASE(TestEmergencyStopDuringBatch, SPIviaPCIeTestFixture) {
+  // Without the transfer thread
+  auto batchSPIviaPCIe = createBatchSPIviaPCIe();
+
+  // A long batch of eight batch registers (32 words in the test map file) writes the cover datagram
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  std::vector<int32_t> spiCommands;
+  for(unsigned int i = 0; i < 8 * 32; ++i) {
+    coverDatagram.setDATA(0x200 + i);
+    spiCommands.push_back(int32_t(coverDatagram.getDataWord()));
+  }
+  mtca4u::TMC429InputWord stopWord;
+  stopWord.setSMDA(1);
+  stopWord.setIDX_JDX(mtca4u::tmc429::IDX_TARGET_POSITION);
+  stopWord.setDATA(0x888);
+
+  std::vector<mtca4u::SPIviaPCIe::TransferStatus> status;
+  auto batchStart = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration batchDuration{};
+  std::thread batchClient([&] {
+    status = batchSPIviaPCIe->writeBatch(spiCommands);
+    batchDuration = std::chrono::steady_clock::now() - batchStart;
+  });
+  while(batchSPIviaPCIe->getTransactionCounters().nTransactions == 0) {
+    std::this_thread::yield();
+  }
+  auto stopStart = std::chrono::steady_clock::now();
+  batchSPIviaPCIe->write(int32_t(stopWord.getDataWord()), mtca4u::SPIviaPCIe::Priority::EMERGENCY_STOP);
+  auto stopLatency = std::chrono::steady_clock::now() - stopStart;
+  auto nHandshakesAtStop = batchSPIviaPCIe->getTransactionCounters().nTransactions;
+  batchClient.join();
+
+  // The stop has waited for the handshake in progress, not for the whole batch. A little margin, the batch
+  // continues while the handshakes are counted.
+  BOOST_CHECK(nHandshakesAtStop <= 4);
+  BOOST_CHECK(stopLatency < batchDuration / 2);
+  BOOST_TEST_MESSAGE("Emergency stop latency during a batch: "
+      << std::chrono::duration_cast<std::chrono::microseconds>(stopLatency).count() << " us, batch duration "
+      << std::chrono::duration_cast<std::chrono::microseconds>(batchDuration).count() << " us");
+
+  BOOST_REQUIRE(status.size() == spiCommands.size());
+  for(auto s : status) {
+    BOOST_CHECK(s == mtca4u::SPIviaPCIe::TransferStatus::OK);
+  }
+  mtca4u::TMC429InputWord readRequest(coverDatagram);
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+  readRequest.setDATA(0);
+  BOOST_CHECK_EQUAL(mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(readRequest.getDataWord()))).getDATA(),
+      0x200 + 8 * 32 - 1);
+  readRequest = stopWord;
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+  readRequest.setDATA(0);
+  BOOST_CHECK_EQUAL(
+      mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(readRequest.getDataWord()))).getDATA(), 0x888);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTransferThread, SPIviaPCIeTestFixture) {
+  auto batchSPIviaPCIe = createBatchSPIviaPCIe();
+  BOOST_CHECK(!batchSPIviaPCIe->hasTransferThread());
+  batchSPIviaPCIe->enableTransferThread();
+  BOOST_CHECK(batchSPIviaPCIe->hasTransferThread());
+
+  // Each thread writes the target position of its own motor and reads it back.
+  // The owner thread must deliver each caller its own result.
+  size_t const nThreads = 3;
+  size_t const nIterations = 200;
+  std::vector<int> nInconsistent(nThreads, 0);
+  std::vector<std::thread> threads;
+  for(size_t t = 0; t < nThreads; ++t) {
+    threads.emplace_back([&, t] {
+      mtca4u::TMC429InputWord inputWord;
+      inputWord.setSMDA(static_cast<unsigned int>(t));
+      inputWord.setIDX_JDX(mtca4u::tmc429::IDX_TARGET_POSITION);
+      for(unsigned int i = 0; i < nIterations; ++i) {
+        inputWord.setRW(mtca4u::tmc429::RW_WRITE);
+        inputWord.setDATA(t * 0x1000 + i);
+        batchSPIviaPCIe->write(int32_t(inputWord.getDataWord()));
+        inputWord.setRW(mtca4u::tmc429::RW_READ);
+        inputWord.setDATA(0);
+        if(mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(inputWord.getDataWord()))).getDATA() !=
+            t * 0x1000 + i) {
+          ++nInconsistent[t];
+        }
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  for(size_t t = 0; t < nThreads; ++t) {
+    BOOST_CHECK_EQUAL(nInconsistent[t], 0);
+  }
+
+  // Writes of different threads which wait in the same queue share one batch handshake. Another process holds the
+  // SPI, so the transfer thread is blocked in the first request and the others are queued.
+  mtca4u::SpiArbitration::remove(DFMC_BATCH_SPI_ALIAS, "MD22_0");
+  auto arbitration = boost::make_shared<mtca4u::SpiArbitration>(DFMC_BATCH_SPI_ALIAS, "MD22_0");
+  batchSPIviaPCIe->setInterprocessArbitration(arbitration);
+  auto& otherMutex = arbitration->getMutex(mtca4u::dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING);
+  std::promise<void> locked, release;
+  std::thread otherProcess([&] {
+    std::lock_guard<mtca4u::RobustMutex> lock(otherMutex);
+    locked.set_value();
+    release.get_future().wait();
+  });
+  locked.get_future().wait();
+
+  auto targetPositionWord = [](unsigned int motor, unsigned int rw, unsigned int data) {
+    mtca4u::TMC429InputWord inputWord;
+    inputWord.setSMDA(motor);
+    inputWord.setIDX_JDX(mtca4u::tmc429::IDX_TARGET_POSITION);
+    inputWord.setRW(rw);
+    inputWord.setDATA(data);
+    return int32_t(inputWord.getDataWord());
+  };
+  threads.clear();
+  for(size_t t = 0; t <= nThreads; ++t) {
+    auto command = targetPositionWord(static_cast<unsigned int>(t % nThreads), mtca4u::tmc429::RW_WRITE, 0x5000 + t);
+    threads.emplace_back([&, command] { batchSPIviaPCIe->write(command); });
+    if(t == 0) {
+      // taken by the transfer thread, which is blocked
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    while(batchSPIviaPCIe->getPriorityStatistics(mtca4u::SPIviaPCIe::Priority::CONFIGURATION).queueDepth < t) {
+      std::this_thread::yield();
+    }
+  }
+  auto nHandshakesBefore = _batchDummyBackend->getControllerSpiHandshakeCount();
+  release.set_value();
+  otherProcess.join();
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_CHECK_EQUAL(_batchDummyBackend->getControllerSpiHandshakeCount() - nHandshakesBefore, 2U);
+  // the queued writes have been executed in order of submission, the last write to motor 0 wins
+  for(size_t t = 0; t < nThreads; ++t) {
+    auto readRequest = targetPositionWord(static_cast<unsigned int>(t), mtca4u::tmc429::RW_READ, 0);
+    BOOST_CHECK_EQUAL(mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(readRequest)).getDATA(),
+        0x5000 + (t == 0 ? nThreads : t));
+  }
+  batchSPIviaPCIe->setInterprocessArbitration(boost::shared_ptr<mtca4u::SpiArbitration>());
+  mtca4u::SpiArbitration::remove(DFMC_BATCH_SPI_ALIAS, "MD22_0");
+
+  // errors are reported to the caller
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  _batchDummyBackend->causeSpiErrors(true);
+  BOOST_CHECK_THROW(batchSPIviaPCIe->write(int32_t(coverDatagram.getDataWord())), ChimeraTK::runtime_error);
+  coverDatagram.setRW(mtca4u::tmc429::RW_READ);
+  BOOST_CHECK_THROW(batchSPIviaPCIe->read(int32_t(coverDatagram.getDataWord())), ChimeraTK::runtime_error);
+  _batchDummyBackend->causeSpiErrors(false);
+  BOOST_CHECK_NO_THROW(batchSPIviaPCIe->read(int32_t(coverDatagram.getDataWord())));
+
+  batchSPIviaPCIe->enableTransferThread(false);
+  BOOST_CHECK(!batchSPIviaPCIe->hasTransferThread());
+  BOOST_CHECK_NO_THROW(batchSPIviaPCIe->read(int32_t(coverDatagram.getDataWord())));
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTransferThreadBatch, SPIviaPCIeTestFixture) {
+  using Priority = mtca4u::SPIviaPCIe::Priority;
+  auto batchSPIviaPCIe = createBatchSPIviaPCIe();
+  batchSPIviaPCIe->enableTransferThread();
+
+  // A long batch of eight batch registers (32 words in the test map file) writes the cover datagram
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  std::vector<int32_t> spiCommands;
+  for(unsigned int i = 0; i < 8 * 32; ++i) {
+    coverDatagram.setDATA(0x100 + i);
+    spiCommands.push_back(int32_t(coverDatagram.getDataWord()));
+  }
+  mtca4u::TMC429InputWord stopWord;
+  stopWord.setSMDA(0);
+  stopWord.setIDX_JDX(mtca4u::tmc429::IDX_TARGET_POSITION);
+  stopWord.setDATA(0x777);
+
+  auto nHandshakesBefore = _batchDummyBackend->getControllerSpiHandshakeCount();
+  std::vector<mtca4u::SPIviaPCIe::TransferStatus> status;
+  std::thread batchClient([&] { status = batchSPIviaPCIe->writeBatch(spiCommands); });
+  while(batchSPIviaPCIe->getTransactionCounters().nTransactions == 0) {
+    std::this_thread::yield();
+  }
+  // The emergency stop is executed after the chunk which is running, not after the whole batch
+  batchSPIviaPCIe->write(int32_t(stopWord.getDataWord()), Priority::EMERGENCY_STOP);
+  auto nHandshakesAtStop = batchSPIviaPCIe->getTransactionCounters().nTransactions;
+  batchClient.join();
+  // a little margin, the batch continues while the handshakes are counted
+  BOOST_CHECK(nHandshakesAtStop <= 4);
+  BOOST_CHECK_EQUAL(_batchDummyBackend->getControllerSpiHandshakeCount() - nHandshakesBefore, 9U);
+  BOOST_CHECK(batchSPIviaPCIe->getPriorityStatistics(Priority::EMERGENCY_STOP).maximumLatency <
+      batchSPIviaPCIe->getPriorityStatistics(Priority::CONFIGURATION).maximumLatency);
+
+  BOOST_REQUIRE(status.size() == spiCommands.size());
+  for(auto s : status) {
+    BOOST_CHECK(s == mtca4u::SPIviaPCIe::TransferStatus::OK);
+  }
+  mtca4u::TMC429InputWord readRequest(coverDatagram);
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+  readRequest.setDATA(0);
+  BOOST_CHECK_EQUAL(mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(readRequest.getDataWord()))).getDATA(),
+      0x100 + 8 * 32 - 1);
+  readRequest = stopWord;
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+  readRequest.setDATA(0);
+  BOOST_CHECK_EQUAL(
+      mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(readRequest.getDataWord()))).getDATA(), 0x777);
+
+  // errors stop the batch like without the transfer thread
+  _batchDummyBackend->causeSpiErrors(true);
+  status = batchSPIviaPCIe->writeBatch(spiCommands);
+  _batchDummyBackend->causeSpiErrors(false);
+  BOOST_CHECK(status.front() == mtca4u::SPIviaPCIe::TransferStatus::ERROR);
+  BOOST_CHECK(status.back() == mtca4u::SPIviaPCIe::TransferStatus::NOT_EXECUTED);
+  BOOST_CHECK(batchSPIviaPCIe->writeBatch({}).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTransferThreadBatchOfHigherPriority, SPIviaPCIeTestFixture) {
+  using Priority = mtca4u::SPIviaPCIe::Priority;
+  auto batchSPIviaPCIe = createBatchSPIviaPCIe();
+  batchSPIviaPCIe->enableTransferThread();
+
+  // A long configuration batch of eight batch registers writes the cover datagram, a motion batch of two batch
+  // registers the target position of motor 0
+  mtca4u::TMC429InputWord inputWord;
+  inputWord.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  inputWord.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  std::vector<int32_t> configurationCommands;
+  for(unsigned int i = 0; i < 8 * 32; ++i) {
+    inputWord.setDATA(0x300 + i);
+    configurationCommands.push_back(int32_t(inputWord.getDataWord()));
+  }
+  inputWord.setSMDA(0);
+  inputWord.setIDX_JDX(mtca4u::tmc429::IDX_TARGET_POSITION);
+  std::vector<int32_t> motionCommands;
+  for(unsigned int i = 0; i < 2 * 32; ++i) {
+    inputWord.setDATA(0x400 + i);
+    motionCommands.push_back(int32_t(inputWord.getDataWord()));
+  }
+
+  auto nHandshakesBefore = _batchDummyBackend->getControllerSpiHandshakeCount();
+  std::vector<mtca4u::SPIviaPCIe::TransferStatus> configurationStatus;
+  std::thread configurationClient(
+      [&] { configurationStatus = batchSPIviaPCIe->writeBatch(configurationCommands, Priority::CONFIGURATION); });
+  while(batchSPIviaPCIe->getTransactionCounters().nTransactions == 0) {
+    std::this_thread::yield();
+  }
+  // The motion batch is submitted while the configuration batch is in progress. Both are completed.
+  auto motionStatus = batchSPIviaPCIe->writeBatch(motionCommands, Priority::MOTION);
+  configurationClient.join();
+  BOOST_CHECK_EQUAL(_batchDummyBackend->getControllerSpiHandshakeCount() - nHandshakesBefore, 10U);
+  BOOST_CHECK(batchSPIviaPCIe->getPriorityStatistics(Priority::MOTION).maximumLatency <
+      batchSPIviaPCIe->getPriorityStatistics(Priority::CONFIGURATION).maximumLatency);
+
+  BOOST_REQUIRE(configurationStatus.size() == configurationCommands.size());
+  for(auto s : configurationStatus) {
+    BOOST_CHECK(s == mtca4u::SPIviaPCIe::TransferStatus::OK);
+  }
+  BOOST_REQUIRE(motionStatus.size() == motionCommands.size());
+  for(auto s : motionStatus) {
+    BOOST_CHECK(s == mtca4u::SPIviaPCIe::TransferStatus::OK);
+  }
+  inputWord.setRW(mtca4u::tmc429::RW_READ);
+  inputWord.setDATA(0);
+  BOOST_CHECK_EQUAL(
+      mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(inputWord.getDataWord()))).getDATA(), 0x400 + 2 * 32 - 1);
+  inputWord.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  inputWord.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  BOOST_CHECK_EQUAL(
+      mtca4u::TMC429OutputWord(batchSPIviaPCIe->read(int32_t(inputWord.getDataWord()))).getDATA(), 0x300 + 8 * 32 - 1);
+
+  BOOST_CHECK_EQUAL(batchSPIviaPCIe->getPriorityStatistics(Priority::MOTION).queueDepth, 0);
+  BOOST_CHECK_EQUAL(batchSPIviaPCIe->getPriorityStatistics(Priority::CONFIGURATION).queueDepth, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(TestTransferThreadPriorities, SPIviaPCIeTestFixture) {
+  using Priority = mtca4u::SPIviaPCIe::Priority;
+  mtca4u::SpiArbitration::remove(DFMC_ALIAS, "MD22_0");
+  auto arbitration = boost::make_shared<mtca4u::SpiArbitration>(DFMC_ALIAS, "MD22_0");
+  auto spi = boost::make_shared<mtca4u::SPIviaPCIe>(_device, MODULE_NAME_0,
+      mtca4u::dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING, mtca4u::dfmc_md22::CONTROLER_SPI_SYNC_ADDRESS_STRING,
+      mtca4u::dfmc_md22::CONTROLER_SPI_READBACK_ADDRESS_STRING);
+  spi->setInterprocessArbitration(arbitration);
+  spi->enableTransferThread();
+
+  mtca4u::TMC429InputWord coverDatagram;
+  coverDatagram.setSMDA(mtca4u::tmc429::SMDA_COMMON);
+  coverDatagram.setIDX_JDX(mtca4u::tmc429::JDX_COVER_DATAGRAM);
+  auto coverDatagramWithData = [&](unsigned int data) {
+    coverDatagram.setDATA(data);
+    return int32_t(coverDatagram.getDataWord());
+  };
+
+  // Another process holds the SPI, so the transfer thread is blocked in the first
+  // request and all others have to wait in the queues.
+  auto& otherMutex = arbitration->getMutex(mtca4u::dfmc_md22::CONTROLER_SPI_WRITE_ADDRESS_STRING);
+  std::promise<void> locked, release;
+  std::thread otherProcess([&] {
+    std::lock_guard<mtca4u::RobustMutex> lock(otherMutex);
+    locked.set_value();
+    release.get_future().wait();
+  });
+  locked.get_future().wait();
+
+  std::vector<std::thread> clients;
+  auto startClient = [&](Priority priority, unsigned int data, size_t expectedQueueDepth) {
+    auto command = coverDatagramWithData(data);
+    clients.emplace_back([&, priority, command] { spi->write(command, priority); });
+    // wait until the request is queued, so the submission order is defined
+    while(spi->getPriorityStatistics(priority).queueDepth < expectedQueueDepth) {
+      std::this_thread::yield();
+    }
+  };
+  startClient(Priority::DIAGNOSTICS, 1, 0); // taken by the transfer thread, which is blocked
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  startClient(Priority::DIAGNOSTICS, 2, 1);
+  startClient(Priority::CONFIGURATION, 3, 1);
+  startClient(Priority::MOTION, 4, 1);
+  startClient(Priority::EMERGENCY_STOP, 5, 1);
+  BOOST_CHECK_EQUAL(spi->getPriorityStatistics(Priority::DIAGNOSTICS).maximumQueueDepth, 1);
+
+  release.set_value();
+  otherProcess.join();
+  for(auto& client : clients) {
+    client.join();
+  }
+
+  // The waiting requests are executed by priority, in the opposite order of
+  // submission. So the latencies increase with decreasing priority, and the
+  // diagnostics request, which was submitted first, has been executed last.
+  auto latency = [&](Priority priority) { return spi->getPriorityStatistics(priority).maximumLatency; };
+  BOOST_CHECK(latency(Priority::EMERGENCY_STOP) < latency(Priority::MOTION));
+  BOOST_CHECK(latency(Priority::MOTION) < latency(Priority::CONFIGURATION));
+  BOOST_CHECK(latency(Priority::CONFIGURATION) < latency(Priority::DIAGNOSTICS));
+  mtca4u::TMC429InputWord readRequest(coverDatagram);
+  readRequest.setRW(mtca4u::tmc429::RW_READ);
+  readRequest.setDATA(0);
+  BOOST_CHECK_EQUAL(mtca4u::TMC429OutputWord(spi->read(int32_t(readRequest.getDataWord()))).getDATA(), 2);
+
+  auto statistics = spi->getPriorityStatistics(Priority::EMERGENCY_STOP);
+  BOOST_CHECK_EQUAL(statistics.nRequests, 1);
+  BOOST_CHECK_EQUAL(statistics.queueDepth, 0);
+  BOOST_CHECK_EQUAL(statistics.maximumQueueDepth, 1);
+  BOOST_CHECK(statistics.averageLatency > std::chrono::nanoseconds(0));
+  BOOST_CHECK(statistics.maximumLatency == statistics.averageLatency);
+  // including the read above
+  BOOST_CHECK_EQUAL(spi->getPriorityStatistics(Priority::DIAGNOSTICS).nRequests, 3);
+
+  spi->resetPriorityStatistics();
+  BOOST_CHECK_EQUAL(spi->getPriorityStatistics(Priority::DIAGNOSTICS).nRequests, 0);
+  BOOST_CHECK_EQUAL(spi->getPriorityStatistics(Priority::DIAGNOSTICS).maximumQueueDepth, 0);
+
+  // without the transfer thread there are no statistics
+  spi->enableTransferThread(false);
+  spi->write(coverDatagramWithData(6), Priority::MOTION);
+  BOOST_CHECK_EQUAL(spi->getPriorityStatistics(Priority::MOTION).nRequests, 0);
+  mtca4u::SpiArbitration::remove(DFMC_ALIAS, "MD22_0");
+}
@@ -0,0 +1,92 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SpiArbitrationTest
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test_framework;
+
+#include "impl/SpiArbitration.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace mtca4u;
+
+static const std::string arbitrationAlias("SpiArbitrationTest");
+static const std::string arbitrationModule("MD22_0");
+
+struct SpiArbitrationFixture {
+  SpiArbitrationFixture() { SpiArbitration::remove(arbitrationAlias, arbitrationModule); }
+  ~SpiArbitrationFixture() { SpiArbitration::remove(arbitrationAlias, arbitrationModule); }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SpiArbitrationTestSuite, SpiArbitrationFixture)
+
+BOOST_AUTO_TEST_CASE(testSharedMemoryName) {
+  BOOST_CHECK_EQUAL(
+      SpiArbitration::sharedMemoryName("DFMC_MD22", "MD22_0"), "MotorDriverCardSpi_v1_DFMC_MD22_MD22_0");
+}
+
+BOOST_AUTO_TEST_CASE(testGetMutex) {
+  SpiArbitration arbitration1(arbitrationAlias, arbitrationModule);
+  SpiArbitration arbitration2(arbitrationAlias, arbitrationModule);
+
+  // the same SPI gets the same mutex in all instances, different SPIs get different ones
+  auto& mutex = arbitration1.getMutex("CTRL_SPI_CTRL");
+  BOOST_CHECK(&mutex == &arbitration1.getMutex("CTRL_SPI_CTRL"));
+  BOOST_CHECK(&mutex != &arbitration1.getMutex("MOTOR_0_SPI_CTRL"));
+
+  std::lock_guard<RobustMutex> lock(mutex);
+  BOOST_CHECK(!arbitration2.getMutex("CTRL_SPI_CTRL").try_lock());
+  BOOST_CHECK(arbitration2.getMutex("MOTOR_0_SPI_CTRL").try_lock());
+  arbitration2.getMutex("MOTOR_0_SPI_CTRL").unlock();
+}
+
+BOOST_AUTO_TEST_CASE(testMutualExclusion) {
+  SpiArbitration arbitration(arbitrationAlias, arbitrationModule);
+
+  // not atomic on purpose, the mutex has to protect it
+  size_t counter = 0;
+  std::vector<std::thread> threads;
+  for(size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      SpiArbitration threadArbitration(arbitrationAlias, arbitrationModule);
+      auto& mutex = threadArbitration.getMutex("CTRL_SPI_CTRL");
+      for(size_t i = 0; i < 10000; ++i) {
+        std::lock_guard<RobustMutex> lock(mutex);
+        ++counter;
+      }
+    });
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_CHECK_EQUAL(counter, 40000);
+}
+
+BOOST_AUTO_TEST_CASE(testOwnerDied) {
+  SpiArbitration arbitration(arbitrationAlias, arbitrationModule);
+  auto& mutex = arbitration.getMutex("CTRL_SPI_CTRL");
+
+  // a process which dies while holding the mutex must not block the others
+  pid_t child = fork();
+  BOOST_REQUIRE(child >= 0);
+  if(child == 0) {
+    SpiArbitration childArbitration(arbitrationAlias, arbitrationModule);
+    childArbitration.getMutex("CTRL_SPI_CTRL").lock();
+    _exit(0);
+  }
+  int status;
+  BOOST_REQUIRE(waitpid(child, &status, 0) == child);
+
+  BOOST_CHECK(mutex.try_lock());
+  mutex.unlock();
+  // the mutex is consistent again and works as usual
+  mutex.lock();
+  BOOST_CHECK(!SpiArbitration(arbitrationAlias, arbitrationModule).getMutex("CTRL_SPI_CTRL").try_lock());
+  mutex.unlock();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,106 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TrajectoryStreamerTest
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test_framework;
+
+#include "MotorControlerDummy.h"
+#include "MotorControlerExpert.h"
+#include "MotorDriverCard.h"
+#include "MotorDriverCardFactory.h"
+#include "testConfigConstants.h"
+#include "TMC429Constants.h"
+#include "TrajectoryStreamer.h"
+
+#include <ChimeraTK/Exception.h>
+
+#include <boost/make_shared.hpp>
+
+#include <thread>
+
+using namespace mtca4u;
+using namespace std::chrono_literals;
+
+BOOST_AUTO_TEST_SUITE(TrajectoryStreamerTestSuite)
+
+BOOST_AUTO_TEST_CASE(testInvalidArguments) {
+  auto motorControlerDummy = boost::make_shared<MotorControlerDummy>(0);
+
+  BOOST_CHECK_THROW(TrajectoryStreamer{boost::shared_ptr<MotorControler>()}, ChimeraTK::logic_error);
+  BOOST_CHECK_THROW(
+      (TrajectoryStreamer{motorControlerDummy, TrajectoryStreamer::Mode::POSITION, 0us}), ChimeraTK::logic_error);
+  // the dummy cannot set the ramp mode
+  BOOST_CHECK_THROW(
+      (TrajectoryStreamer{motorControlerDummy, TrajectoryStreamer::Mode::VELOCITY}), ChimeraTK::logic_error);
+
+  TrajectoryStreamer streamer(motorControlerDummy);
+  BOOST_CHECK_THROW(streamer.start({}), ChimeraTK::logic_error);
+  BOOST_CHECK_THROW((streamer.start({{-1ms, 0, 0}, {1ms, 10, 0}})), ChimeraTK::logic_error);
+  BOOST_CHECK_THROW((streamer.start({{0ms, 0, 0}, {2ms, 10, 0}, {2ms, 20, 0}})), ChimeraTK::logic_error);
+  BOOST_CHECK(!streamer.isRunning());
+}
+
+BOOST_AUTO_TEST_CASE(testPositionMode) {
+  auto motorControlerDummy = boost::make_shared<MotorControlerDummy>(0);
+  TrajectoryStreamer streamer(motorControlerDummy, TrajectoryStreamer::Mode::POSITION, 2ms);
+
+  streamer.start({{0ms, 0, 0}, {50ms, 500, 0}, {100ms, 1000, 0}});
+  BOOST_CHECK(streamer.isRunning());
+  BOOST_CHECK_THROW((streamer.start({{0ms, 0, 0}})), ChimeraTK::logic_error);
+  streamer.waitUntilFinished();
+  BOOST_CHECK(!streamer.isRunning());
+
+  BOOST_CHECK_EQUAL(motorControlerDummy->getTargetPosition(), 1000);
+  // The dummy does not move by itself, so the tracking error is the full distance at the end
+  auto statistics = streamer.getStatistics();
+  BOOST_CHECK_EQUAL(statistics.lastTrackingError, 1000);
+  BOOST_CHECK_EQUAL(statistics.maximumTrackingError, 1000);
+  BOOST_CHECK(statistics.rmsTrackingError > 0 && statistics.rmsTrackingError < 1000);
+  BOOST_CHECK(statistics.nUpdates > 1 && statistics.nUpdates <= 52);
+
+  // Stopping before the end sets the target to the actual position
+  streamer.start({{0ms, 0, 0}, {10s, 100000, 0}});
+  std::this_thread::sleep_for(20ms);
+  BOOST_CHECK(streamer.isRunning());
+  streamer.stop();
+  BOOST_CHECK(!streamer.isRunning());
+  BOOST_CHECK_EQUAL(motorControlerDummy->getTargetPosition(), motorControlerDummy->getActualPosition());
+  BOOST_CHECK_NO_THROW(streamer.waitUntilFinished());
+}
+
+BOOST_AUTO_TEST_CASE(testVelocityModeTiming) {
+  MotorDriverCardFactory::setDeviceaccessDMapFilePath("dummies.dmap");
+  auto motorDriverCard =
+      MotorDriverCardFactory::instance().createMotorDriverCard(DFMC_ALIAS, MODULE_NAME_0, CONFIG_FILE);
+  auto motorControler = boost::dynamic_pointer_cast<MotorControlerExpert>(motorDriverCard->getMotorControler(0));
+  BOOST_REQUIRE(motorControler);
+  auto originalRampMode = motorControler->getReferenceConfigAndRampModeData().getRampMode();
+  BOOST_REQUIRE(originalRampMode != tmc429::RAMP_MODE_VELOCITY);
+
+  auto const updatePeriod = 2ms;
+  auto const duration = 300ms;
+  TrajectoryStreamer streamer(motorControler, TrajectoryStreamer::Mode::VELOCITY, updatePeriod);
+  streamer.setPositionGain(0.01);
+  streamer.start({{0ms, 0, 0}, {100ms, 1000, 200}, {200ms, 3000, 200}, {duration, 4000, 0}});
+
+  std::this_thread::sleep_for(50ms);
+  BOOST_CHECK(motorControler->getReferenceConfigAndRampModeData().getRampMode() == tmc429::RAMP_MODE_VELOCITY);
+  streamer.waitUntilFinished();
+
+  // the ramp generator takes over and moves to the end of the trajectory
+  BOOST_CHECK(motorControler->getReferenceConfigAndRampModeData().getRampMode() == originalRampMode);
+  BOOST_CHECK_EQUAL(motorControler->getTargetPosition(), 4000);
+
+  // The updates must follow the fixed period. The limits are generous because the test
+  // might run on a loaded machine, where the thread is not scheduled in time.
+  auto statistics = streamer.getStatistics();
+  size_t nExpectedUpdates = duration / updatePeriod + 1;
+  BOOST_CHECK_MESSAGE(statistics.nUpdates > nExpectedUpdates / 2 && statistics.nUpdates <= nExpectedUpdates + 1,
+      "nUpdates " << statistics.nUpdates << ", expected " << nExpectedUpdates);
+  BOOST_CHECK_MESSAGE(statistics.averageLateness < updatePeriod,
+      "average lateness " << statistics.averageLateness.count() << " us");
+  BOOST_CHECK_MESSAGE(statistics.maximumLateness < 50ms,
+      "maximum lateness " << statistics.maximumLateness.count() << " us");
+  BOOST_CHECK_EQUAL(statistics.lastTrackingError, 4000 - motorControler->getActualPosition());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,210 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MotionGroupTest
+
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+using namespace boost::unit_test_framework;
+
+#include "BasicStepperMotor.h"
+#include "MotionGroup.h"
+#include "MotionPoller.h"
+#include "MotorControlerDummy.h"
+#include "MotorDriverCard.h"
+#include "MotorDriverCardFactory.h"
+#include "StepperMotor.h"
+#include "testConfigConstants.h"
+
+#include <ChimeraTK/Exception.h>
+
+static const std::string stepperMotorDeviceConfigFile("VT21-MotorDriverCardConfig.xml");
+// In dummy mode, each module name gives a separate card
+static const std::vector<std::string> moduleNames{"MD22_0", "MD22_1"};
+
+using namespace ChimeraTK::MotorDriver;
+
+// Motors 0 and 1 on the first card, motor 0 on the second card
+class MotionGroupFixture {
+ public:
+  MotionGroupFixture();
+  bool waitForState(StepperMotor& motor, const std::string& stateName);
+
+ protected:
+  std::vector<boost::shared_ptr<mtca4u::MotorControlerDummy>> _motorControlerDummies;
+  std::vector<std::shared_ptr<StepperMotor>> _motors;
+};
+
+MotionGroupFixture::MotionGroupFixture() {
+  mtca4u::MotorDriverCardFactory::instance().setDummyMode();
+
+  for(auto [card, id] : std::vector<std::pair<size_t, unsigned int>>{{0, 0}, {0, 1}, {1, 0}}) {
+    auto motorDriverCard = mtca4u::MotorDriverCardFactory::instance().createMotorDriverCard(
+        DUMMY_DEVICE_FILE_NAME, moduleNames[card], stepperMotorDeviceConfigFile);
+    _motorControlerDummies.push_back(
+        boost::dynamic_pointer_cast<mtca4u::MotorControlerDummy>(motorDriverCard->getMotorControler(id)));
+    _motorControlerDummies.back()->setPositiveReferenceSwitchEnabled(false);
+    _motorControlerDummies.back()->setNegativeReferenceSwitchEnabled(false);
+
+    StepperMotorParameters parameters;
+    parameters.deviceName = DUMMY_DEVICE_FILE_NAME;
+    parameters.moduleName = moduleNames[card];
+    parameters.configFileName = stepperMotorDeviceConfigFile;
+    parameters.driverId = id;
+    _motors.push_back(std::make_shared<BasicStepperMotor>(parameters));
+    (void)_motors.back()->setActualPositionInSteps(0);
+    _motors.back()->setEnabled(true);
+    _motors.back()->waitForIdle();
+  }
+}
+
+bool MotionGroupFixture::waitForState(StepperMotor& motor, const std::string& stateName) {
+  for(unsigned int i = 0; i < 1000; ++i) {
+    if(motor.getState() == stateName) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+BOOST_FIXTURE_TEST_SUITE(MotionGroupTestSuite, MotionGroupFixture)
+
+BOOST_AUTO_TEST_CASE(testConstruction) {
+  BOOST_CHECK_THROW(MotionGroup({}), ChimeraTK::logic_error);
+  BOOST_CHECK_THROW(MotionGroup({_motors[0], _motors[2], _motors[0]}), ChimeraTK::logic_error);
+
+  MotionGroup group(_motors);
+  BOOST_CHECK_EQUAL(group.size(), 3U);
+  BOOST_CHECK_EQUAL(group.getNumberOfCards(), 2U);
+  BOOST_CHECK(group.isSystemIdle());
+}
+
+BOOST_AUTO_TEST_CASE(testInvalidTargets) {
+  MotionGroup group(_motors);
+  BOOST_CHECK(group.moveToInSteps({100, 200}) == ExitStatus::ERR_INVALID_PARAMETER);
+
+  // An invalid target on the second card prevents the move of the first card
+  (void)_motors[2]->setMaxPositionLimitInSteps(1000);
+  (void)_motors[2]->setSoftwareLimitsEnabled(true);
+  auto future = group.moveToAsyncInSteps({100, 200, 2000});
+  BOOST_REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  auto result = future.get();
+  BOOST_REQUIRE_EQUAL(result.moveResults.size(), 3U);
+  for(auto const& moveResult : result.moveResults) {
+    BOOST_CHECK(moveResult.status == ExitStatus::ERR_INVALID_PARAMETER);
+  }
+  BOOST_CHECK(group.isSystemIdle());
+  BOOST_CHECK_EQUAL(_motors[0]->getState(), "idle");
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getTargetPosition(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testMoveOnTwoCards) {
+  MotionGroup group(_motors);
+  double originalSpeedLimit = _motorControlerDummies[2]->getUserSpeedLimit();
+
+  std::atomic<int> nCallbacks{0};
+  auto future = group.moveToAsyncInSteps({100, -200, 400}, [&](const MotionGroupResult&) { ++nCallbacks; });
+  for(auto const& motor : _motors) {
+    BOOST_CHECK(waitForState(*motor, "moving"));
+  }
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getTargetPosition(), 100);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[1]->getTargetPosition(), -200);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[2]->getTargetPosition(), 400);
+  BOOST_CHECK(group.moveToInSteps({0, 0, 0}) == ExitStatus::ERR_SYSTEM_IN_ACTION);
+
+  // The longest move on the second card determines the speed on the first card
+  BOOST_CHECK_EQUAL(_motorControlerDummies[2]->getUserSpeedLimit(), originalSpeedLimit);
+  BOOST_CHECK_CLOSE(_motorControlerDummies[0]->getUserSpeedLimit(), originalSpeedLimit / 4, 1e-6);
+  BOOST_CHECK_CLOSE(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit / 2, 1e-6);
+
+  // Completion is reported once, after the motors of both cards have stopped
+  _motorControlerDummies[0]->moveTowardsTarget(1);
+  _motorControlerDummies[1]->moveTowardsTarget(1);
+  BOOST_CHECK(waitForState(*_motors[1], "idle"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  BOOST_CHECK(future.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+  BOOST_CHECK(!group.isSystemIdle());
+  _motorControlerDummies[2]->moveTowardsTarget(1);
+
+  auto result = future.get();
+  BOOST_REQUIRE_EQUAL(result.moveResults.size(), 3U);
+  BOOST_CHECK_EQUAL(result.moveResults[0].finalPositionInSteps, 100);
+  BOOST_CHECK_EQUAL(result.moveResults[1].finalPositionInSteps, -200);
+  BOOST_CHECK_EQUAL(result.moveResults[2].finalPositionInSteps, 400);
+  BOOST_CHECK_EQUAL(nCallbacks.load(), 1);
+  // The second card has stopped at least 50 ms after the first one. Both cards are started right away.
+  BOOST_CHECK(result.finishSkew >= std::chrono::milliseconds(50));
+  BOOST_CHECK(result.startSkew < std::chrono::milliseconds(500));
+  group.waitForIdle();
+  BOOST_CHECK(group.isSystemIdle());
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getUserSpeedLimit(), originalSpeedLimit);
+
+  // Stopping the group stops the motors of both cards
+  BOOST_CHECK(group.moveTo({0.F, 0.F, 0.F}) == ExitStatus::SUCCESS);
+  BOOST_CHECK(waitForState(*_motors[2], "moving"));
+  group.stop();
+  group.waitForIdle();
+  for(auto const& motor : _motors) {
+    BOOST_CHECK_EQUAL(motor->getState(), "idle");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testMoveWhileWorkersAreBusy) {
+  MotionGroup group(_motors);
+
+  // Long-running actions like a calibration occupy all worker threads of the first card
+  auto motorDriverCard = mtca4u::MotorDriverCardFactory::instance().createMotorDriverCard(
+      DUMMY_DEVICE_FILE_NAME, moduleNames[0], stepperMotorDeviceConfigFile);
+  auto motionPoller = MotionPoller::getInstance(motorDriverCard.get());
+  std::promise<void> releaseWorkers;
+  std::shared_future<void> workersReleased(releaseWorkers.get_future());
+  std::atomic<size_t> nBusyWorkers{0};
+  for(size_t i = 0; i < motionPoller->getMaxWorkerThreads(); ++i) {
+    motionPoller->post([&, workersReleased] {
+      ++nBusyWorkers;
+      workersReleased.wait();
+    });
+  }
+  while(nBusyWorkers < motionPoller->getMaxWorkerThreads()) {
+    std::this_thread::yield();
+  }
+
+  // The move is started anyway. Called from another thread, so the test does not hang if it blocks.
+  auto start = std::async(std::launch::async, [&] { return group.moveToInSteps({100, 100, 100}); });
+  bool hasStarted = (start.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  releaseWorkers.set_value();
+  BOOST_REQUIRE(hasStarted);
+  BOOST_CHECK(start.get() == ExitStatus::SUCCESS);
+  for(auto const& motor : _motors) {
+    BOOST_CHECK(waitForState(*motor, "moving"));
+  }
+  group.stop();
+  group.waitForIdle();
+}
+
+BOOST_AUTO_TEST_CASE(testReadErrorDuringMove) {
+  MotionGroup group(_motors);
+  auto future = group.moveToAsyncInSteps({100, -200, 400});
+  for(auto const& motor : _motors) {
+    BOOST_CHECK(waitForState(*motor, "moving"));
+  }
+
+  // An error on the second card ends the motion with the error once the first card has stopped
+  _motorControlerDummies[2]->setSimulatedReadErrors(true);
+  _motorControlerDummies[0]->moveTowardsTarget(1);
+  _motorControlerDummies[1]->moveTowardsTarget(1);
+  BOOST_REQUIRE(future.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+  BOOST_CHECK_THROW(future.get(), ChimeraTK::runtime_error);
+  _motorControlerDummies[2]->setSimulatedReadErrors(false);
+  group.waitForIdle();
+  BOOST_CHECK(group.isSystemIdle());
+
+  _motors[2]->stop();
+  _motors[2]->waitForIdle();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
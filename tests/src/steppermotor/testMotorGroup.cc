@@ -0,0 +1,204 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MotorGroupTest
+
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+using namespace boost::unit_test_framework;
+
+#include "BasicStepperMotor.h"
+#include "MotorControlerDummy.h"
+#include "MotorDriverCard.h"
+#include "MotorDriverCardFactory.h"
+#include "MotorGroup.h"
+#include "StepperMotor.h"
+#include "testConfigConstants.h"
+
+#include <ChimeraTK/Exception.h>
+
+static const std::string stepperMotorDeviceConfigFile("VT21-MotorDriverCardConfig.xml");
+static const std::string moduleName;
+
+using namespace ChimeraTK::MotorDriver;
+
+class MotorGroupFixture {
+ public:
+  MotorGroupFixture();
+  bool waitForState(StepperMotor& motor, const std::string& stateName);
+
+ protected:
+  boost::shared_ptr<mtca4u::MotorDriverCard> _motorDriverCard;
+  std::vector<boost::shared_ptr<mtca4u::MotorControlerDummy>> _motorControlerDummies;
+  std::vector<std::shared_ptr<StepperMotor>> _motors;
+};
+
+MotorGroupFixture::MotorGroupFixture() {
+  mtca4u::MotorDriverCardFactory::instance().setDummyMode();
+  _motorDriverCard = mtca4u::MotorDriverCardFactory::instance().createMotorDriverCard(
+      DUMMY_DEVICE_FILE_NAME, moduleName, stepperMotorDeviceConfigFile);
+
+  for(unsigned int id = 0; id < 2; ++id) {
+    _motorControlerDummies.push_back(
+        boost::dynamic_pointer_cast<mtca4u::MotorControlerDummy>(_motorDriverCard->getMotorControler(id)));
+    _motorControlerDummies.back()->setPositiveReferenceSwitchEnabled(false);
+    _motorControlerDummies.back()->setNegativeReferenceSwitchEnabled(false);
+
+    StepperMotorParameters parameters;
+    parameters.deviceName = DUMMY_DEVICE_FILE_NAME;
+    parameters.moduleName = moduleName;
+    parameters.configFileName = stepperMotorDeviceConfigFile;
+    parameters.driverId = id;
+    _motors.push_back(std::make_shared<BasicStepperMotor>(parameters));
+    (void)_motors.back()->setActualPositionInSteps(0);
+    _motors.back()->setEnabled(true);
+    _motors.back()->waitForIdle();
+  }
+}
+
+bool MotorGroupFixture::waitForState(StepperMotor& motor, const std::string& stateName) {
+  for(unsigned int i = 0; i < 1000; ++i) {
+    if(motor.getState() == stateName) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+BOOST_FIXTURE_TEST_SUITE(MotorGroupTestSuite, MotorGroupFixture)
+
+BOOST_AUTO_TEST_CASE(testConstruction) {
+  BOOST_CHECK_THROW(MotorGroup({}), ChimeraTK::logic_error);
+  BOOST_CHECK_THROW(MotorGroup({_motors[0], _motors[0]}), ChimeraTK::logic_error);
+  BOOST_CHECK_THROW(MotorGroup({_motors[0], std::shared_ptr<StepperMotor>()}), ChimeraTK::logic_error);
+
+  MotorGroup group(_motors);
+  BOOST_CHECK_EQUAL(group.size(), 2U);
+  BOOST_CHECK(group.isSystemIdle());
+}
+
+BOOST_AUTO_TEST_CASE(testInvalidTargets) {
+  MotorGroup group(_motors);
+  BOOST_CHECK(group.moveToInSteps({100}) == ExitStatus::ERR_INVALID_PARAMETER);
+
+  // One invalid target prevents the move of all motors
+  (void)_motors[1]->setMaxPositionLimitInSteps(1000);
+  (void)_motors[1]->setSoftwareLimitsEnabled(true);
+  BOOST_CHECK(group.moveToInSteps({100, 2000}) == ExitStatus::ERR_INVALID_PARAMETER);
+  BOOST_CHECK(group.isSystemIdle());
+  BOOST_CHECK_EQUAL(_motors[0]->getState(), "idle");
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getTargetPosition(), 0);
+
+  // A disabled motor cannot be moved
+  _motors[1]->setEnabled(false);
+  auto future = group.moveToAsyncInSteps({100, 200});
+  BOOST_REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  auto results = future.get();
+  BOOST_REQUIRE_EQUAL(results.size(), 2U);
+  BOOST_CHECK(results[0].status == ExitStatus::ERR_SYSTEM_IN_ACTION);
+  BOOST_CHECK(results[1].status == ExitStatus::ERR_SYSTEM_IN_ACTION);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getTargetPosition(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testSynchronisedMove) {
+  MotorGroup group(_motors);
+  double originalSpeedLimit = _motorControlerDummies[0]->getUserSpeedLimit();
+  BOOST_REQUIRE_EQUAL(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit);
+
+  std::atomic<int> nCallbacks{0};
+  auto future = group.moveToAsyncInSteps({1000, -250}, [&](const std::vector<MoveResult>&) { ++nCallbacks; });
+  BOOST_CHECK(waitForState(*_motors[0], "moving"));
+  BOOST_CHECK(waitForState(*_motors[1], "moving"));
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getTargetPosition(), 1000);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[1]->getTargetPosition(), -250);
+  BOOST_CHECK(!group.isSystemIdle());
+  BOOST_CHECK(group.moveToInSteps({0, 0}) == ExitStatus::ERR_SYSTEM_IN_ACTION);
+
+  // The shorter move is slowed down to arrive together with the longer one
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getUserSpeedLimit(), originalSpeedLimit);
+  BOOST_CHECK_CLOSE(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit / 4, 1e-6);
+
+  // Completion is reported once, after the last motor has stopped
+  _motorControlerDummies[0]->moveTowardsTarget(1);
+  BOOST_CHECK(waitForState(*_motors[0], "idle"));
+  BOOST_CHECK(future.wait_for(std::chrono::milliseconds(20)) == std::future_status::timeout);
+  _motorControlerDummies[1]->moveTowardsTarget(1);
+
+  auto results = future.get();
+  BOOST_REQUIRE_EQUAL(results.size(), 2U);
+  BOOST_CHECK(results[0].status == ExitStatus::SUCCESS);
+  BOOST_CHECK_EQUAL(results[0].finalPositionInSteps, 1000);
+  BOOST_CHECK_EQUAL(results[1].finalPositionInSteps, -250);
+  BOOST_CHECK_EQUAL(nCallbacks.load(), 1);
+  group.waitForIdle();
+  BOOST_CHECK(group.isSystemIdle());
+  BOOST_CHECK_EQUAL(_motorControlerDummies[0]->getUserSpeedLimit(), originalSpeedLimit);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit);
+
+  // A motor of the group can still be moved on its own
+  BOOST_CHECK(_motors[1]->moveRelativeInSteps(250) == ExitStatus::SUCCESS);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[1]->getTargetPosition(), 0);
+  _motorControlerDummies[1]->moveTowardsTarget(1);
+  _motors[1]->waitForIdle();
+
+  // Stopping the group ends the move of all motors
+  BOOST_CHECK(group.moveToInSteps({0, 500}) == ExitStatus::SUCCESS);
+  BOOST_CHECK(waitForState(*_motors[1], "moving"));
+  group.stop();
+  group.waitForIdle();
+  BOOST_CHECK_EQUAL(_motors[0]->getState(), "idle");
+  BOOST_CHECK_EQUAL(_motors[1]->getState(), "idle");
+}
+
+BOOST_AUTO_TEST_CASE(testDestructionDuringMove) {
+  double originalSpeedLimit = _motorControlerDummies[1]->getUserSpeedLimit();
+  std::atomic<int> nCallbacks{0};
+  std::future<std::vector<MoveResult>> future;
+  {
+    MotorGroup group(_motors);
+    future = group.moveToAsyncInSteps({1000, -250}, [&](const std::vector<MoveResult>&) { ++nCallbacks; });
+    BOOST_CHECK(waitForState(*_motors[1], "moving"));
+    BOOST_CHECK_CLOSE(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit / 4, 1e-6);
+  }
+
+  // The move is ended with an explicit status instead of a broken promise, and the speed limits are restored
+  BOOST_REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  auto results = future.get();
+  BOOST_REQUIRE_EQUAL(results.size(), 2U);
+  BOOST_CHECK(results[0].status == ExitStatus::ERR_SYSTEM_IN_ACTION);
+  BOOST_CHECK(results[1].status == ExitStatus::ERR_SYSTEM_IN_ACTION);
+  BOOST_CHECK_EQUAL(nCallbacks.load(), 0);
+  BOOST_CHECK_EQUAL(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit);
+
+  for(auto const& motor : _motors) {
+    motor->stop();
+    motor->waitForIdle();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testReadErrorDuringMove) {
+  MotorGroup group(_motors);
+  double originalSpeedLimit = _motorControlerDummies[1]->getUserSpeedLimit();
+  std::atomic<int> nCallbacks{0};
+  auto future = group.moveToAsyncInSteps({1000, -250}, [&](const std::vector<MoveResult>&) { ++nCallbacks; });
+  BOOST_CHECK(waitForState(*_motors[1], "moving"));
+
+  // An error of the card on the poll thread ends the move, it is handed to the owner of the future
+  _motorControlerDummies[1]->setSimulatedReadErrors(true);
+  BOOST_REQUIRE(future.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+  BOOST_CHECK_THROW(future.get(), ChimeraTK::runtime_error);
+  _motorControlerDummies[1]->setSimulatedReadErrors(false);
+  BOOST_CHECK_EQUAL(nCallbacks.load(), 0);
+  BOOST_CHECK(group.isSystemIdle());
+  BOOST_CHECK_EQUAL(_motorControlerDummies[1]->getUserSpeedLimit(), originalSpeedLimit);
+
+  for(auto const& motor : _motors) {
+    motor->stop();
+    motor->waitForIdle();
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
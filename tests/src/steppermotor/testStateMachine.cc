@@ -209,4 +209,34 @@ BOOST_FIXTURE_TEST_CASE(testDerivedStateMachine, DerivedStateMachine) {
 
 } // BOOST_FIXTURE_TEST_CASE( testDerivedStateMachine, DerivedStateMachine )
 
+// States and events are identified by their IDs, not by their names
+BOOST_FIXTURE_TEST_CASE(testStateAndEventIds, StateMachine) {
+  BOOST_CHECK_EQUAL(getCurrentStateId(), StateMachine::INIT_STATE);
+  BOOST_CHECK_EQUAL(_endState.getId(), StateMachine::END_STATE);
+
+  StateMachine::Event event("someEvent");
+  StateMachine::Event sameNameEvent("someEvent");
+  StateMachine::Event otherEvent("otherEvent");
+  BOOST_CHECK(event == sameNameEvent);
+  BOOST_CHECK_EQUAL(event.getId(), sameNameEvent.getId());
+  BOOST_CHECK(!(event == otherEvent));
+  BOOST_CHECK(event < otherEvent || otherEvent < event);
+  BOOST_CHECK(event == event);
+
+  StateMachine::State targetState("targetState", StateMachine::N_STATE_IDS);
+  StateMachine::State unusedState("unusedState", StateMachine::N_STATE_IDS + 1);
+  BOOST_CHECK_EQUAL(StateMachine::State("noId").getId(), StateMachine::NO_STATE_ID);
+
+  // An event with the same name triggers the transition as well. The first transition for an event is kept.
+  int nActions = 0;
+  _initState.setTransition(event, &targetState, [&] { ++nActions; });
+  _initState.setTransition(sameNameEvent, &unusedState, [&] { nActions += 10; });
+  setAndProcessUserEvent(otherEvent);
+  BOOST_CHECK_EQUAL(getCurrentStateId(), StateMachine::INIT_STATE);
+  setAndProcessUserEvent(StateMachine::Event("someEvent"));
+  BOOST_CHECK_EQUAL(getCurrentStateId(), StateMachine::N_STATE_IDS);
+  BOOST_CHECK_EQUAL(getCurrentState()->getName(), "targetState");
+  BOOST_CHECK_EQUAL(nActions, 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
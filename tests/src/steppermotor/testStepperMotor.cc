@@ -4,12 +4,20 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <utility>
+#include <vector>
 using namespace boost::unit_test_framework;
 
 #include "BasicStepperMotor.h"
+#include "MotionPoller.h"
 #include "MotorControlerDummy.h"
 #include "MotorDriverCard.h"
 #include "MotorDriverCardFactory.h"
@@ -691,4 +699,330 @@ BOOST_AUTO_TEST_CASE(TestConverter) {
   BOOST_CHECK(_stepperMotor->getMaxPositionLimitInSteps() == 900);
 }
 
+BOOST_AUTO_TEST_CASE(TestMotionPoller) {
+  std::cout << "testMotionPoller" << std::endl;
+  auto poller = MotionPoller::getInstance(_motorDriverCard.get());
+  // all motors of a card share the poller
+  BOOST_CHECK(poller == MotionPoller::getInstance(_motorDriverCard.get()));
+  BOOST_CHECK(poller->getPollPeriod() == MotionPoller::DEFAULT_POLL_PERIOD);
+  BOOST_CHECK_THROW(poller->setPollPeriod(std::chrono::microseconds(0)), ChimeraTK::logic_error);
+  poller->setPollPeriod(std::chrono::microseconds(200));
+  BOOST_CHECK(poller->getPollPeriod() == std::chrono::microseconds(200));
+
+  // Returns after the poll thread has completed the given number of poll passes. The condition of waitUntil() is
+  // evaluated once in each pass.
+  auto waitForPollPasses = [&](int nPasses) {
+    int nEvaluations = 0;
+    poller->waitUntil([&] { return ++nEvaluations > nPasses; });
+  };
+
+  // a poll function is called until it reports completion, then it is dropped
+  std::atomic<int> nCalls{0};
+  int owner;
+  poller->add(&owner, [&] { return ++nCalls == 3; });
+  poller->waitUntil([&] { return nCalls >= 3; });
+  waitForPollPasses(2);
+  BOOST_CHECK_EQUAL(nCalls.load(), 3);
+
+  // removed poll functions are not called any more
+  std::atomic<int> nCallsRemoved{0};
+  poller->add(&owner, [&] {
+    ++nCallsRemoved;
+    return false;
+  });
+  poller->remove(&owner);
+  int nCallsAfterRemove = nCallsRemoved;
+  waitForPollPasses(2);
+  BOOST_CHECK_EQUAL(nCallsRemoved.load(), nCallsAfterRemove);
+
+  poller->setPollPeriod(MotionPoller::DEFAULT_POLL_PERIOD);
+}
+
+BOOST_AUTO_TEST_CASE(TestMotionPollerWorkers) {
+  std::cout << "testMotionPollerWorkers" << std::endl;
+  auto poller = MotionPoller::getInstance(_motorDriverCard.get());
+  BOOST_CHECK_EQUAL(poller->getMaxWorkerThreads(), MotionPoller::DEFAULT_MAX_WORKER_THREADS);
+  BOOST_CHECK_THROW(poller->setMaxWorkerThreads(0), ChimeraTK::logic_error);
+
+  // waitUntil() returns as soon as the poll thread sees the condition fulfilled
+  std::atomic<bool> flag{false};
+  std::thread setter([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    flag = true;
+  });
+  poller->waitUntil([&] { return flag.load(); });
+  BOOST_CHECK(flag);
+  setter.join();
+
+  // posted actions are executed concurrently up to the number of workers, the rest is queued
+  std::mutex mutex;
+  std::condition_variable condition;
+  int nRunning = 0, nMaxRunning = 0, nDone = 0;
+  bool release = false;
+  constexpr int nActions = 5;
+  for(int i = 0; i < nActions; ++i) {
+    poller->post([&] {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++nRunning;
+      nMaxRunning = std::max(nMaxRunning, nRunning);
+      condition.notify_all();
+      condition.wait(lock, [&] { return release; });
+      --nRunning;
+      ++nDone;
+      condition.notify_all();
+    });
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    BOOST_CHECK(condition.wait_for(lock, std::chrono::seconds(5),
+        [&] { return nRunning == static_cast<int>(MotionPoller::DEFAULT_MAX_WORKER_THREADS); }));
+    release = true;
+    condition.notify_all();
+    BOOST_CHECK(condition.wait_for(lock, std::chrono::seconds(5), [&] { return nDone == nActions; }));
+  }
+  BOOST_CHECK_EQUAL(nMaxRunning, static_cast<int>(MotionPoller::DEFAULT_MAX_WORKER_THREADS));
+}
+
+BOOST_AUTO_TEST_CASE(TestMotionPollerShutdown) {
+  std::cout << "testMotionPollerShutdown" << std::endl;
+  // The key is only compared, so any address not used by a real card gives a poller of its own
+  char otherCard;
+  auto cardKey = reinterpret_cast<mtca4u::MotorDriverCard const*>(&otherCard);
+  auto poller = MotionPoller::getInstance(cardKey);
+
+  // a worker waiting for a condition which never becomes true must not block the destruction of the poller
+  std::promise<void> isWaiting;
+  std::promise<bool> hasThrown;
+  poller->post([&, poller = poller.get()] {
+    bool isFirstEvaluation = true;
+    try {
+      poller->waitUntil([&] {
+        if(isFirstEvaluation) {
+          isFirstEvaluation = false;
+          isWaiting.set_value();
+        }
+        return false;
+      });
+      hasThrown.set_value(false);
+    }
+    catch(ChimeraTK::runtime_error&) {
+      hasThrown.set_value(true);
+    }
+  });
+  isWaiting.get_future().wait();
+
+  auto destruction = std::async(std::launch::async, [&] { poller.reset(); });
+  BOOST_REQUIRE(destruction.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+  auto hasThrownFuture = hasThrown.get_future();
+  BOOST_REQUIRE(hasThrownFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  BOOST_CHECK(hasThrownFuture.get());
+
+  // the destroyed poller is not handed out again
+  auto newPoller = MotionPoller::getInstance(cardKey);
+  BOOST_CHECK(newPoller);
+  newPoller->waitUntil([] { return true; });
+}
+
+BOOST_AUTO_TEST_CASE(TestWaitForIdleIsEventDriven) {
+  std::cout << "testWaitForIdleIsEventDriven" << std::endl;
+  (void)_stepperMotor->setActualPositionInSteps(0);
+  _stepperMotor->setEnabled(true);
+  _stepperMotor->waitForIdle();
+
+  BOOST_CHECK(_stepperMotor->setTargetPositionInSteps(50) == ExitStatus::SUCCESS);
+  BOOST_CHECK(waitForState("moving"));
+
+  // Several threads can wait for the same motor. They must not return before the motor is idle, and nobody else
+  // starts a move.
+  std::atomic<int> nStarted{0};
+  std::atomic<int> nFinishedIdle{0};
+  auto waiter = [&] {
+    ++nStarted;
+    _stepperMotor->waitForIdle();
+    if(_stepperMotor->isSystemIdle()) {
+      ++nFinishedIdle;
+    }
+  };
+  std::thread waiter1(waiter);
+  std::thread waiter2(waiter);
+  while(nStarted < 2) {
+    std::this_thread::yield();
+  }
+  BOOST_CHECK_EQUAL(_stepperMotor->getState(), "moving");
+
+  _motorControlerDummy->moveTowardsTarget(1);
+  waiter1.join();
+  waiter2.join();
+  BOOST_CHECK_EQUAL(nFinishedIdle.load(), 2);
+  BOOST_CHECK_EQUAL(_stepperMotor->isSystemIdle(), true);
+  BOOST_CHECK_EQUAL(_stepperMotor->getCurrentPositionInSteps(), 50);
+}
+
+BOOST_AUTO_TEST_CASE(TestWaitForIdleForwardsErrors) {
+  std::cout << "testWaitForIdleForwardsErrors" << std::endl;
+  (void)_stepperMotor->setActualPositionInSteps(0);
+  _stepperMotor->setEnabled(true);
+  _stepperMotor->waitForIdle();
+  BOOST_CHECK(_stepperMotor->setTargetPositionInSteps(50) == ExitStatus::SUCCESS);
+  BOOST_CHECK(waitForState("moving"));
+
+  // The waiting thread checks the motor once itself, then the poll thread takes over. The read error occurs in the
+  // poll thread and is thrown to the waiting thread.
+  std::atomic<bool> isErrorThrown{false};
+  _motorControlerDummy->blockNextReads(1);
+  std::thread waiter([&] {
+    try {
+      _stepperMotor->waitForIdle();
+    }
+    catch(ChimeraTK::runtime_error&) {
+      isErrorThrown = true;
+    }
+  });
+  _motorControlerDummy->waitForBlockedReads(1);
+  _motorControlerDummy->blockNextReads(1);
+  _motorControlerDummy->releaseBlockedReads();
+  _motorControlerDummy->waitForBlockedReads(1);
+  _motorControlerDummy->setSimulatedReadErrors(true);
+  _motorControlerDummy->releaseBlockedReads();
+  waiter.join();
+  _motorControlerDummy->setSimulatedReadErrors(false);
+  BOOST_CHECK(isErrorThrown);
+
+  // the motor is still usable afterwards
+  _motorControlerDummy->moveTowardsTarget(1);
+  _stepperMotor->waitForIdle();
+  BOOST_CHECK_EQUAL(_stepperMotor->getCurrentPositionInSteps(), 50);
+}
+
+BOOST_AUTO_TEST_CASE(TestStopWhilePolling) {
+  std::cout << "testStopWhilePolling" << std::endl;
+  (void)_stepperMotor->setActualPositionInSteps(0);
+  _stepperMotor->setEnabled(true);
+  _stepperMotor->waitForIdle();
+
+  // Each poller is held in a read of the hardware. The getters must not hold the lock of the motor meanwhile,
+  // otherwise stop() and emergencyStop() would have to wait for the pollers.
+  auto const nPollers = 16;
+  std::atomic<bool> polling{true};
+  std::atomic<int> nPolls{0};
+  std::vector<std::thread> pollers;
+  for(int i = 0; i < nPollers; ++i) {
+    pollers.emplace_back([&] {
+      while(polling) {
+        (void)_stepperMotor->getCurrentPositionInSteps();
+        (void)_stepperMotor->getTargetPosition();
+        (void)_stepperMotor->getEncoderPosition();
+        (void)_stepperMotor->isMoving();
+        (void)_stepperMotor->getMaxPositionLimitInSteps();
+        ++nPolls;
+      }
+    });
+  }
+
+  // Returns whether the stop has completed while all pollers were blocked. The timeout only keeps the test from
+  // hanging if the stop waits for a poller.
+  auto isStoppedWhilePollersBlocked = [&](std::function<void()> stopFunction) {
+    BOOST_CHECK(_stepperMotor->setTargetPositionInSteps(50) == ExitStatus::SUCCESS);
+    BOOST_CHECK(waitForState("moving", 1000));
+    _motorControlerDummy->moveTowardsTarget(0.4F);
+    _motorControlerDummy->blockNextReads(nPollers);
+    _motorControlerDummy->waitForBlockedReads(nPollers);
+    auto stopped = std::async(std::launch::async, stopFunction);
+    bool isStopped = (stopped.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+    _motorControlerDummy->releaseBlockedReads();
+    stopped.get();
+    return isStopped;
+  };
+
+  BOOST_CHECK(isStoppedWhilePollersBlocked([&] { _stepperMotor->stop(); }));
+  _stepperMotor->waitForIdle();
+  BOOST_CHECK_EQUAL(_stepperMotor->getTargetPositionInSteps(), 20);
+
+  BOOST_CHECK(isStoppedWhilePollersBlocked([&] { _stepperMotor->emergencyStop(); }));
+  BOOST_CHECK(waitForState("error", 1000));
+
+  polling = false;
+  for(auto& poller : pollers) {
+    poller.join();
+  }
+  BOOST_CHECK(nPolls > 0);
+
+  _stepperMotor->resetError();
+  BOOST_CHECK(waitForState("disabled"));
+}
+
+BOOST_AUTO_TEST_CASE(TestMoveAsync) {
+  std::cout << "testMoveAsync" << std::endl;
+  (void)_stepperMotor->setActualPositionInSteps(0);
+  _stepperMotor->setEnabled(true);
+  _stepperMotor->waitForIdle();
+
+  std::atomic<int> nCallbacks{0};
+  MoveResult callbackResult;
+  auto moveFuture = _stepperMotor->moveToAsyncInSteps(100, [&](const MoveResult& result) {
+    callbackResult = result;
+    ++nCallbacks;
+  });
+  BOOST_CHECK(waitForState("moving"));
+  BOOST_CHECK(moveFuture.wait_for(std::chrono::milliseconds(10)) == std::future_status::timeout);
+
+  // A second move cannot be started while moving, this is reported immediately
+  auto rejectedFuture = _stepperMotor->moveRelativeAsyncInSteps(10);
+  BOOST_REQUIRE(rejectedFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  BOOST_CHECK(rejectedFuture.get().status == ExitStatus::ERR_SYSTEM_IN_ACTION);
+
+  _motorControlerDummy->moveTowardsTarget(1);
+  auto result = moveFuture.get();
+  BOOST_CHECK(result.status == ExitStatus::SUCCESS);
+  BOOST_CHECK(result.error == Error::NO_ERROR);
+  BOOST_CHECK_EQUAL(result.finalPositionInSteps, 100);
+  BOOST_CHECK_EQUAL(result.finalPosition, 100.F);
+  BOOST_CHECK(result.elapsedTime >= std::chrono::milliseconds(10));
+  BOOST_CHECK_EQUAL(nCallbacks.load(), 1);
+  BOOST_CHECK_EQUAL(callbackResult.finalPositionInSteps, 100);
+  BOOST_CHECK_EQUAL(_stepperMotor->isSystemIdle(), true);
+
+  // Positions outside of the software limits are rejected immediately
+  BOOST_CHECK(_stepperMotor->setSoftwareLimitsEnabled(true) == ExitStatus::SUCCESS);
+  auto invalidFuture = _stepperMotor->moveToAsync(5000.F);
+  BOOST_REQUIRE(invalidFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+  auto invalidResult = invalidFuture.get();
+  BOOST_CHECK(invalidResult.status == ExitStatus::ERR_INVALID_PARAMETER);
+  BOOST_CHECK_EQUAL(invalidResult.finalPositionInSteps, 100);
+
+  // A stopped move ends at the position where it has been stopped
+  auto stoppedFuture = _stepperMotor->moveRelativeAsync(-100.F);
+  BOOST_CHECK(waitForState("moving"));
+  _motorControlerDummy->moveTowardsTarget(0.5);
+  _stepperMotor->stop();
+  auto stoppedResult = stoppedFuture.get();
+  BOOST_CHECK(stoppedResult.status == ExitStatus::SUCCESS);
+  BOOST_CHECK_EQUAL(stoppedResult.finalPositionInSteps, 50);
+
+  // Many moves can be awaited without a thread per move
+  std::vector<std::future<MoveResult>> futures;
+  for(int i = 1; i <= 3; ++i) {
+    _stepperMotor->waitForIdle();
+    futures.push_back(_stepperMotor->moveRelativeAsyncInSteps(10));
+    BOOST_CHECK(waitForState("moving"));
+    _motorControlerDummy->moveTowardsTarget(1);
+    BOOST_CHECK_EQUAL(futures.back().get().finalPositionInSteps, 50 + i * 10);
+  }
+
+  // An error of the card while the poll thread observes the move is thrown by the future
+  _stepperMotor->waitForIdle();
+  nCallbacks = 0;
+  auto failingFuture = _stepperMotor->moveRelativeAsyncInSteps(10, [&](const MoveResult&) { ++nCallbacks; });
+  BOOST_CHECK(waitForState("moving"));
+  _motorControlerDummy->blockNextReads(1);
+  _motorControlerDummy->waitForBlockedReads(1);
+  _motorControlerDummy->setSimulatedReadErrors(true);
+  _motorControlerDummy->releaseBlockedReads();
+  BOOST_CHECK_THROW(failingFuture.get(), ChimeraTK::runtime_error);
+  _motorControlerDummy->setSimulatedReadErrors(false);
+  BOOST_CHECK_EQUAL(nCallbacks.load(), 0);
+  _motorControlerDummy->moveTowardsTarget(1);
+  _stepperMotor->waitForIdle();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,8 +12,11 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <cmath>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 using namespace boost::unit_test_framework;
 
 #include "DFMC_MD22Dummy.h"
@@ -445,6 +448,171 @@ BOOST_AUTO_TEST_CASE(testCalibrateStop) {
   BOOST_CHECK(_stepperMotor->getError() == Error::CALIBRATION_ERROR);
 }
 
+BOOST_AUTO_TEST_CASE(testCalibrateTwoPhase) {
+  std::mutex progressMutex;
+  std::vector<CalibrationProgress> progressReports;
+  _stepperMotorParameters.calibration.twoPhaseSearch = true;
+  _stepperMotorParameters.calibration.fineSpeedFraction = 0.1;
+  _stepperMotorParameters.calibration.backOffInSteps = 1000;
+  _stepperMotorParameters.calibration.progressCallback = [&](const CalibrationProgress& progress) {
+    std::lock_guard<std::mutex> lock(progressMutex);
+    progressReports.push_back(progress);
+  };
+
+  // invalid search parameters are rejected
+  auto invalidParameters = _stepperMotorParameters;
+  invalidParameters.calibration.fineSpeedFraction = 0.;
+  BOOST_CHECK_THROW(LinearStepperMotor{invalidParameters}, ChimeraTK::logic_error);
+  invalidParameters = _stepperMotorParameters;
+  invalidParameters.calibration.backOffInSteps = 0;
+  BOOST_CHECK_THROW(LinearStepperMotor{invalidParameters}, ChimeraTK::logic_error);
+
+  _stepperMotor = std::make_shared<LinearStepperMotor>(_stepperMotorParameters);
+  _stepperMotor->setEnabled(true);
+  BOOST_CHECK(waitForState("idle"));
+  double userSpeedLimit = _motorControlerDummy->getUserSpeedLimit();
+  BOOST_CHECK_NO_THROW(_stepperMotor->calibrate());
+  BOOST_CHECK(waitForState("calibrating"));
+
+  // fast approach, back-off and fine approach for both end switches
+  for(int sign : {1, -1}) {
+    int endSwitch = sign > 0 ? POS_POSITIVE_ENDSWITCH_MOTORCONTROLLER : POS_NEGATIVE_ENDSWITCH_MOTORCONTROLLER;
+    int start = sign > 0 ? 0 : POS_POSITIVE_ENDSWITCH_MOTORCONTROLLER;
+
+    waitToSetTargetPos(start + sign * 50000);
+    BOOST_CHECK_EQUAL(_motorControlerDummy->getUserSpeedLimit(), _motorControlerDummy->getMaxSpeedCapability());
+    _motorControlerDummy->moveTowardsTarget(1);
+
+    waitToSetTargetPos(endSwitch - sign * 1000);
+    BOOST_CHECK_CLOSE(_motorControlerDummy->getUserSpeedLimit(), 0.1 * userSpeedLimit, 1e-6);
+    _motorControlerDummy->moveTowardsTarget(1);
+
+    waitToSetTargetPos(endSwitch + sign * 1000);
+    BOOST_CHECK_CLOSE(_motorControlerDummy->getUserSpeedLimit(), 0.1 * userSpeedLimit, 1e-6);
+    _motorControlerDummy->moveTowardsTarget(1);
+  }
+  BOOST_CHECK(waitForState("idle"));
+
+  BOOST_CHECK_EQUAL(_stepperMotor->isCalibrated(), true);
+  BOOST_CHECK_EQUAL(getCalibrationFailed(), false);
+  BOOST_CHECK_EQUAL(_stepperMotor->getPositiveEndReferenceInSteps(), POS_POSITIVE_ENDSWITCH_STEPPERMOTOR);
+  BOOST_CHECK_EQUAL(_stepperMotor->getNegativeEndReferenceInSteps(), POS_NEGATIVE_ENDSWITCH_STEPPERMOTOR);
+  // the user speed limit is restored after the search
+  BOOST_CHECK_EQUAL(_motorControlerDummy->getUserSpeedLimit(), userSpeedLimit);
+
+  std::lock_guard<std::mutex> lock(progressMutex);
+  std::vector<CalibrationPhase> expectedPhases{CalibrationPhase::FAST_APPROACH, CalibrationPhase::BACK_OFF,
+      CalibrationPhase::FINE_APPROACH, CalibrationPhase::FOUND};
+  BOOST_REQUIRE_EQUAL(progressReports.size(), 2 * expectedPhases.size());
+  for(size_t i = 0; i < progressReports.size(); ++i) {
+    BOOST_CHECK(progressReports[i].phase == expectedPhases[i % expectedPhases.size()]);
+    BOOST_CHECK_EQUAL(progressReports[i].direction, i < expectedPhases.size() ? 1 : -1);
+  }
+  BOOST_CHECK_EQUAL(progressReports[3].positionInSteps, POS_POSITIVE_ENDSWITCH_MOTORCONTROLLER);
+  BOOST_CHECK_EQUAL(progressReports[7].positionInSteps, POS_NEGATIVE_ENDSWITCH_MOTORCONTROLLER);
+}
+
+BOOST_AUTO_TEST_CASE(testRunningStatistics) {
+  utility::RunningStatistics statistics;
+  BOOST_CHECK_EQUAL(statistics.count(), 0);
+  BOOST_CHECK_EQUAL(statistics.standardDeviation(), 0.);
+  BOOST_CHECK(std::isinf(statistics.standardDeviationConfidenceWidth(1.96)));
+
+  // same samples as used by the (disabled) tolerance test, std deviation 3.02765
+  for(int i = 0; i < 10; ++i) {
+    statistics.add(10000 + i);
+  }
+  BOOST_CHECK_EQUAL(statistics.count(), 10);
+  BOOST_CHECK_CLOSE(statistics.mean(), 10004.5, 1e-9);
+  BOOST_CHECK_CLOSE(statistics.standardDeviation(), 3.02765, 0.001);
+  BOOST_CHECK_CLOSE(statistics.standardDeviationConfidenceWidth(1.96), 2. * 1.96 * 3.02765 / std::sqrt(18.), 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(testDetermineToleranceNearestFirst) {
+  _stepperMotorParameters.tolerance.nearestEndSwitchFirst = true;
+  _stepperMotorParameters.tolerance.confidenceWidthInSteps = 1.;
+  _stepperMotorParameters.tolerance.minSamples = 3;
+
+  auto invalidParameters = _stepperMotorParameters;
+  invalidParameters.tolerance.minSamples = 1;
+  BOOST_CHECK_THROW(LinearStepperMotor{invalidParameters}, ChimeraTK::logic_error);
+  invalidParameters = _stepperMotorParameters;
+  invalidParameters.tolerance.maxSamples = 2;
+  BOOST_CHECK_THROW(LinearStepperMotor{invalidParameters}, ChimeraTK::logic_error);
+
+  _stepperMotor = std::make_shared<LinearStepperMotor>(_stepperMotorParameters);
+  _stepperMotor->setEnabled(true);
+  performCalibrationForTest();
+  BOOST_CHECK(_stepperMotor->getCalibrationMode() == CalibrationMode::FULL);
+  BOOST_CHECK_EQUAL(_stepperMotor->isNegativeReferenceActive(), true);
+
+  BOOST_CHECK(_stepperMotor->determineTolerance() == ExitStatus::SUCCESS);
+  BOOST_CHECK(waitForState("calculatingTolerance"));
+
+  // The motor is on the negative end switch, so it is measured first. All samples are taken close
+  // to the end switch. The dummy end switches do not scatter, so the measurement ends after the
+  // minimum number of samples.
+  for(int sign : {-1, 1}) {
+    int endSwitch = sign > 0 ? POS_POSITIVE_ENDSWITCH_STEPPERMOTOR : POS_NEGATIVE_ENDSWITCH_STEPPERMOTOR;
+    for(int i = 0; i < 3; ++i) {
+      waitToSetTargetPos(endSwitch - sign * 1000);
+      _motorControlerDummy->moveTowardsTarget(1);
+      waitToSetTargetPos(endSwitch + sign * 1000);
+      _motorControlerDummy->moveTowardsTarget(1);
+    }
+  }
+  BOOST_CHECK(waitForState("idle"));
+
+  BOOST_CHECK_EQUAL(getToleranceCalculated(), true);
+  BOOST_CHECK_EQUAL(getToleranceCalcFailed(), false);
+  BOOST_CHECK_EQUAL(_stepperMotor->getTolerancePositiveEndSwitch(), 0.F);
+  BOOST_CHECK_EQUAL(_stepperMotor->getToleranceNegativeEndSwitch(), 0.F);
+  std::vector<int> expectedPositive(3, POS_POSITIVE_ENDSWITCH_STEPPERMOTOR);
+  std::vector<int> expectedNegative(3, POS_NEGATIVE_ENDSWITCH_STEPPERMOTOR);
+  auto positiveSamples = _stepperMotor->getPositiveEndSwitchSamplesInSteps();
+  auto negativeSamples = _stepperMotor->getNegativeEndSwitchSamplesInSteps();
+  BOOST_CHECK_EQUAL_COLLECTIONS(
+      positiveSamples.begin(), positiveSamples.end(), expectedPositive.begin(), expectedPositive.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(
+      negativeSamples.begin(), negativeSamples.end(), expectedNegative.begin(), expectedNegative.end());
+}
+
+BOOST_AUTO_TEST_CASE(testDetermineToleranceIncomplete) {
+  _stepperMotorParameters.tolerance.nearestEndSwitchFirst = true;
+  _stepperMotorParameters.tolerance.minSamples = 3;
+  _stepperMotor = std::make_shared<LinearStepperMotor>(_stepperMotorParameters);
+  _stepperMotor->setEnabled(true);
+  performCalibrationForTest();
+  BOOST_CHECK(_stepperMotor->getCalibrationMode() == CalibrationMode::FULL);
+
+  BOOST_CHECK(_stepperMotor->determineTolerance() == ExitStatus::SUCCESS);
+  BOOST_CHECK(waitForState("calculatingTolerance"));
+
+  // Two scattering samples of the negative end switch
+  for(int i = 0; i < 2; ++i) {
+    waitToSetTargetPos(POS_NEGATIVE_ENDSWITCH_STEPPERMOTOR + 1000);
+    _motorControlerDummy->moveTowardsTarget(1);
+    waitToSetTargetPos(POS_NEGATIVE_ENDSWITCH_STEPPERMOTOR - 1000);
+    _motorControlerDummy->setNegativeEndSwitch(POS_NEGATIVE_ENDSWITCH_MOTORCONTROLLER - i * 10);
+    _motorControlerDummy->moveTowardsTarget(1);
+  }
+
+  // The motor gets stuck on the approach of the third sample
+  waitToSetTargetPos(POS_NEGATIVE_ENDSWITCH_STEPPERMOTOR + 1000);
+  _motorControlerDummy->moveTowardsTarget(0.5f);
+  _motorControlerDummy->simulateBlockedMotor(true);
+  for(int i = 0; i < 100 && !getToleranceCalcFailed(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // The statistics of two samples are not reported as tolerance
+  BOOST_CHECK_EQUAL(getToleranceCalcFailed(), true);
+  BOOST_CHECK_EQUAL(getToleranceCalculated(), false);
+  BOOST_CHECK(_stepperMotor->getError() == Error::CALIBRATION_ERROR);
+  BOOST_CHECK_EQUAL(_stepperMotor->getToleranceNegativeEndSwitch(), 0.F);
+  BOOST_CHECK_EQUAL(_stepperMotor->getNegativeEndSwitchSamplesInSteps().size(), 2);
+}
+
 BOOST_AUTO_TEST_CASE(testTranslation) {
   // Make sure we are in simple calibration mode
   _stepperMotor->setActualPosition(0.f);
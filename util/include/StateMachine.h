@@ -4,11 +4,14 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
-#include <map>
+#include <limits>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 struct StateMachineTestFixture;
 
@@ -16,24 +19,40 @@ namespace ChimeraTK::MotorDriver::utility {
 
   /**
    * @brief Base class for a state machine
+   *
+   * Events and states are identified by integers. Each event name is assigned a small ID the first time it is used,
+   * so all events of the same name share it. The ID indexes the flat transition table of each state.
    */
   class StateMachine {
     friend struct ::StateMachineTestFixture;
 
    public:
+    using EventId = uint32_t;
+    using StateId = uint32_t;
+
+    /**
+     * IDs of the states of this class. A derived state machine numbers its states starting from the N_STATE_IDS of
+     * its base class, so a state can be checked with getCurrentStateId() without comparing names.
+     */
+    enum : StateId { INIT_STATE = 0, END_STATE, N_STATE_IDS };
+    static constexpr StateId NO_STATE_ID = std::numeric_limits<StateId>::max();
+
     /**
      * @brief Class describing events triggering the StateMachine
      */
     class Event {
      public:
-      explicit Event(std::string eventName) : _eventName(std::move(eventName)) {}
+      explicit Event(std::string eventName);
       Event() = delete;
 
       friend bool operator<(const Event& event1, const Event& event2);
+      friend bool operator==(const Event& event1, const Event& event2);
       [[nodiscard]] const std::string& getName() const { return _eventName; }
+      [[nodiscard]] EventId getId() const { return _id; }
 
      private:
       std::string _eventName;
+      EventId _id;
     };
 
     /**
@@ -66,12 +85,13 @@ namespace ChimeraTK::MotorDriver::utility {
       };
 
       /**
-       * TransitionTable type, maps TransitionData to an event.
+       * TransitionTable type, indexed by the ID of the event. Events without a transition from this state have no
+       * value.
        */
-      using TransitionTable = std::map<Event, TransitionData>;
+      using TransitionTable = std::vector<std::optional<TransitionData>>;
 
      public:
-      explicit State(std::string stateName = "");
+      explicit State(std::string stateName = "", StateId id = NO_STATE_ID);
       virtual ~State();
 
       /**
@@ -96,10 +116,17 @@ namespace ChimeraTK::MotorDriver::utility {
        * @brief get the name of the state
        * @return name of state
        */
-      [[nodiscard]] std::string getName() const;
+      [[nodiscard]] const std::string& getName() const;
+
+      /**
+       * @brief get the ID of the state
+       * @return ID of the state, NO_STATE_ID if none has been given
+       */
+      [[nodiscard]] StateId getId() const { return _id; }
 
      protected:
       std::string _stateName;
+      StateId _id;
       TransitionTable _transitionTable;
     };
 
@@ -109,12 +136,14 @@ namespace ChimeraTK::MotorDriver::utility {
     virtual ~StateMachine() = default;
 
     State* getCurrentState();
+    /// Like getCurrentState()->getId(), the internal callback of the current state is performed as well
+    StateId getCurrentStateId();
     void setAndProcessUserEvent(const Event& event);
     Event getUserEvent();
 
    protected:
-    State _initState{"initState"};
-    State _endState{"endState"};
+    State _initState{"initState", INIT_STATE};
+    State _endState{"endState", END_STATE};
     State* _currentState{&_initState};
     State* _requestedState{nullptr};
 
@@ -131,5 +160,6 @@ namespace ChimeraTK::MotorDriver::utility {
   };
 
   bool operator<(const StateMachine::Event& event1, const StateMachine::Event& event2);
+  bool operator==(const StateMachine::Event& event1, const StateMachine::Event& event2);
 
 } // namespace ChimeraTK::MotorDriver::utility
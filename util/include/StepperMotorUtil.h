@@ -10,6 +10,8 @@
 #ifndef CHIMERATK_STEPPER_MOTOR_UTIL_H
 #define CHIMERATK_STEPPER_MOTOR_UTIL_H
 
+#include <cmath>
+#include <cstddef>
 #include <string>
 namespace ChimeraTK { namespace MotorDriver {
 
@@ -140,6 +142,50 @@ namespace ChimeraTK { namespace MotorDriver {
     using ScalingEncoderStepsConverter = ScalingUnitsConverter<double>;
     using EncoderStepsConverterTrivia = UnitsConverterTrivia<double>;
 
+    /**
+     * @brief Running mean and standard deviation of a series of samples (Welford's algorithm)
+     *
+     * The samples are not stored, each add() updates the statistics in constant time.
+     */
+    class RunningStatistics {
+     public:
+      void add(double sample) {
+        ++_count;
+        double delta = sample - _mean;
+        _mean += delta / static_cast<double>(_count);
+        _sumOfSquaredDeviations += delta * (sample - _mean);
+      }
+
+      std::size_t count() const { return _count; }
+
+      double mean() const { return _mean; }
+
+      /// Sample variance (normalised with n-1), 0 for less than two samples
+      double variance() const { return _count < 2 ? 0. : _sumOfSquaredDeviations / static_cast<double>(_count - 1); }
+
+      double standardDeviation() const { return std::sqrt(variance()); }
+
+      /**
+       * @brief Width of the confidence interval of the standard deviation.
+       *
+       * Uses the large sample approximation sigma/sqrt(2(n-1)) for the standard error of the
+       * standard deviation of normally distributed samples. The confidence factor is the
+       * quantile of the normal distribution, e.g. 1.96 for a 95% confidence interval.
+       * Infinite for less than two samples.
+       */
+      double standardDeviationConfidenceWidth(double confidenceFactor) const {
+        if(_count < 2) {
+          return INFINITY;
+        }
+        return 2. * confidenceFactor * standardDeviation() / std::sqrt(2. * static_cast<double>(_count - 1));
+      }
+
+     private:
+      std::size_t _count{0};
+      double _mean{0.};
+      double _sumOfSquaredDeviations{0.};
+    };
+
   } // namespace utility
 
 }} // namespace ChimeraTK::MotorDriver
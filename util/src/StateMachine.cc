@@ -6,14 +6,40 @@
 #include "StepperMotorUtil.h"
 
 #include <cassert>
+#include <unordered_map>
 
 namespace ChimeraTK::MotorDriver {
   namespace utility {
 
     /******************************************************************************************************************/
 
+    namespace {
+      StateMachine::EventId getEventId(const std::string& eventName) {
+        // Function-local, so events which are static members of other translation units can use it
+        static std::mutex registryMutex;
+        static std::unordered_map<std::string, StateMachine::EventId> registry;
+
+        std::lock_guard<std::mutex> lck(registryMutex);
+        auto id = static_cast<StateMachine::EventId>(registry.size());
+        return registry.try_emplace(eventName, id).first->second;
+      }
+    } // namespace
+
+    /******************************************************************************************************************/
+
+    StateMachine::Event::Event(std::string eventName)
+    : _eventName(std::move(eventName)), _id(getEventId(_eventName)) {}
+
+    /******************************************************************************************************************/
+
     bool operator<(const StateMachine::Event& event1, const StateMachine::Event& event2) {
-      return event1._eventName < event2._eventName;
+      return event1._id < event2._id;
+    }
+
+    /******************************************************************************************************************/
+
+    bool operator==(const StateMachine::Event& event1, const StateMachine::Event& event2) {
+      return event1._id == event2._id;
     }
 
     /******************************************************************************************************************/
@@ -29,7 +55,7 @@ namespace ChimeraTK::MotorDriver {
 
     /******************************************************************************************************************/
 
-    StateMachine::State::State(std::string stateName) : _stateName(std::move(stateName)) {}
+    StateMachine::State::State(std::string stateName, StateId id) : _stateName(std::move(stateName)), _id(id) {}
 
     /******************************************************************************************************************/
 
@@ -39,8 +65,14 @@ namespace ChimeraTK::MotorDriver {
 
     void StateMachine::State::setTransition(const Event& event, State* target, std::function<void(void)> entryCallback,
         std::function<void(void)> internalCallback) {
-      TransitionData transitionData(target, std::move(entryCallback), std::move(internalCallback));
-      _transitionTable.insert({event, transitionData});
+      auto id = event.getId();
+      if(id >= _transitionTable.size()) {
+        _transitionTable.resize(id + 1);
+      }
+      // Like the insertion into a map, an existing transition is kept
+      if(!_transitionTable[id]) {
+        _transitionTable[id].emplace(target, std::move(entryCallback), std::move(internalCallback));
+      }
     }
 
     /******************************************************************************************************************/
@@ -51,7 +83,7 @@ namespace ChimeraTK::MotorDriver {
 
     /******************************************************************************************************************/
 
-    std::string StateMachine::State::getName() const {
+    const std::string& StateMachine::State::getName() const {
       return _stateName;
     }
 
@@ -68,6 +100,12 @@ namespace ChimeraTK::MotorDriver {
 
     /******************************************************************************************************************/
 
+    StateMachine::StateId StateMachine::getCurrentStateId() {
+      return getCurrentState()->getId();
+    }
+
+    /******************************************************************************************************************/
+
     void StateMachine::setAndProcessUserEvent(const Event& event) {
       std::lock_guard<std::mutex> lck(_stateMachineMutex);
       performTransition(event);
@@ -77,15 +115,17 @@ namespace ChimeraTK::MotorDriver {
 
     void StateMachine::performTransition(const Event& event) {
       auto const& transitionTable = _currentState->getTransitionTable();
-      if(auto it = transitionTable.find(event); it != transitionTable.end()) {
-        _requestedState = ((it->second).targetState);
-        _requestedInternalCallback = (it->second).internalCallbackAction;
+      auto id = event.getId();
+      if(id < transitionTable.size() && transitionTable[id]) {
+        auto const& transition = *transitionTable[id];
+        _requestedState = transition.targetState;
+        _requestedInternalCallback = transition.internalCallbackAction;
 
         // Apply new state right away, if no async action active
         if(!_asyncActionActive.load()) {
           moveToRequestedState();
         }
-        (it->second).entryCallbackAction();
+        transition.entryCallbackAction();
       }
     }
 